@@ -1,13 +1,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <stddef.h>
 #include <string.h>
 
 #include "pico/stdlib.h"
 #include "hardware/pio.h"
 #include "hardware/clocks.h"
 #include "hardware/watchdog.h"
+#include "hardware/uart.h"
+#include "hardware/adc.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/nvic.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#include "hardware/regs/m0plus.h"
 #include "ws2812.pio.h"
+#include "morse_tx.pio.h"
+#include "morse_hmm.h"
+#include "morse_match.h"
+#include "scheduler.h"
+#include "edge_log.h"
+#include "inject.h"
+#include "tone_detect.h"
+#include "transcribe.h"
+#include "telemetry.h"
+#include "fmt.h"
+#include "morse_tx.h"
+#include "game_session.h"
 
 /*!
   \def IS_RGBW
@@ -27,6 +49,86 @@
 */
 #define WS2812_PIN 28
 
+/*!
+  \def USE_HMM_DECODER
+  Specifies whether answers that don't match exactly are re-checked with the HMM decoder
+*/
+#ifndef USE_HMM_DECODER
+#define USE_HMM_DECODER 1
+#endif
+
+/*!
+  \def HMM_MIN_CONFIDENCE
+  Specifies the confidence (%) the HMM decoder needs before it overrules the exact match
+*/
+#define HMM_MIN_CONFIDENCE 60
+
+/*!
+  \def AUDIO_INPUT
+  Specifies whether tones on the ADC are decoded as key presses (see Audio Input)
+*/
+#ifndef AUDIO_INPUT
+#define AUDIO_INPUT 0
+#endif
+
+/*!
+  \def TELEMETRY
+  Specifies whether binary telemetry records are sent along with the console text (see Telemetry)
+*/
+#ifndef TELEMETRY
+#define TELEMETRY 1
+#endif
+
+/*!
+  \def KEY_MIN_PULSE_US
+  Specifies the shortest press or release (in microseconds) the keys accept, shorter ones are contact bounce or noise (see Key Debounce)
+*/
+#define KEY_MIN_PULSE_US 5000
+
+/*!
+  \def MEMORY_ARENA_BUDGET
+  Specifies the most bytes the game's global buffers may take, checked by the host build (see Memory Report)
+*/
+#define MEMORY_ARENA_BUDGET (32 * 1024)
+
+/*!
+  \def MORSE_TX
+  Specifies whether the right answer is keyed out on MORSE_TX_PIN after a wrong one (see Morse Transmit)
+*/
+#ifndef MORSE_TX
+#define MORSE_TX 1
+#endif
+
+/*!
+  \def MORSE_TX_PIN
+  Specifies the GPIO pin that Morse is keyed out on, high while the key is down
+*/
+#define MORSE_TX_PIN 15
+
+/*!
+  \def MORSE_TX_SM
+  Specifies the PIO0 state machine that keys MORSE_TX_PIN (state machine 0 drives the WS2812)
+*/
+#define MORSE_TX_SM 1
+
+/*!
+  \def MORSE_TX_WPM
+  Specifies the character speed Morse is keyed out at
+*/
+#define MORSE_TX_WPM 18
+
+/*!
+  \def MORSE_TX_FARNSWORTH_WPM
+  Specifies the overall speed Morse is keyed out at, the gaps are stretched to it (0 for standard spacing)
+*/
+#define MORSE_TX_FARNSWORTH_WPM 10
+
+/*!
+  \def WS2812_FREQ
+  Specifies the bit rate of the WS2812 serial protocol in Hz
+*/
+#define WS2812_FREQ 800000
+
 /**
  * @file assign02.c
  * @brief This file contains the vast majority of the game logic. It does not include interrupts code or
@@ -36,22 +138,89 @@
 // -------------------------------------- Global Variables --------------------------------------
 
 int initial_round = 1; /*!< Used to only print instructions once on initial round */
-int current_level = 0; /*!< 0 = Level select, 1 - 4 = level X */
 
-int quit = 0; /*!< 0 - Continue playing, 1 - quit the game at the next opportunity */
+int quit = 0; /*!< 0 - Continue playing, 1 - Every player has left the game */
+
+volatile int deferred_hold = 1; /*!< 1 - Deferred input work must wait (still booting, or clk_sys is being switched) */
+
+volatile int transmit_busy = 0; /*!< 1 - Morse is being keyed out, clk_sys must not be switched (see Morse Transmit) */
+
+// -------------------------------------- Stations --------------------------------------
+
+/*
+ * Every player has their own key (station) on its own GPIO pin. All of their
+ * state is kept as a struct of arrays indexed by player number, so the edge
+ * interrupt and the deferred work touch one small array per field however many
+ * players there are. The game itself is played by the active player. Each player's
+ * rounds, scoring and keying decode are a game_session (game_session.c), the same
+ * library the host tools run, and this file renders what it does.
+ */
+
+/**
+ * @def NUM_PLAYERS
+ * The number of stations, one per entry of player_pins (at most MAX_PLAYERS)
+ */
+#define NUM_PLAYERS 1
+
+/**
+ * @def MAX_PLAYERS
+ * The most stations that can be wired to the board
+ */
+#define MAX_PLAYERS 16
+
+/**
+ * @def NUM_GPIOS
+ * The number of GPIO pins in IO_BANK0
+ */
+#define NUM_GPIOS 30
+
+/**
+ * @def NO_PLAYER
+ * pin_player value of a pin that isn't a station (must match assign02.S)
+ */
+#define NO_PLAYER 0xFF
+
+const uint8_t player_pins[NUM_PLAYERS] = {21}; /*!< GPIO pin of each station's key, player 0 is the GPIO 21 button */
+const int num_players = NUM_PLAYERS;           /*!< Number of stations, read by assign02.S */
+uint8_t pin_player[NUM_GPIOS];                 /*!< Player of each GPIO pin (NO_PLAYER if none), read by gpio_isr */
+
+/** Struct of arrays holding the state of every player, indexed by player number */
+typedef struct player_state
+{
+    // Keying, owned by the deferred input work
+    uint32_t first_press[NUM_PLAYERS];    /*!< Timestamp of the first press of the current answer */
+
+    // Free keying, timed by the deferred input work against the transcriber's unit
+    uint32_t press_time[NUM_PLAYERS];     /*!< Timestamp of the last press */
+    uint32_t deadline[NUM_PLAYERS];       /*!< Timestamp at which the next gap timeout is due */
+    uint8_t key_down[NUM_PLAYERS];        /*!< 1 - The key is currently held */
+    uint8_t deadline_armed[NUM_PLAYERS];  /*!< 1 - A gap timeout is due at deadline */
+    uint8_t alarm_run[NUM_PLAYERS];       /*!< 0 - Next timeout is a letter gap, 1 - Next timeout is a word gap */
+
+    // The game
+    game_session session[NUM_PLAYERS]; /*!< Rounds, scoring, lives and the answer being keyed */
+    uint8_t state[NUM_PLAYERS];        /*!< The game_state the player is in */
+} player_state;
+
+player_state players;  /*!< The state of every player */
+int active_player = 0; /*!< The player whose game is currently being run */
 
-int lives = 3; /*!< The number of lives the player currently has */
+/**
+ * @brief Builds the pin to player map and sets every player up for a new game
+ */
+void stations_init()
+{
+    for (int pin = 0; pin < NUM_GPIOS; pin++)
+        pin_player[pin] = NO_PLAYER;
 
-int wins = 0;                  /*!< The number of wins (of levels) a player has */
-int total_correct_answers = 0; /*!< The total number of correct answers a player has accross all games */
-int right_input = 0;           /*!< The number of correct ansers in a specific game */
-int wrong_input = 0;           /*!< The number of incorrect ansers in a specific game */
-int remaining = 5;             /*!< The number of questions a player must get right to progress */
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        pin_player[player_pins[p]] = p;
 
-char current_input[100];      /*!< String of the current input from the buffer */
-int current_input_length = 0; /*!< The length of the current input string */
-int char_to_solve = 0;        /*!< The index of the character/word the player is currently trying to solve in the table */
-int input_complete = 0;       /*!< 0 - Incomplete, 1 - Complete */
+        // The level select also mixes in the time of the player's first press
+        session_init(&players.session[p], time_us_32() + p);
+    }
+}
 
 // -------------------------------------- WS2812 RGB LED --------------------------------------
 
@@ -86,6 +255,11 @@ static inline uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b)
            (uint32_t)(b);
 }
 
+/**
+ * @brief Sets the LED blue, defined in the LED section below the display functions that use it
+ */
+void set_blue_led(void);
+
 // ------------------------------ Declare Main Assembly Entry Before use ------------------------------
 
 /**
@@ -93,6 +267,20 @@ static inline uint32_t urgb_u32(uint8_t r, uint8_t g, uint8_t b)
  */
 void main_asm();
 
+/**
+ * @brief Arms ALARM0 to fire when the lower 32 bits of the timer reach the given time
+ *
+ * @param time_us The time to fire at
+ */
+void set_alarm_at(uint32_t time_us);
+
+/**
+ * @brief Arms ALARM1 (the key re-enable alarm) to fire when the lower 32 bits of the timer reach the given time
+ *
+ * @param time_us The time to fire at
+ */
+void set_debounce_alarm_at(uint32_t time_us);
+
 // -------------------------------------- GPIO Pin Initialisation --------------------------------------
 
 /**
@@ -103,6 +291,8 @@ void main_asm();
 void asm_gpio_init(uint pin)
 {
     gpio_init(pin);
+    // Station keys switch to ground, so they mustn't float when released
+    gpio_pull_up(pin);
 }
 
 /**
@@ -156,489 +346,2305 @@ void arm_watchdog_update()
     watchdog_update();
 }
 
-// -------------------------------------- Letter Struct --------------------------------------
+// -------------------------------------- Boot Profiling --------------------------------------
 
 /*
- * Initializes the morse code table.
- * The table contains 36 entries, each representing a letter or a digit.
- * Each entry consists of a letter or a digit and its corresponding Morse code.
- */
-
-/**
- * @def TABLE_SIZE
- * The size to initialise the table array
- */
-#define TABLE_SIZE 36
-
-/** Struct defining the structure of a morse code character and its transliteration */
-typedef struct morse
-{
-    char letter;
-    char *code;
-} morse;
-
-morse table[TABLE_SIZE]; /*!< Initialise global morse code character table */
-
-/**
- * @brief Initialises a morse code character table
- */
-void morse_init()
-{
-    // Initialize the table with letters A-Z and digits 0-9
-    table[0].letter = 'A';
-    table[1].letter = 'B';
-    table[2].letter = 'C';
-    table[3].letter = 'D';
-    table[4].letter = 'E';
-    table[5].letter = 'F';
-    table[6].letter = 'G';
-    table[7].letter = 'H';
-    table[8].letter = 'I';
-    table[9].letter = 'J';
-    table[10].letter = 'K';
-    table[11].letter = 'L';
-    table[12].letter = 'M';
-    table[13].letter = 'N';
-    table[14].letter = 'O';
-    table[15].letter = 'P';
-    table[16].letter = 'Q';
-    table[17].letter = 'R';
-    table[18].letter = 'S';
-    table[19].letter = 'T';
-    table[20].letter = 'U';
-    table[21].letter = 'V';
-    table[22].letter = 'W';
-    table[23].letter = 'X';
-    table[24].letter = 'Y';
-    table[25].letter = 'Z';
-    table[26].letter = '0';
-    table[27].letter = '1';
-    table[28].letter = '2';
-    table[29].letter = '3';
-    table[30].letter = '4';
-    table[31].letter = '5';
-    table[32].letter = '6';
-    table[33].letter = '7';
-    table[34].letter = '8';
-    table[35].letter = '9';
-
-    // Initialize the Morse code for each letter or digit
-    table[0].code = ".-";
-    table[1].code = "-...";
-    table[2].code = "-.-.";
-    table[3].code = "-..";
-    table[4].code = ".";
-    table[5].code = "..-.";
-    table[6].code = "--.";
-    table[7].code = "....";
-    table[8].code = "..";
-    table[9].code = ".---";
-    table[10].code = "-.-";
-    table[11].code = ".-..";
-    table[12].code = "--";
-    table[13].code = "-.";
-    table[14].code = "---";
-    table[15].code = ".--.";
-    table[16].code = "--.-";
-    table[17].code = ".-.";
-    table[18].code = "...";
-    table[19].code = "-";
-    table[20].code = "..-";
-    table[21].code = "...-";
-    table[22].code = ".--";
-    table[23].code = "-..-";
-    table[24].code = "-.--";
-    table[25].code = "--..";
-    table[26].code = "-----";
-    table[27].code = ".----";
-    table[28].code = "..---";
-    table[29].code = "...--";
-    table[30].code = "....-";
-    table[31].code = ".....";
-    table[32].code = "-....";
-    table[33].code = "--...";
-    table[34].code = "---..";
-    table[35].code = "----.";
-}
-
-// -------------------------------------- Word Struct --------------------------------------
+ * The TIMER starts counting at reset, so time_us_32() read during boot is the time
+ * since reset. main() marks the end of each boot phase and the report is printed
+ * once the game is ready, so printing it doesn't add to the time it measures.
+ *
+ * Boot is ordered so the player can key straight away: the key interrupts are armed
+ * first and timestamp edges into the event queues while the rest of the init runs,
+ * the deferred input work is held until the game has entered its first state, and
+ * the banners are printed by a task after that.
+ */
+
+/**
+ * @def BOOT_MAX_PHASES
+ * Most boot phases that can be marked
+ */
+#define BOOT_MAX_PHASES 12
+
+/** Struct defining the end of a boot phase */
+typedef struct boot_phase
+{
+    const char *name;
+    uint32_t at_us; /*!< Time since reset the phase finished at */
+} boot_phase;
+
+boot_phase boot_phases[BOOT_MAX_PHASES]; /*!< The phases of this boot, in order */
+int boot_phase_count = 0;                /*!< Number of entries in boot_phases */
+
+/**
+ * @brief Marks the end of a boot phase
+ *
+ * @param name Name of the phase, must be a string literal
+ */
+void boot_mark(const char *name)
+{
+    if (boot_phase_count == BOOT_MAX_PHASES)
+        return;
+    boot_phases[boot_phase_count].name = name;
+    boot_phases[boot_phase_count].at_us = time_us_32();
+    boot_phase_count++;
+}
+
+/**
+ * @brief Prints the boot profile as one machine readable line, the time since reset
+ *        at the end of every phase, ending with the boot to ready time
+ *
+ *        #BOOT <phase>=<us> ... ready=<us>
+ */
+void boot_report()
+{
+    char value[FMT_MAX_LEN];
+    printf("#BOOT");
+    for (int i = 0; i < boot_phase_count; i++)
+        printf(" %s=%s", boot_phases[i].name, fmt_uint(value, boot_phases[i].at_us, 0));
+    printf("\n");
+}
+
+// -------------------------------------- Stack Usage --------------------------------------
 
 /*
- * Initializes the morse code table for words in optional levels 3 & 4.
- * The table contains 25 entries, each representing a lrandom word.
- * Each entry consists of the word and its corresponding Morse code.
- */
-
-/**
- * @def TABLE_SIZE_WORD
- * The size to initialise the table of words array
- */
-#define TABLE_SIZE_WORD 25
-
-/** Struct defining the structure of a morse code word and its transliteration */
-typedef struct wordMorse
-{
-    char *word;
-    char *code;
-} wordMorse;
-
-wordMorse wTable[TABLE_SIZE_WORD]; /*!< Initialise global morse code word table */
-
-/**
- * @brief Initialises a morse code words table for use in Levels 3 and 4
- */
-void word_morse_init()
-{
-    // Initialize the table with random words for the questions
-    wTable[0].word = "justin";
-    wTable[1].word = "conor";
-    wTable[2].word = "hannah";
-    wTable[3].word = "surya";
-    wTable[4].word = "brian";
-    wTable[5].word = "apple";
-    wTable[6].word = "banana";
-    wTable[7].word = "shoe";
-    wTable[8].word = "hat";
-    wTable[9].word = "fish";
-    wTable[10].word = "bird";
-    wTable[11].word = "door";
-    wTable[12].word = "table";
-    wTable[13].word = "lamp";
-    wTable[14].word = "spoon";
-    wTable[15].word = "chair";
-    wTable[16].word = "sun";
-    wTable[17].word = "bicycle";
-    wTable[18].word = "ocean";
-    wTable[19].word = "compass";
-    wTable[20].word = "umbrella";
-    wTable[21].word = "volcano";
-    wTable[22].word = "computer";
-    wTable[23].word = "system";
-    wTable[24].word = "game";
-
-    // Initialize the Morse code for each letter or digit
-    wTable[0].code = ".--- ..- ... - .. -.";
-    wTable[1].code = "-.-. --- -. --- .-.";
-    wTable[2].code = ".... .- -. -. .- ....";
-    wTable[3].code = "... ..- .-. -.-- .-";
-    wTable[4].code = "-... .-. .. .- -.";
-    wTable[5].code = ".- .--. .--. .-.. .";
-    wTable[6].code = "-... .- -. .- -. .-";
-    wTable[7].code = "... .... --- .";
-    wTable[8].code = ".... .- -";
-    wTable[9].code = "..-. .. ... ....";
-    wTable[10].code = "-... .. .-. -..";
-    wTable[11].code = "-.. --- --- .-.";
-    wTable[12].code = "- .- -... .-.. .";
-    wTable[13].code = ".-.. .- -- .--.";
-    wTable[14].code = "... .--. --- --- -.";
-    wTable[15].code = "-.-. .... .- .. .-.";
-    wTable[16].code = "... ..- -.";
-    wTable[17].code = "-... .. -.-. -.-- -.-. .-.. .";
-    wTable[18].code = "--- -.-. . .- -.";
-    wTable[19].code = "-.-. --- -- .--. .- ... ...";
-    wTable[20].code = "..- -- -... .-. . .-.. .-.. .-";
-    wTable[21].code = "...- --- .-.. -.-. .- -. ---";
-    wTable[22].code = "-.-. --- -- .--. ..- - . .-.";
-    wTable[23].code = "... -.-- ... - . --";
-    wTable[24].code = "--. .- -- .";
+ * Every handler runs on core0's main stack below whatever thread code it interrupted,
+ * so the deepest it ever gets is the thread's deepest point plus a handler at each
+ * priority that can preempt another. The unused stack (and all of core1's, which
+ * doesn't run) is filled with STACK_PAINT at reset, and the high-water mark is the
+ * lowest word that has been overwritten since. Each handler also counts itself in and
+ * out, which records how deeply they have nested. Handlers nest strictly, so a count
+ * that is interrupted part way through its update is restored before it resumes. The
+ * SDK's own handlers (stdio and the default alarm pool) aren't counted.
+ */
+
+/**
+ * @def STACK_PAINT
+ * Fill of the unused stack
+ */
+#define STACK_PAINT 0xDEADBEEF
+
+/**
+ * @def STACK_PAINT_MARGIN
+ * Words left alone below the stack pointer when painting the running stack
+ */
+#define STACK_PAINT_MARGIN 32
+
+extern uint32_t __StackBottom[];    /*!< Lowest word of core0's stack, from the linker script */
+extern uint32_t __StackTop[];       /*!< End of core0's stack */
+extern uint32_t __StackOneBottom[]; /*!< Lowest word of core1's stack */
+extern uint32_t __StackOneTop[];    /*!< End of core1's stack */
+
+volatile uint32_t irq_depth = 0; /*!< Handlers running, including the one counting */
+uint32_t irq_depth_max = 0;      /*!< Most handlers that have been running at once */
+
+/**
+ * @brief Counts a handler in, called first thing by every game handler (in RAM, as
+ *        the audio handler is)
+ */
+void __not_in_flash_func(irq_nest_enter)()
+{
+    uint32_t depth = irq_depth + 1;
+    irq_depth = depth;
+    if (depth > irq_depth_max)
+        irq_depth_max = depth;
 }
 
-// -------------------------------------- Select Level --------------------------------------
+/**
+ * @brief Counts a handler out, called last thing by every game handler
+ */
+void __not_in_flash_func(irq_nest_exit)()
+{
+    irq_depth = irq_depth - 1;
+}
+
+/**
+ * @brief Paints the unused part of a stack, stopping short of the stack pointer if it
+ *        is running on it
+ */
+void stack_paint(uint32_t *bottom, uint32_t *top)
+{
+    uint32_t *sp = __builtin_frame_address(0);
+    uint32_t *end = sp > bottom + STACK_PAINT_MARGIN && sp <= top ? sp - STACK_PAINT_MARGIN : top;
+    for (uint32_t *w = bottom; w < end; w++)
+        *w = STACK_PAINT;
+}
 
 /**
- * @brief Generates a random integer between the given low and high values (inclusive).
+ * @brief Gets the most of a stack that has been used since it was painted
  *
- * @param low The lower bound of the range.
- * @param high The upper bound of the range.
- * @return A random integer between low and high.
+ * @return uint32_t The bytes between the lowest overwritten word and the top
  */
-int select_random(int low, int high)
+uint32_t stack_used(const uint32_t *bottom, const uint32_t *top)
 {
-    return rand() % (high - low + 1) + low;
+    const uint32_t *w = bottom;
+    while (w < top && *w == STACK_PAINT)
+        w++;
+    return (uint32_t)((top - w) * sizeof(uint32_t));
 }
 
+// -------------------------------------- Stats Box --------------------------------------
+
 /**
- * @brief Executes level 1 of the game.
- * The player is presented with a series of Morse code challenges and must input the correct answers.
- * The level continues until the player runs out of lives or answers 5 questions correctly in a row.
- * At the end of the level, the outcome (win or lose) is displayed.
+ * @brief Prints one line of the stats box
+ *
+ * @param label The label, with the tabs that line its value up
+ * @param value The formatted value
  */
-void level_1()
+void stats_line(const char *label, const char *value)
 {
-    printf("-----------\n");
-    printf("| Level 1 |\n");
-    printf("-----------\n\n");
+    printf("\n*\t%s%s\t*", label, value);
+}
 
-    while (remaining > 0 && lives > 0)
-    {
-        srand(time(NULL));
-        char_to_solve = select_random(0, 35);
-        printf("-----------------------------------------\n");
-        printf("|\tEnter %c = %s in Morse Code\t|\n", table[char_to_solve].letter, table[char_to_solve].code);
-        printf("-----------------------------------------\n");
-        while (input_complete == 0)
-        {
-            // Empty while to stall the game until the timer interrupt fires
-        }
-        input_complete = 0;
-        check_input();
-    }
+// -------------------------------------- Clock Management --------------------------------------
 
-    // At the end of Level 1, check if we finished due to running out of lives
-    // or due to getting 5 answers in a row correct
-    if (lives == 0)
-    {
-        // Ran out of lives
-        printf("YOU LOSE!!!\n");
-    }
-    else
-    {
-        // Completed 5 corret questions
-        printf("YOU WIN!!!\n");
-        wins++;
-    }
-    set_blue_led();
-    game_finished();
+/*
+ * The player spends almost all of a session thinking, so clk_sys is dropped
+ * while the game is waiting, raised a little while a character is being keyed
+ * and boosted back to the SDK default for rendering the prompts and stats.
+ *
+ * The game timing (SESSION_LONG_PRESS_US, the ALARM0 space/submit timeouts and the
+ * watchdog) is all measured in microseconds by the TIMER block, whose 1 MHz
+ * tick is generated from clk_ref (the 12 MHz crystal), not from clk_sys. The
+ * keying thresholds therefore stay exact at every operating point. Everything
+ * that IS derived from clk_sys is recomputed after each switch: clk_peri (and
+ * with it the UART baud divisor) and the WS2812 and Morse transmit PIO clock
+ * dividers. USB runs from its own PLL and is unaffected.
+ */
+
+/** The operating points the game moves between */
+typedef enum clock_op
+{
+    CLOCK_OP_IDLE,   /*!< Waiting for the player to start keying */
+    CLOCK_OP_INPUT,  /*!< The player is part way through keying an answer */
+    CLOCK_OP_RENDER, /*!< Printing prompts, results and stats */
+    CLOCK_OP_COUNT
+} clock_op;
+
+/** Struct defining a system clock frequency and its nominal power draw */
+typedef struct operating_point
+{
+    const char *name;
+    uint32_t khz;      /*!< clk_sys frequency, must be reachable by set_sys_clock_khz() */
+    uint32_t power_mw; /*!< Nominal board power at this frequency, used for the energy estimate */
+} operating_point;
+
+/**
+ * Operating point table indexed by clock_op. The power figures are typical RP2040 + board
+ * draws and should be recalibrated by measuring VSYS current on the target hardware.
+ */
+const operating_point op_table[CLOCK_OP_COUNT] = {
+    {"Idle", 48000, 14},
+    {"Input", 64000, 18},
+    {"Render", 125000, 30},
+};
+
+clock_op current_op = CLOCK_OP_RENDER; /*!< The operating point clk_sys is currently at */
+uint64_t op_entered_us = 0;            /*!< Timestamp at which the current operating point was entered */
+uint64_t op_time_us[CLOCK_OP_COUNT];   /*!< Time spent at each operating point since the stats were last reset */
+
+/**
+ * @brief Starts accounting time at the boot operating point (clk_sys as configured by the SDK)
+ */
+void clock_init()
+{
+    current_op = CLOCK_OP_RENDER;
+    op_entered_us = time_us_64();
 }
 
 /**
- * @brief Executes level 2 of the game.
- * The player is presented with a series of Morse code challenges and must input the correct answers.
- * The level continues until the player runs out of lives or answers 5 questions correctly in a row.
- * At the end of the level, the outcome (win or lose) is displayed.
+ * @brief Moves clk_sys to the given operating point and recomputes every clock
+ *        divider that is derived from it
+ *
+ * @param op The operating point to switch to
  */
-void level_2()
+void clock_set_op(clock_op op)
 {
-    printf("-----------\n");
-    printf("| Level 2 |\n");
-    printf("-----------\n\n");
+    // The Morse transmit tick is divided from clk_sys, keep it steady until the key is up
+    if (op == current_op || transmit_busy)
+        return;
 
-    while (remaining > 0 && lives > 0)
-    {
-        srand(time(NULL));
-        char_to_solve = select_random(0, 35);
-        printf("---------------------------------\n");
-        printf("|\tEnter %c in Morse Code\t|\n", table[char_to_solve].letter);
-        printf("---------------------------------\n");
-        while (input_complete == 0)
-        {
-            // Empty while to stall the game until the timer interrupt fires
-        }
-        input_complete = 0;
-        check_input();
-    }
+    // Drain the console first and hold back the deferred input work (which prints) so
+    // no character is sent across the switch. Interrupts stay enabled so edges are
+    // still timestamped on time.
+    stdio_flush();
+    deferred_hold = 1;
 
-    // At the end of Level 2, check if we finished due to running out of lives
-    // or due to getting 5 answers in a row correct
-    if (lives == 0)
+    if (set_sys_clock_khz(op_table[op].khz, false))
     {
-        // Ran out of lives
-        printf("YOU LOSE!!!\n");
+#if LIB_PICO_STDIO_UART
+        uart_set_baudrate(uart_default, PICO_DEFAULT_UART_BAUD_RATE);
+#endif
+        ws2812_program_set_freq(pio0, 0, WS2812_FREQ);
+#if MORSE_TX
+        morse_tx_program_set_tick(pio0, MORSE_TX_SM, MORSE_TX_TICK_HZ);
+#endif
+
+        uint64_t now = time_us_64();
+        op_time_us[current_op] += now - op_entered_us;
+        op_entered_us = now;
+        current_op = op;
     }
-    else
+
+    // Catch up on any input that arrived during the switch
+    deferred_hold = 0;
+    scb_hw->icsr = M0PLUS_ICSR_PENDSVSET_BITS;
+}
+
+/**
+ * @brief Prints the estimated energy spent per round at each operating point
+ *
+ * @param rounds The number of rounds played since the accounting was last reset
+ * @param reset  Non-zero to restart the accounting afterwards
+ */
+void clock_energy_report(int rounds, int reset)
+{
+    uint64_t now = time_us_64();
+    op_time_us[current_op] += now - op_entered_us;
+    op_entered_us = now;
+    char value[FMT_MAX_LEN], mhz[FMT_MAX_LEN], mw[FMT_MAX_LEN];
+
+    // The power figures are nominal, not measured, so the energy is labelled as an
+    // estimate along with the draw it assumes
+    for (int i = 0; i < CLOCK_OP_COUNT; i++)
     {
-        // Completed 5 corret questions
-        printf("YOU WIN!!!\n");
-        wins++;
+        // mW * us / 1000 = uJ
+        uint64_t energy_uj = op_time_us[i] * op_table[i].power_mw / 1000;
+        if (rounds > 0)
+            energy_uj /= rounds;
+        printf("\n*\tEst. energy/round %s (%sMHz, %s mW nominal): \t~%s uJ\t*", op_table[i].name,
+               fmt_uint(mhz, op_table[i].khz / 1000, 0), fmt_uint(mw, op_table[i].power_mw, 0),
+               fmt_uint(value, (uint32_t)energy_uj, 0));
+        if (reset)
+            op_time_us[i] = 0;
     }
-    set_blue_led();
-    game_finished();
 }
 
-/**
- * @brief Executes level 3 of the game.
- * The player is presented with a series of words (along woth morse values) as Morse code challenges and must input the correct answers.
- * The level continues until the player runs out of lives or answers 5 questions correctly in a row.
- * At the end of the level, the outcome (win or lose) is displayed.
+// -------------------------------------- Scheduler --------------------------------------
+
+/*
+ * The game never blocks. Each player's game is a state machine run by its own task,
+ * which is posted an event when the player completes an input, and the LED has a
+ * task of its own driven by a timer. The main loop runs whichever tasks have events
+ * (scheduler.c) and sleeps when none do, so every subsystem gets a turn within one
+ * handler's run time of being ready.
  */
 
-void level_3()
+/** Events posted to a game task (SCHED_EVENT_TIMER is reserved) */
+enum game_event
 {
-    printf("---------------------------------------------------------\n");
-    printf("|                        Level 3                        |\n");
-    printf("| Please enter a space between each letter of the word  |\n");
-    printf("|    Wait for one second after inputting for a space    |\n");
-    printf("---------------------------------------------------------\n\n");
+    GAME_EVENT_INPUT = 1u << 0, /*!< The player has completed an input */
+    GAME_EVENT_TEXT = 1u << 1   /*!< Free keying has decoded more text */
+};
 
-    while (remaining > 0 && lives > 0)
-    {
-        srand(time(NULL));
-        char_to_solve = select_random(0, 24);
-        if(strlen(wTable[char_to_solve].word) < 4){
-            printf("-------------------------------------------------\n");
-            printf("|\tEnter %s = %s in Morse Code\t|\n", wTable[char_to_solve].word, wTable[char_to_solve].code);
-            printf("-------------------------------------------------\n");
-        }
-        else if(strlen(wTable[char_to_solve].word) < 6){
-            printf("---------------------------------------------------------\n");
-            printf("|\tEnter %s = %s in Morse Code\t|\n", wTable[char_to_solve].word, wTable[char_to_solve].code);
-            printf("---------------------------------------------------------\n");
-        } 
-        else if(strlen(wTable[char_to_solve].word) < 8){
-            printf("-----------------------------------------------------------------\n");
-            printf("|\tEnter %s = %s in Morse Code\t|\n", wTable[char_to_solve].word, wTable[char_to_solve].code);
-            printf("-----------------------------------------------------------------\n");
-        }
-        else{
-            printf("-------------------------------------------------------------------------\n");
-            printf("|\tEnter %s = %s in Morse Code\t|\n", wTable[char_to_solve].word, wTable[char_to_solve].code);
-            printf("-------------------------------------------------------------------------\n");
-        }
-        
-        while (input_complete == 0)
-        {
-            // Empty while to stall the game until the timer interrupt fires
-        }
-        input_complete = 0;
-        check_input();
-    }
+/** The states of a player's game */
+typedef enum game_state
+{
+    GAME_SELECT,     /*!< Waiting for a level to be selected */
+    GAME_QUESTION,   /*!< Waiting for the answer to a question */
+    GAME_REPLAY,     /*!< Waiting for play again or exit at the end of a level */
+    GAME_TRANSCRIBE, /*!< Free keying, decoded as it goes */
+    GAME_QUIT,       /*!< The player has left the game */
+    GAME_STATE_COUNT
+} game_state;
+
+/** Names of the game states in the outcome reports, indexed by game_state */
+const char *const game_state_names[GAME_STATE_COUNT] = {"SELECT", "QUESTION", "REPLAY", "TRANSCRIBE", "QUIT"};
+
+scheduler sched;                  /*!< Runs the game and LED tasks */
+int game_task_id[NUM_PLAYERS];    /*!< Task running each player's game */
+int led_task_id;                  /*!< Task animating the LED */
+volatile uint32_t sched_wake_at;  /*!< Earliest scheduler timer, ALARM0 is set for it while idle */
+volatile int sched_wake_armed;    /*!< 1 - sched_wake_at is a pending wake up */
 
-    // At the end of Level 3, check if we finished due to running out of lives
-    // or due to getting 5 answers in a row correct
-    if (lives == 0)
+/**
+ * @brief Sleeps until an interrupt or the next scheduler timer, at the operating
+ *        point for whether anyone is part way through keying an answer
+ */
+void scheduler_idle()
+{
+    int keying = 0;
+    for (int p = 0; p < NUM_PLAYERS; p++)
     {
-        // Ran out of lives
-        printf("YOU LOSE!!!\n");
+        if (players.session[p].length > 0)
+            keying = 1;
     }
-    else
+    clock_set_op(keying ? CLOCK_OP_INPUT : CLOCK_OP_IDLE);
+
+    uint32_t at = 0;
+    int armed = sched_next_deadline(&sched, &at);
+
+    // Interrupts are masked so an event posted after sched_run() still ends the
+    // __wfi(), the pending interrupt wakes the core and runs once they are restored
+    uint32_t irq = save_and_disable_interrupts();
+    if (armed != sched_wake_armed || at != sched_wake_at)
     {
-        // Completed 5 corret questions
-        printf("YOU WIN!!!\n");
-        wins++;
+        // PendSV sets ALARM0 for the earlier of this and the gap timeouts
+        sched_wake_at = at;
+        sched_wake_armed = armed;
+        scb_hw->icsr = M0PLUS_ICSR_PENDSVSET_BITS;
     }
-    set_blue_led();
-    game_finished();
+    if (sched.ready == 0)
+        __wfi();
+    restore_interrupts(irq);
 }
 
-/**
- * @brief Executes level 4 of the game.
- * The player is presented with a series of words as Morse code challenges and must input the correct answers.
- * The level continues until the player runs out of lives or answers 5 questions correctly in a row.
- * At the end of the level, the outcome (win or lose) is displayed.
+// -------------------------------------- HMM Decoder --------------------------------------
+
+/*
+ * The exact match against session_letters depends on every press landing on the right
+ * side of SESSION_LONG_PRESS_US. The HMM decoder (morse_hmm.c) sees the same press and
+ * release durations and finds the most likely letters, so sloppy but readable
+ * keying can still be accepted.
  */
 
-void level_4()
-{
-    printf("---------------------------------------------------------\n");
-    printf("|                        Level 4                        |\n");
-    printf("| Please enter a space between each letter of the word  |\n");
-    printf("|    Wait for one second after inputting for a space    |\n");
-    printf("---------------------------------------------------------\n\n");
+morse_hmm player_hmm[NUM_PLAYERS]; /*!< Decoders fed with the durations of each player's current input */
 
-    while (remaining > 0 && lives > 0)
+/**
+ * @brief Loads the morse code character table into every player's HMM decoder
+ */
+void hmm_init()
+{
+    for (int p = 0; p < NUM_PLAYERS; p++)
     {
-        srand(time(NULL));
-        char_to_solve = select_random(0, 24);
-        if(strlen(wTable[char_to_solve].word) < 4){
-            printf("---------------------------------\n");
-            printf("|\tEnter %s in Morse Code\t|\n", wTable[char_to_solve].word);
-            printf("---------------------------------\n");
-        }
-        else{
-            printf("-----------------------------------------\n");
-            printf("|\tEnter %s in Morse Code\t|\n", wTable[char_to_solve].word);
-            printf("-----------------------------------------\n");
-        }
-
-        while (input_complete == 0)
-        {
-            // Empty while to stall the game until the timer interrupt fires
-        }
-        input_complete = 0;
-        check_input();
+        morse_hmm_init(&player_hmm[p]);
+        for (int i = 0; i < SESSION_LETTERS; i++)
+            morse_hmm_add_code(&player_hmm[p], session_letters[i].text[0], session_letters[i].code);
     }
+}
 
-    // At the end of Level 4, check if we finished due to running out of lives
-    // or due to getting 5 answers in a row correct
-    if (lives == 0)
+/**
+ * @brief Compares decoded text with an answer, ignoring case
+ *
+ * @param decoded The text from the decoder (upper case)
+ * @param answer  The letter or word the player was asked for
+ * @return int 1 if they are the same, 0 otherwise
+ */
+int text_matches(const char *decoded, const char *answer)
+{
+    for (; *decoded && *answer; decoded++, answer++)
     {
-        // Ran out of lives
-        printf("YOU LOSE!!!\n");
+        char a = *answer;
+        if (a >= 'a' && a <= 'z')
+            a -= 'a' - 'A';
+        if (*decoded != a)
+            return 0;
     }
-    else
+    return *decoded == *answer;
+}
+
+/**
+ * @brief Checks an answer against the question, first exactly and then (if enabled) by
+ *        the HMM decoder
+ *
+ * @param input The answer as it was keyed
+ * @param q     The question
+ * @return int 1 if the input is accepted, 0 otherwise
+ */
+int input_matches(const char *input, const session_question *q)
+{
+    if (strcmp(input, q->code) == 0)
+        return 1;
+
+#if USE_HMM_DECODER
+    int p = active_player;
+    char decoded[HMM_MAX_TEXT];
+    int confidence = morse_hmm_decode(&player_hmm[p], decoded, sizeof(decoded));
+    if (confidence >= HMM_MIN_CONFIDENCE && text_matches(decoded, q->text))
     {
-        // Completed 5 corret questions
-        printf("  ____    _    __  __ _____    ____ ___  __  __ ____  _     _____ _____ _____ \n ");
-        printf("/ ___|  / \\  |  \\/  | ____|  / ___/ _ \\|  \\/  |  _ \\| |   | ____|_   _| ____|\n");
-        printf("| |  _  / _ \\ | |\\/| |  _|   | |  | | | | |\\/| | |_) | |   |  _|   | | |  _| \n");
-        printf("| |_| |/ ___ \\| |  | | |___  | |__| |_| | |  | |  __/| |___| |___  | | | |___ \n");
-        printf(" \\____/_/   \\_\\_|  |_|_____|  \\____\\___/|_|  |_|_|   |_____|_____| |_| |_____|\n\n");
-        wins++;
+        char percent[FMT_MAX_LEN];
+        printf("\nDecoded as %s with %s%% confidence", decoded, fmt_int(percent, confidence, 0));
+        return 1;
     }
-    set_blue_led();
-    game_finished();
+#endif
+
+    return 0;
 }
 
-// -------------------------------------- Inputs --------------------------------------
+// -------------------------------------- Nearest Code Matching --------------------------------------
+
+/*
+ * When an answer is wrong, the input is compared against every letter (levels 1 & 2)
+ * or word (levels 3 & 4) by edit distance (morse_match.c) so the player can be told
+ * what they probably meant and what kind of mistake they made.
+ */
 
 /**
- * @brief Adds an input character to the current input based on the input type.
- *
- * @param input_type The type of input character to add.
- *                   0 - Dot
- *                   1 - Dash
- *                   2 - Space (only if current_level > 2)
- *                   3 - End Of Line (EOL)
+ * @def MATCH_SUGGESTIONS
+ * The number of nearest codes suggested after a wrong answer
+ */
+#define MATCH_SUGGESTIONS 3
+
+match_code letter_codes[SESSION_LETTERS]; /*!< Packed codes of session_letters */
+match_code word_codes[SESSION_WORDS];     /*!< Packed codes of session_words */
+
+/**
+ * @brief Packs the letter and word tables for the nearest code search
  */
+void match_init()
+{
+    for (int i = 0; i < SESSION_LETTERS; i++)
+        match_pack(session_letters[i].code, &letter_codes[i]);
+    for (int i = 0; i < SESSION_WORDS; i++)
+        match_pack(session_words[i].code, &word_codes[i]);
+}
 
-void add_input(int input_type)
+/**
+ * @brief Prints the codes nearest to an answer and the likely mistake
+ *
+ * @param code  The answer as it was keyed
+ * @param words 0 - Search the letters, 1 - Search the words
+ */
+void suggest_nearest(const char *code, int words)
 {
-    if (current_input_length == 100)
+    match_code input;
+    if (!match_pack(code, &input))
         return;
 
-    switch (input_type)
+    const match_code *dict = words ? word_codes : letter_codes;
+    int count = words ? SESSION_WORDS : SESSION_LETTERS;
+
+    // Two letters keyed without the space between them
+    int first, second;
+    if (!words && match_split(letter_codes, SESSION_LETTERS, &input, &first, &second))
     {
-    case 0:
+        printf("Did you mean %c %c? (letters merged)\n", session_letters[first].text[0], session_letters[second].text[0]);
+        return;
+    }
+
+    // One extra result in case the input is itself a (wrong) valid code
+    match_result results[MATCH_SUGGESTIONS + 1];
+    int n = match_nearest(dict, count, &input, results, MATCH_SUGGESTIONS + 1);
+    int shown = 0;
+    for (int i = 0; i < n && shown < MATCH_SUGGESTIONS; i++)
     {
-        // Dot
-        current_input[current_input_length] = '.';
-        printf(".");
-        current_input_length++;
-        break;
+        if (results[i].distance == 0)
+            continue;
+        int index = results[i].index;
+        printf(shown == 0 ? "Did you mean: " : ", ");
+        if (words)
+            printf("%s", session_words[index].text);
+        else
+            printf("%c (%s)", session_letters[index].text[0], session_letters[index].code);
+        if (shown == 0)
+            printf(" [%s]", match_error_name(match_classify(&input, &dict[index])));
+        shown++;
     }
+    if (shown > 0)
+        printf("\n");
+}
+
+// -------------------------------------- Select Level --------------------------------------
+
+/**
+ * @brief Prints the banner at the start of a level
+ *
+ * @param level The level (1 - 4)
+ */
+void print_level_banner(int level)
+{
+    switch (level)
+    {
     case 1:
+        printf("-----------\n");
+        printf("| Level 1 |\n");
+        printf("-----------\n\n");
+        break;
+    case 2:
+        printf("-----------\n");
+        printf("| Level 2 |\n");
+        printf("-----------\n\n");
+        break;
+    case 3:
+        printf("---------------------------------------------------------\n");
+        printf("|                        Level 3                        |\n");
+        printf("| Please enter a space between each letter of the word  |\n");
+        printf("|   Pause for about three dots for a space, or seven    |\n");
+        printf("|    to submit. Key .-.-. (AR) as a letter to submit    |\n");
+        printf("---------------------------------------------------------\n\n");
+        break;
+    case 4:
+        printf("---------------------------------------------------------\n");
+        printf("|                        Level 4                        |\n");
+        printf("| Please enter a space between each letter of the word  |\n");
+        printf("|   Pause for about three dots for a space, or seven    |\n");
+        printf("|    to submit. Key .-.-. (AR) as a letter to submit    |\n");
+        printf("---------------------------------------------------------\n\n");
+        break;
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Prompts for the active player's question, which their session has picked.
+ * Levels 1 and 2 ask for a letter (level 1 shows its code), levels 3 and 4 ask for
+ * a word (level 3 shows its code).
+ */
+void ask_question()
+{
+    const game_session *s = &players.session[active_player];
+    const session_question *q = session_current(s);
+    if (!q)
+        return;
+
+    if (s->level == 1)
+    {
+        printf("-----------------------------------------\n");
+        printf("|\tEnter %s = %s in Morse Code\t|\n", q->text, q->code);
+        printf("-----------------------------------------\n");
+    }
+    else if (s->level == 2)
+    {
+        printf("---------------------------------\n");
+        printf("|\tEnter %s in Morse Code\t|\n", q->text);
+        printf("---------------------------------\n");
+    }
+    else if (s->level == 3)
+    {
+        if(strlen(q->text) < 4){
+            printf("-------------------------------------------------\n");
+            printf("|\tEnter %s = %s in Morse Code\t|\n", q->text, q->code);
+            printf("-------------------------------------------------\n");
+        }
+        else if(strlen(q->text) < 6){
+            printf("---------------------------------------------------------\n");
+            printf("|\tEnter %s = %s in Morse Code\t|\n", q->text, q->code);
+            printf("---------------------------------------------------------\n");
+        } 
+        else if(strlen(q->text) < 8){
+            printf("-----------------------------------------------------------------\n");
+            printf("|\tEnter %s = %s in Morse Code\t|\n", q->text, q->code);
+            printf("-----------------------------------------------------------------\n");
+        }
+        else{
+            printf("-------------------------------------------------------------------------\n");
+            printf("|\tEnter %s = %s in Morse Code\t|\n", q->text, q->code);
+            printf("-------------------------------------------------------------------------\n");
+        }
+    }
+    else if (s->level == 4)
+    {
+        if(strlen(q->text) < 4){
+            printf("---------------------------------\n");
+            printf("|\tEnter %s in Morse Code\t|\n", q->text);
+            printf("---------------------------------\n");
+        }
+        else{
+            printf("-----------------------------------------\n");
+            printf("|\tEnter %s in Morse Code\t|\n", q->text);
+            printf("-----------------------------------------\n");
+        }
+    }
+}
+
+/**
+ * @brief At the end of a level, prints whether the active player finished due to
+ * running out of lives or due to getting 5 answers in a row correct
+ *
+ * @param level The level (1 - 4)
+ */
+void print_level_result(int level)
+{
+    int p = active_player;
+
+    if (players.session[p].lives == 0)
+    {
+        // Ran out of lives
+        printf("YOU LOSE!!!\n");
+    }
+    else
+    {
+        // Completed 5 corret questions
+        if (level == 4)
+        {
+            printf("  ____    _    __  __ _____    ____ ___  __  __ ____  _     _____ _____ _____ \n ");
+            printf("/ ___|  / \\  |  \\/  | ____|  / ___/ _ \\|  \\/  |  _ \\| |   | ____|_   _| ____|\n");
+            printf("| |  _  / _ \\ | |\\/| |  _|   | |  | | | | |\\/| | |_) | |   |  _|   | | |  _| \n");
+            printf("| |_| |/ ___ \\| |  | | |___  | |__| |_| | |  | |  __/| |___| |___  | | | |___ \n");
+            printf(" \\____/_/   \\_\\_|  |_|_____|  \\____\\___/|_|  |_|_|   |_____|_____| |_| |_____|\n\n");
+        }
+        else
+        {
+            printf("YOU WIN!!!\n");
+        }
+    }
+    set_blue_led();
+}
+
+// -------------------------------------- Inputs --------------------------------------
+
+/**
+ * @brief Shows what a player's keying did to their input: the new dot, dash or letter
+ *        space is echoed, and a complete answer ends the line and is posted to the
+ *        player's game task. Only the active player's input is echoed to the console.
+ *
+ * @param p      The player
+ * @param events The SESSION_EV_* bits from session_key() or session_poll()
+ */
+void show_keying(int p, uint32_t events)
+{
+    const game_session *s = &players.session[p];
+    int echo = (p == active_player);
+
+    // A letter space is dropped again if the same timeout completed the answer
+    if ((events & SESSION_EV_ELEMENT) && !(events & SESSION_EV_ANSWER) && echo)
+        putchar(s->input[s->length - 1]);
+
+    if (events & SESSION_EV_ANSWER)
+    {
+        if (echo)
+            printf("\n");
+        sched_post(&sched, game_task_id[p], GAME_EVENT_INPUT);
+    }
+}
+
+// -------------------------------------- Deferred Input Work --------------------------------------
+
+/*
+ * The GPIO interrupt only timestamps each edge and queues it for its player, and
+ * the ALARM0 interrupt only signals that a gap timeout may be due. Everything slow
+ * (classifying the press, show_keying() and its printf, the timeouts, feeding the
+ * watchdog) runs in PendSV at the lowest priority, so an edge is never timestamped
+ * late because other work was in progress.
+ */
+
+/**
+ * @def EVENT_QUEUE_SIZE
+ * The number of input events that can be waiting for the deferred work per player (power of 2)
+ */
+#define EVENT_QUEUE_SIZE 32
+
+/** The input events queued by the interrupts (must match the EVENT_ constants in assign02.S) */
+typedef enum input_event_type
+{
+    EVENT_PRESS,  /*!< Key pressed (falling edge) */
+    EVENT_RELEASE /*!< Key released (rising edge) */
+} input_event_type;
+
+/** Struct defining a single timestamped input event */
+typedef struct input_event
+{
+    uint32_t time_us; /*!< Lower 32 bits of the timer when the event happened */
+    uint32_t type;    /*!< An input_event_type */
+} input_event;
+
+input_event event_queue[NUM_PLAYERS][EVENT_QUEUE_SIZE]; /*!< Events waiting for the deferred work, per player */
+volatile uint32_t event_head[NUM_PLAYERS];              /*!< Total events queued per player (written by gpio_isr) */
+volatile uint32_t event_tail[NUM_PLAYERS];              /*!< Total events processed per player (written by PendSV) */
+uint32_t event_overflows[NUM_PLAYERS];                  /*!< Events dropped because the player's queue was full */
+
+// -------------------------------------- Telemetry --------------------------------------
+
+/*
+ * Dashboards get the session as binary records (telemetry.c) framed between zero bytes
+ * in the same stdio stream as the text, so host/telemetry_decode can split the two from
+ * a pty or a capture instead of parsing the banners. Records are queued wherever they
+ * happen, PendSV included, and the telemetry task writes them out raw (no CR/LF
+ * translation). Every key release is a symbol record, each answer a round and a latency
+ * record, and lives and level are sent whenever game_enter() finds they have changed.
+ */
+
+/** Events posted to the telemetry task */
+enum telemetry_event
+{
+    TELEMETRY_EVENT_QUEUED = 1u << 0 /*!< Records are waiting to be sent */
+};
+
+telemetry_queue telemetry;                  /*!< Records waiting to be sent */
+int telemetry_task_id;                      /*!< Task sending the records */
+uint32_t telemetry_asked_us[NUM_PLAYERS];   /*!< Time each player's current question was asked */
+uint32_t telemetry_edge_worst_us;           /*!< Longest an edge waited for the deferred work since the last latency record */
+int telemetry_lives[NUM_PLAYERS];           /*!< Lives last sent, -1 before the first record */
+int telemetry_level[NUM_PLAYERS];           /*!< Level last sent, -1 before the first record */
+int telemetry_state[NUM_PLAYERS];           /*!< Game state last sent, -1 before the first record */
+
+/**
+ * @brief Queues a record and wakes the telemetry task, from any context
+ *
+ * @param r The record
+ */
+void telemetry_post(const telemetry_record *r)
+{
+#if TELEMETRY
+    // PendSV queues records too, so it is kept out of a push from the game task
+    uint32_t irq = save_and_disable_interrupts();
+    telemetry_push(&telemetry, r);
+    restore_interrupts(irq);
+    sched_post(&sched, telemetry_task_id, TELEMETRY_EVENT_QUEUED);
+#else
+    (void)r;
+#endif
+}
+
+/**
+ * @brief Notes how long an edge waited for the deferred work, called from PendSV
+ *
+ * @param time_us The time of the edge
+ */
+void telemetry_edge_wait(uint32_t time_us)
+{
+    uint32_t wait = time_us_32() - time_us;
+    if (wait > telemetry_edge_worst_us)
+        telemetry_edge_worst_us = wait;
+}
+
+/**
+ * @brief Sends a player's lives, level and state if they have changed since last sent,
+ *        and starts timing the answer when a question is asked
+ *
+ * @param p The player
+ */
+void telemetry_game(int p)
+{
+    const game_session *s = &players.session[p];
+    uint32_t now = time_us_32();
+    if (s->lives != telemetry_lives[p])
+    {
+        telemetry_lives[p] = s->lives;
+        telemetry_post(&(telemetry_record){now, TELEMETRY_LIVES, p, 1, {s->lives}});
+    }
+    if (s->level != telemetry_level[p] || (int)players.state[p] != telemetry_state[p])
+    {
+        telemetry_level[p] = s->level;
+        telemetry_state[p] = players.state[p];
+        telemetry_post(&(telemetry_record){now, TELEMETRY_LEVEL, p, 2, {s->level, players.state[p]}});
+    }
+    if (players.state[p] == GAME_QUESTION)
+        telemetry_asked_us[p] = now;
+}
+
+/**
+ * @brief Sends the result of a player's answer and how quickly it was handled. The
+ *        input was completed by the gap timeout at the player's deadline.
+ *
+ * @param p        The player
+ * @param correct  1 - The answer was accepted
+ * @param question Index of the question that was answered
+ */
+void telemetry_round(int p, int correct, int question)
+{
+    const game_session *s = &players.session[p];
+    uint32_t now = time_us_32();
+    uint32_t completed = s->deadline_us;
+    uint32_t dropped = 0;
+    for (int i = 0; i < NUM_PLAYERS; i++)
+        dropped += event_overflows[i];
+
+    telemetry_post(&(telemetry_record){now, TELEMETRY_ROUND, p, 6,
+                                       {s->level, question, correct, s->lives, s->remaining,
+                                        completed - telemetry_asked_us[p]}});
+    telemetry_post(&(telemetry_record){now, TELEMETRY_LATENCY, p, 3,
+                                       {now - completed, telemetry_edge_worst_us, dropped}});
+    telemetry_edge_worst_us = 0;
+}
+
+/**
+ * @brief Telemetry task, writes out the queued records
+ */
+void telemetry_task(void *ctx, uint32_t events)
+{
+    (void)ctx;
+    (void)events;
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    int len;
+    while ((len = telemetry_next(&telemetry, frame)) > 0)
+    {
+        for (int i = 0; i < len; i++)
+            putchar_raw(frame[i]);
+    }
+}
+
+/**
+ * @brief Adds the telemetry task, the first records sent will be every player's lives and level
+ */
+void telemetry_init_task()
+{
+    telemetry_init(&telemetry);
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        telemetry_lives[p] = -1;
+        telemetry_level[p] = -1;
+        telemetry_state[p] = -1;
+    }
+    telemetry_task_id = sched_add(&sched, telemetry_task, NULL, "telemetry");
+}
+
+// -------------------------------------- Edge Capture --------------------------------------
+
+/*
+ * Every press and release is kept (edge_log.c), so a disputed verdict can be
+ * replayed exactly as it was keyed. The edges are recorded by PendSV in time order
+ * as it drains the queues, which adds nothing to the GPIO interrupt, and the new
+ * part of the log is streamed over stdio at the end of each level as #EDGES lines
+ * for host/edge_replay to decode.
+ */
+
+/**
+ * @def EDGE_LOG_SIZE
+ * Bytes of SRAM kept for the edge log (power of 2). At 2 to 3 bytes an edge it holds
+ * about 1,500 to 2,000 edges, around 3 minutes of continuous keying at 20 WPM. With
+ * EDGE_LOG_STREAM each level, a few hundred edges, is streamed off well before it wraps
+ */
+#define EDGE_LOG_SIZE 4096
+
+/**
+ * @def EDGE_LOG_SHIFT
+ * The edges are timed to 2^EDGE_LOG_SHIFT microseconds (64 us), most edges then take 2 bytes
+ */
+#define EDGE_LOG_SHIFT 6
+
+/**
+ * @def EDGE_LOG_PLAYER_BITS
+ * Bits needed for the largest player number
+ */
+#define EDGE_LOG_PLAYER_BITS (NUM_PLAYERS > 8 ? 4 : NUM_PLAYERS > 4 ? 3 : NUM_PLAYERS > 2 ? 2 : NUM_PLAYERS > 1 ? 1 : 0)
+
+/**
+ * @def EDGE_LOG_STREAM
+ * 1 - Stream the new edges at the end of each level, 0 - Keep them in SRAM only
+ */
+#define EDGE_LOG_STREAM 1
+
+/**
+ * @def EDGE_LOG_LINE
+ * Bytes of encoded edges per #EDGES line
+ */
+#define EDGE_LOG_LINE 32
+
+uint8_t edge_log_buf[EDGE_LOG_SIZE]; /*!< Storage for the encoded edges */
+edge_log edges;                      /*!< The edge log, written by PendSV */
+edge_cursor edges_streamed;          /*!< How far the log has been streamed */
+
+/**
+ * @brief Starts an empty edge log
+ */
+void edge_capture_init()
+{
+    edge_log_init(&edges, edge_log_buf, EDGE_LOG_SIZE, EDGE_LOG_SHIFT, EDGE_LOG_PLAYER_BITS, time_us_32());
+    edge_log_rewind(&edges, &edges_streamed);
+}
+
+/**
+ * @brief Prints the edges recorded since the last stream as lines of
+ *        "#EDGES <shift> <player bits> <start time> <bytes lost> <hex records>"
+ */
+void edge_capture_stream()
+{
+    uint8_t chunk[EDGE_LOG_LINE];
+    edge_cursor start;
+    uint32_t lost;
+
+    while (1)
+    {
+        // PendSV writes the log, so copy each chunk out with it held off
+        uint32_t irq = save_and_disable_interrupts();
+        int len = edge_log_read(&edges, &edges_streamed, chunk, sizeof(chunk), &start, &lost);
+        restore_interrupts(irq);
+
+        if (len == 0 && lost == 0)
+            break;
+
+        char shift[FMT_MAX_LEN], bits[FMT_MAX_LEN], time_q[FMT_MAX_LEN], dropped[FMT_MAX_LEN], hex[FMT_MAX_LEN];
+        printf("#EDGES %s %s %s %s ", fmt_uint(shift, EDGE_LOG_SHIFT, 0), fmt_uint(bits, EDGE_LOG_PLAYER_BITS, 0),
+               fmt_hex(time_q, start.time_q, 8), fmt_uint(dropped, lost, 0));
+        for (int i = 0; i < len; i++)
+            printf("%s", fmt_hex(hex, chunk[i], 2));
+        printf("\n");
+    }
+}
+
+// -------------------------------------- Post-Mortem --------------------------------------
+
+/*
+ * Only key presses feed the watchdog, so a player who stops to think for too long
+ * resets the board. The game state is checkpointed into RAM that the runtime
+ * doesn't clear at boot, with its CRC in the watchdog scratch registers (which
+ * survive a watchdog reset but not a power cycle), and the last few edges are kept
+ * alongside it. After a watchdog reset a valid checkpoint is restored and the
+ * session carries on where it was, without the welcome banners.
+ *
+ * Scratch registers 4 - 7 belong to the SDK's watchdog_reboot(), 0 - 2 are used here.
+ */
+
+/**
+ * @def CHECKPOINT_MAGIC
+ * Marks a checkpoint written by this firmware ("MRS" and a layout version)
+ */
+#define CHECKPOINT_MAGIC 0x4D525301
+
+/**
+ * @def TRACE_TAIL_SIZE
+ * The number of most recent edges kept with the checkpoint (power of 2)
+ */
+#define TRACE_TAIL_SIZE 16
+
+/** Struct defining the part of a player's state that is checkpointed */
+typedef struct player_checkpoint
+{
+    uint32_t unit_us;
+    uint16_t wins;
+    uint16_t right_input;
+    uint16_t wrong_input;
+    uint8_t state;
+    uint8_t level;
+    uint8_t lives;
+    uint8_t remaining;
+    uint8_t char_to_solve;
+    uint8_t quit;
+} player_checkpoint;
+
+/** Struct defining a checkpoint of every player's game */
+typedef struct checkpoint
+{
+    uint32_t magic;    /*!< CHECKPOINT_MAGIC */
+    uint32_t sequence; /*!< Number of checkpoints written this session */
+    uint32_t resets;   /*!< Resets the session has survived */
+    player_checkpoint player[NUM_PLAYERS];
+    uint32_t crc;      /*!< CRC-32 of everything above */
+} checkpoint;
+
+/** Struct defining the most recent edges before a reset */
+typedef struct trace_tail
+{
+    uint32_t magic; /*!< CHECKPOINT_MAGIC once the tail has been started */
+    uint32_t count; /*!< Total edges recorded */
+    input_event event[TRACE_TAIL_SIZE];
+    uint8_t player[TRACE_TAIL_SIZE];
+} trace_tail;
+
+checkpoint __uninitialized_ram(saved_game);  /*!< Checkpoint, kept across resets */
+trace_tail __uninitialized_ram(saved_trace); /*!< Recent edges, kept across resets */
+
+/**
+ * @brief Bitwise CRC-32 (IEEE), the checkpoint is small enough not to need a table
+ */
+uint32_t crc32(const void *data, uint32_t len)
+{
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--)
+    {
+        crc ^= *bytes++;
+        for (int i = 0; i < 8; i++)
+            crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Describes what caused the last reset
+ */
+const char *reset_reason()
+{
+    if (watchdog_enable_caused_reboot())
+        return "watchdog timeout";
+    if (watchdog_caused_reboot())
+        return "watchdog reboot";
+
+    uint32_t chip_reset = vreg_and_chip_reset_hw->chip_reset;
+    if (chip_reset & VREG_AND_CHIP_RESET_CHIP_RESET_HAD_PSM_RESTART_BITS)
+        return "debugger";
+    if (chip_reset & VREG_AND_CHIP_RESET_CHIP_RESET_HAD_RUN_BITS)
+        return "RUN pin";
+    return "power on";
+}
+
+/**
+ * @brief Records an edge in the trace tail, called by PendSV for every edge
+ */
+void postmortem_trace(int p, const input_event *ev)
+{
+    uint32_t i = saved_trace.count % TRACE_TAIL_SIZE;
+    saved_trace.event[i] = *ev;
+    saved_trace.player[i] = p;
+    saved_trace.count++;
+}
+
+/**
+ * @brief Checkpoints every player's game, called after each game state change
+ */
+void postmortem_checkpoint()
+{
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        const game_session *s = &players.session[p];
+        player_checkpoint *c = &saved_game.player[p];
+        c->unit_us = s->unit_us;
+        c->wins = s->wins;
+        c->right_input = s->right;
+        c->wrong_input = s->wrong;
+        c->state = players.state[p];
+        c->level = s->level;
+        c->lives = s->lives;
+        c->remaining = s->remaining;
+        c->char_to_solve = s->target;
+        c->quit = s->phase == SESSION_QUIT;
+    }
+    saved_game.magic = CHECKPOINT_MAGIC;
+    saved_game.sequence++;
+    saved_game.crc = crc32(&saved_game, offsetof(checkpoint, crc));
+
+    watchdog_hw->scratch[0] = CHECKPOINT_MAGIC;
+    watchdog_hw->scratch[1] = saved_game.crc;
+    watchdog_hw->scratch[2] = saved_game.sequence;
+}
+
+/**
+ * @brief Prints the edges recorded before the reset, relative to the last one
+ */
+void postmortem_print_trace()
+{
+    if (saved_trace.magic != CHECKPOINT_MAGIC || saved_trace.count == 0)
+        return;
+
+    uint32_t n = saved_trace.count < TRACE_TAIL_SIZE ? saved_trace.count : TRACE_TAIL_SIZE;
+    uint32_t last = saved_trace.event[(saved_trace.count - 1) % TRACE_TAIL_SIZE].time_us;
+    char player[FMT_MAX_LEN], ago[FMT_MAX_LEN];
+    printf("Last %s edges (ms before the last):", fmt_uint(ago, n, 0));
+    for (uint32_t k = saved_trace.count - n; k != saved_trace.count; k++)
+    {
+        const input_event *ev = &saved_trace.event[k % TRACE_TAIL_SIZE];
+        printf(" %c%s@-%s", ev->type == EVENT_PRESS ? 'P' : 'R',
+               fmt_uint(player, saved_trace.player[k % TRACE_TAIL_SIZE], 0),
+               fmt_uint(ago, (last - ev->time_us) / 1000, 0));
+    }
+    printf("\n");
+}
+
+/**
+ * @brief Reports the reset reason and, after a watchdog reset with a valid checkpoint,
+ *        restores every player's game
+ *
+ * @return int 1 if the session was restored, 0 if this is a fresh start
+ */
+int postmortem_init()
+{
+    int valid = watchdog_caused_reboot() &&
+                watchdog_hw->scratch[0] == CHECKPOINT_MAGIC &&
+                saved_game.magic == CHECKPOINT_MAGIC &&
+                watchdog_hw->scratch[1] == saved_game.crc &&
+                crc32(&saved_game, offsetof(checkpoint, crc)) == saved_game.crc;
+
+    printf("Reset reason: %s\n", reset_reason());
+
+    if (!valid)
+    {
+        memset(&saved_game, 0, sizeof(saved_game));
+        memset(&saved_trace, 0, sizeof(saved_trace));
+        saved_trace.magic = CHECKPOINT_MAGIC;
+        return 0;
+    }
+
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        const player_checkpoint *c = &saved_game.player[p];
+        game_session *s = &players.session[p];
+        s->unit_us = c->unit_us;
+        s->wins = c->wins;
+        s->right = c->right_input;
+        s->wrong = c->wrong_input;
+        players.state[p] = c->state < GAME_STATE_COUNT ? c->state : GAME_SELECT;
+        s->level = c->level <= 4 ? c->level : 0;
+        s->lives = c->lives;
+        s->remaining = c->remaining;
+
+        // The session's phase follows the state, a level that didn't survive goes back to the
+        // select and an interrupted question is replaced by a new one
+        if (c->quit)
+            s->phase = SESSION_QUIT;
+        else if (s->level == 0 && (players.state[p] == GAME_QUESTION || players.state[p] == GAME_REPLAY))
+            players.state[p] = GAME_SELECT;
+        else if (players.state[p] == GAME_QUESTION)
+        {
+            s->phase = SESSION_QUESTION;
+            session_skip(s);
+        }
+        else if (players.state[p] == GAME_REPLAY)
+            s->phase = SESSION_REPLAY;
+    }
+    saved_game.resets++;
+
+    char resets[FMT_MAX_LEN], sequence[FMT_MAX_LEN];
+    printf("Session resumed after %s reset(s), checkpoint %s\n", fmt_uint(resets, saved_game.resets, 0),
+           fmt_uint(sequence, saved_game.sequence, 0));
+    postmortem_print_trace();
+    return 1;
+}
+
+// -------------------------------------- Transcription --------------------------------------
+
+/*
+ * Free keying: selecting ----- at the level select decodes whatever the player keys into
+ * text as they go, for as long as they like (transcribe.c). Marks are classified against
+ * the player's own recent dots and dashes instead of SESSION_LONG_PRESS_US, so any speed
+ * works, and the gap timeouts follow the same unit. PendSV only adds to the decoder's rings and the
+ * game task prints the new text behind it, ending each line with the live speed, so
+ * nothing grows however long the session runs. Keying SK (...-.-) finishes.
+ */
+
+/**
+ * @def TRANSCRIBE_SELECT
+ * The level select input that starts free keying
+ */
+#define TRANSCRIBE_SELECT "-----"
+
+/**
+ * @def TRANSCRIBE_EXIT_CODE
+ * The SK (end of contact) prosign, finishes free keying
+ */
+#define TRANSCRIBE_EXIT_CODE "...-.-"
+
+/**
+ * @def TRANSCRIBE_EXIT
+ * The character SK decodes to
+ */
+#define TRANSCRIBE_EXIT '\x04'
+
+/**
+ * @def TRANSCRIBE_LINE
+ * Characters printed before the line is ended (at the next space) with the speed
+ */
+#define TRANSCRIBE_LINE 48
+
+transcriber player_transcriber[NUM_PLAYERS]; /*!< Each player's free keying decoder */
+uint32_t transcript_cursor[NUM_PLAYERS];     /*!< Characters of each transcript printed so far */
+int transcript_column[NUM_PLAYERS];          /*!< Characters on each player's current line */
+
+/**
+ * @brief Loads the morse code character table and SK into every player's decoder
+ */
+void transcription_init()
+{
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        transcribe_init(&player_transcriber[p]);
+        for (int i = 0; i < SESSION_LETTERS; i++)
+            transcribe_add_code(&player_transcriber[p], session_letters[i].text[0], session_letters[i].code);
+        transcribe_add_code(&player_transcriber[p], TRANSCRIBE_EXIT, TRANSCRIBE_EXIT_CODE);
+    }
+}
+
+/**
+ * @brief Starts a player's free keying session
+ *
+ * @param p       The player
+ * @param unit_us The unit to assume until they have keyed some dots and dashes
+ */
+void transcription_start(int p, uint32_t unit_us)
+{
+    transcribe_reset(&player_transcriber[p], unit_us);
+    transcript_cursor[p] = 0;
+    transcript_column[p] = 0;
+
+    printf("\n\t*****************************\n");
+    printf("\t*        FREE KEYING        *\n");
+    printf("\t*  Key anything at any speed *\n");
+    printf("\t*  Key ...-.- (SK) to finish *\n");
+    printf("\t*****************************\n\n");
+}
+
+/**
+ * @brief Prints the live speed at the end of a transcript line
+ *
+ * @param p The player
+ */
+void transcription_speed(int p)
+{
+    const transcriber *t = &player_transcriber[p];
+    uint32_t cpm = transcribe_cpm(t, time_us_32());
+    char chars[FMT_MAX_LEN], words[FMT_MAX_LEN], keying[FMT_MAX_LEN];
+    printf("   [%s CPM, %s WPM, keying at %s WPM]\n", fmt_uint(chars, cpm, 0), fmt_uint(words, cpm / 5, 0),
+           fmt_uint(keying, 1200000 / transcribe_unit(t), 0));
+    transcript_column[p] = 0;
+}
+
+/**
+ * @brief Prints the text a player's decoder has added since the last call
+ *
+ * @param p The player
+ * @return int 1 if the player keyed SK, 0 otherwise
+ */
+int transcription_show(int p)
+{
+    char text[32], value[FMT_MAX_LEN], unknown[FMT_MAX_LEN];
+    uint32_t lost;
+    int n;
+    while ((n = transcribe_read(&player_transcriber[p], &transcript_cursor[p], text, sizeof(text), &lost)) > 0)
+    {
+        if (lost)
+            printf("[%s lost]", fmt_uint(value, lost, 0));
+        for (int i = 0; i < n; i++)
+        {
+            if (text[i] == TRANSCRIBE_EXIT)
+            {
+                transcription_speed(p);
+                printf("%s characters, %s unknown\n", fmt_uint(value, transcript_cursor[p], 0),
+                       fmt_uint(unknown, player_transcriber[p].unknown, 0));
+                return 1;
+            }
+            putchar(text[i]);
+            if (text[i] == ' ' && ++transcript_column[p] >= TRANSCRIBE_LINE)
+                transcription_speed(p);
+            else if (text[i] != ' ')
+                transcript_column[p]++;
+        }
+    }
+    return 0;
+}
+
+// -------------------------------------- Speed Run --------------------------------------
+
+/*
+ * Keying -.... at the level select turns speed run mode on (or off). Each question is
+ * timed from when it has been printed, read from the 64-bit timer, to the first press
+ * of the answer and from there to its last release. Those two are the edge timestamps
+ * gpio_isr takes anyway, the lower 32 bits of the same timer, extended against the
+ * prompt time, so timing adds nothing to the input path beyond keeping the first
+ * press. A round's time is the sum of the two, plus SPEEDRUN_PENALTY_US if the answer
+ * was wrong, and a won level's time is the sum of its rounds. The best time of each
+ * level is kept for the session. Times are printed to the microsecond.
+ */
+
+/**
+ * @def SPEEDRUN_SELECT
+ * The level select input that turns speed run mode on or off
+ */
+#define SPEEDRUN_SELECT "-...."
+
+/**
+ * @def SPEEDRUN_PENALTY_US
+ * Time added to the level for every wrong answer
+ */
+#define SPEEDRUN_PENALTY_US 5000000
+
+uint8_t speedrun_on[NUM_PLAYERS];            /*!< 1 - The player's levels are timed */
+uint64_t speedrun_prompt_us[NUM_PLAYERS];    /*!< Time the current question was printed */
+uint64_t speedrun_level_us[NUM_PLAYERS];     /*!< Time of the current level so far, penalties included */
+uint64_t speedrun_best_us[NUM_PLAYERS][5];   /*!< Best time of each level (1 - 4), 0 if not won yet */
+
+/**
+ * @brief Extends a 32-bit edge timestamp to 64 bits, against a nearby 64-bit time
+ *
+ * @param ref_us  A 64-bit time within 35 minutes of the edge
+ * @param edge_us The lower 32 bits of the timer at the edge
+ */
+uint64_t speedrun_extend(uint64_t ref_us, uint32_t edge_us)
+{
+    return ref_us + (int64_t)(int32_t)(edge_us - (uint32_t)ref_us);
+}
+
+/**
+ * @brief Formats a time in seconds to the microsecond
+ *
+ * @return char* out
+ */
+char *speedrun_seconds(char *out, uint64_t us)
+{
+    return fmt_fixed(out, us > UINT32_MAX ? UINT32_MAX : (uint32_t)us, 1000000, 6, 0);
+}
+
+/**
+ * @brief Turns speed run mode on or off for the active player
+ */
+void speedrun_toggle()
+{
+    int p = active_player;
+    speedrun_on[p] ^= 1;
+    printf("Speed run %s\n", speedrun_on[p] ? "on" : "off");
+}
+
+/**
+ * @brief Starts timing a level
+ */
+void speedrun_start(int p)
+{
+    speedrun_level_us[p] = 0;
+}
+
+/**
+ * @brief Marks the current question as shown, once it has been printed
+ */
+void speedrun_prompt(int p)
+{
+    speedrun_prompt_us[p] = time_us_64();
+}
+
+/**
+ * @brief Scores the answer just checked and prints its times
+ *
+ * @param correct 1 - The answer was right
+ */
+void speedrun_round(int p, int correct)
+{
+    if (!speedrun_on[p])
+        return;
+
+    // Keys pressed (or whole answers keyed) while the question was still printing count
+    // as instant, so neither time can go negative
+    uint64_t prompt = speedrun_prompt_us[p];
+    uint64_t first = speedrun_extend(prompt, players.first_press[p]);
+    uint64_t last = speedrun_extend(prompt, players.session[p].release_us);
+    if (first < prompt)
+        first = prompt;
+    if (last < first)
+        last = first;
+    uint64_t round = last - prompt + (correct ? 0 : SPEEDRUN_PENALTY_US);
+    speedrun_level_us[p] += round;
+
+    char reaction[FMT_MAX_LEN], keying[FMT_MAX_LEN], total[FMT_MAX_LEN];
+    printf("First press %s s, keying %s s, round %s s%s\n", speedrun_seconds(reaction, first - prompt),
+           speedrun_seconds(keying, last - first), speedrun_seconds(total, round), correct ? "" : " (penalty)");
+}
+
+/**
+ * @brief Prints the level's time at the end of a level, and keeps it if it is a best
+ */
+void speedrun_level_end(int p)
+{
+    if (!speedrun_on[p])
+        return;
+
+    int level = players.session[p].level;
+    char number[FMT_MAX_LEN], time[FMT_MAX_LEN], best[FMT_MAX_LEN];
+    fmt_int(number, level, 0);
+    if (players.session[p].lives == 0 || level < 1 || level > 4)
+    {
+        printf("Speed run: level %s not finished\n", number);
+        return;
+    }
+
+    uint64_t *best_us = &speedrun_best_us[p][level];
+    if (*best_us == 0 || speedrun_level_us[p] < *best_us)
+    {
+        printf("Speed run: level %s in %s s, NEW BEST", number, speedrun_seconds(time, speedrun_level_us[p]));
+        if (*best_us)
+            printf(", was %s s", speedrun_seconds(best, *best_us));
+        printf("\n");
+        *best_us = speedrun_level_us[p];
+    }
+    else
+    {
+        printf("Speed run: level %s in %s s, best %s s\n", number, speedrun_seconds(time, speedrun_level_us[p]),
+               speedrun_seconds(best, *best_us));
+    }
+}
+
+// -------------------------------------- Gap Classification --------------------------------------
+
+/*
+ * Morse spacing is relative to the dot length (one unit): elements of a letter
+ * are separated by 1 unit, letters by 3 and words by 7. The unit is estimated
+ * continuously from each player's own dots and dashes, and the release time is
+ * classified against the midpoints between those spacings. A timeout is set on
+ * every release to fire at each boundary in turn, so a letter space is inserted
+ * and the answer submitted as soon as the gap is long enough, instead of after
+ * fixed one second timeouts. Every player has their own deadline and ALARM0 is
+ * always set for the earliest.
+ *
+ * The classification and the timeouts are the player's game_session (session_key()
+ * and session_poll()), this section feeds it the key events and the HMM decoder the
+ * same durations. Free keying is timed here instead, against the transcriber's unit.
+ */
+
+/**
+ * @brief Sets a free keying player's gap timeout
+ *
+ * @param p     The player
+ * @param from  The time to count from
+ * @param units The number of the transcriber's units after from
+ */
+void set_gap_deadline(int p, uint32_t from, uint32_t units)
+{
+    players.deadline[p] = from + units * transcribe_unit(&player_transcriber[p]);
+    players.deadline_armed[p] = 1;
+}
+
+/**
+ * @brief Queues an input event for a player. Called from gpio_isr and audio_dma_isr,
+ *        which run at the same priority and so never interrupt each other. Anything
+ *        else pushing has to mask interrupts first.
+ *
+ * @param p       The player
+ * @param type    The input_event_type
+ * @param time_us The timestamp of the event
+ */
+void __not_in_flash_func(asm_event_push)(uint32_t p, uint32_t type, uint32_t time_us)
+{
+    uint32_t head = event_head[p];
+    if (head - event_tail[p] < EVENT_QUEUE_SIZE)
+    {
+        input_event *ev = &event_queue[p][head % EVENT_QUEUE_SIZE];
+        ev->time_us = time_us;
+        ev->type = type;
+        event_head[p] = head + 1;
+    }
+    else
+    {
+        event_overflows[p]++;
+    }
+
+    scb_hw->icsr = M0PLUS_ICSR_PENDSVSET_BITS;
+}
+
+/**
+ * @brief Handles a free keying player's key event, the decoder classifies the press
+ *
+ * @param p  The player
+ * @param ev The event to process
+ */
+void transcription_event(int p, const input_event *ev)
+{
+    if (ev->type == EVENT_PRESS)
+    {
+        players.key_down[p] = 1;
+        players.press_time[p] = ev->time_us;
+        players.alarm_run[p] = 0;
+        players.deadline_armed[p] = 0;
+        return;
+    }
+
+    // The decoder tracks the player's speed, and the gaps are timed with it
+    uint32_t duration = ev->time_us - players.press_time[p];
+    players.key_down[p] = 0;
+    transcribe_mark(&player_transcriber[p], duration);
+    telemetry_post(&(telemetry_record){ev->time_us, TELEMETRY_SYMBOL, p, 2, {duration, 2}});
+    players.alarm_run[p] = 0;
+    set_gap_deadline(p, ev->time_us, SESSION_GAP_LETTER_UNITS);
+}
+
+/**
+ * @brief Turns a player's key event into dots and dashes through their session, which
+ *        starts timing the gaps
+ *
+ * @param p  The player
+ * @param ev The event to process
+ */
+void process_input_event(int p, const input_event *ev)
+{
+    game_session *s = &players.session[p];
+
+    arm_watchdog_update();
+    if (players.state[p] == GAME_TRANSCRIBE)
+    {
+        transcription_event(p, ev);
+        return;
+    }
+
+    // Keys are ignored while an answer waits for the game task
+    if (s->complete)
+        return;
+
+    switch (ev->type)
+    {
+    case EVENT_PRESS:
+        // The gap since the last element of this input, or the start of a new one
+        if (s->length > 0)
+            morse_hmm_gap(&player_hmm[p], ev->time_us - s->release_us);
+        else
+        {
+            players.first_press[p] = ev->time_us;
+            morse_hmm_reset(&player_hmm[p], session_unit(s));
+        }
+        session_key(s, 1, ev->time_us);
+        break;
+    case EVENT_RELEASE:
+    {
+        if (!s->key_down)
+            break;
+        uint32_t duration = ev->time_us - s->press_us;
+        morse_hmm_mark(&player_hmm[p], duration);
+        telemetry_post(&(telemetry_record){ev->time_us, TELEMETRY_SYMBOL, p, 2,
+                                           {duration, duration >= SESSION_LONG_PRESS_US}});
+        show_keying(p, session_key(s, 0, ev->time_us));
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+/**
+ * @brief Handles a free keying player's gap timeout: the letter gap ends the letter and
+ *        the word gap adds a space, then the game task is told to print them
+ *
+ * @param p The player
+ */
+void transcription_timeout(int p)
+{
+    if (players.key_down[p])
+        return;
+
+    if (players.alarm_run[p])
+    {
+        players.alarm_run[p] = 0;
+        transcribe_space(&player_transcriber[p], players.deadline[p]);
+    }
+    else
+    {
+        players.alarm_run[p] = 1;
+        if (!transcribe_letter(&player_transcriber[p], players.deadline[p]))
+            return;
+        set_gap_deadline(p, players.deadline[p], SESSION_GAP_WORD_UNITS - SESSION_GAP_LETTER_UNITS);
+    }
+    sched_post(&sched, game_task_id[p], GAME_EVENT_TEXT);
+}
+
+/**
+ * @brief Runs a player's gap timeouts that are due
+ *
+ * @param p   The player
+ * @param now The current time
+ */
+void process_timeout(int p, uint32_t now)
+{
+    if (players.state[p] != GAME_TRANSCRIBE)
+    {
+        show_keying(p, session_poll(&players.session[p], now));
+        return;
+    }
+    if (players.deadline_armed[p] && (int32_t)(now - players.deadline[p]) >= 0)
+    {
+        players.deadline_armed[p] = 0;
+        transcription_timeout(p);
+    }
+}
+
+/**
+ * @brief Gets when a player's next gap timeout is due
+ *
+ * @param p  The player
+ * @param at Set to the time, if there is one
+ * @return int 1 if a timeout is due at at, 0 if none is until the next key
+ */
+int player_deadline(int p, uint32_t *at)
+{
+    if (players.state[p] != GAME_TRANSCRIBE)
+        return session_deadline(&players.session[p], at);
+    *at = players.deadline[p];
+    return players.deadline_armed[p];
+}
+
+/**
+ * @brief Runs every gap timeout that is due and sets ALARM0 for the earliest one left,
+ *        or the scheduler's wake up if that is sooner
+ */
+void process_timeouts()
+{
+    uint32_t now = time_us_32();
+    uint32_t target = 0;
+    int armed = 0;
+
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        uint32_t at;
+        process_timeout(p, now);
+        if (player_deadline(p, &at) && (!armed || (int32_t)(at - target) < 0))
+        {
+            target = at;
+            armed = 1;
+        }
+    }
+
+    // A wake up that has passed has done its job, this interrupt ended the main loop's sleep
+    if (sched_wake_armed)
+    {
+        if ((int32_t)(now - sched_wake_at) >= 0)
+            sched_wake_armed = 0;
+        else if (!armed || (int32_t)(sched_wake_at - target) < 0)
+        {
+            target = sched_wake_at;
+            armed = 1;
+        }
+    }
+
+    if (!armed)
+        return;
+
+    set_alarm_at(target);
+
+    // If the deadline passed while we were busy the alarm won't fire, so run again
+    if ((int32_t)(time_us_32() - target) >= 0)
+        scb_hw->icsr = M0PLUS_ICSR_PENDSVSET_BITS;
+}
+
+/**
+ * @brief Finds the player whose oldest queued event happened first
+ *
+ * @return int The player, or -1 if every queue is empty
+ */
+int next_event_player()
+{
+    int next = -1;
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        if (event_tail[p] == event_head[p])
+            continue;
+        if (next < 0 || (int32_t)(event_queue[p][event_tail[p] % EVENT_QUEUE_SIZE].time_us -
+                                  event_queue[next][event_tail[next] % EVENT_QUEUE_SIZE].time_us) < 0)
+            next = p;
+    }
+    return next;
+}
+
+/**
+ * @brief PendSV handler, drains the event queues in time order (recording each edge)
+ *        and runs the gap timeouts at the lowest priority
+ */
+void pendsv_isr()
+{
+    if (deferred_hold)
+        return;
+
+    irq_nest_enter();
+    int p;
+    while ((p = next_event_player()) >= 0)
     {
-        // Dash
-        current_input[current_input_length] = '-';
-        printf("-");
-        current_input_length++;
-        break;
+        input_event ev = event_queue[p][event_tail[p] % EVENT_QUEUE_SIZE];
+        event_tail[p]++;
+        edge_log_add(&edges, p, ev.type == EVENT_RELEASE, ev.time_us);
+        telemetry_edge_wait(ev.time_us);
+        postmortem_trace(p, &ev);
+        process_input_event(p, &ev);
     }
-    case 2:
+    process_timeouts();
+    irq_nest_exit();
+}
+
+// -------------------------------------- Key Debounce --------------------------------------
+
+/*
+ * A worn or bouncy key makes a burst of edges at every press and release, each of
+ * which used to be queued as a key event of its own. Now the first edge of a burst is
+ * timestamped by gpio_isr as before and queued for the key, and ALARM1 is pended. Its
+ * handler masks the key's edge interrupts and sets the alarm for KEY_MIN_PULSE_US after
+ * the edge, so gpio_isr itself still only timestamps and enqueues. When the alarm fires
+ * the key's level decides: if it has changed the edge is queued with its original
+ * timestamp, so the timing is as accurate as before and only arrives KEY_MIN_PULSE_US
+ * later, and if it is back where it was the pulse was a glitch and is dropped. Either
+ * way the key is unmasked again. However bad the switch, each key takes about one GPIO
+ * and two ALARM1 interrupts per KEY_MIN_PULSE_US, which is all a clean press or release
+ * takes.
+ *
+ * Both handlers run from RAM, so the masking writes the IO_BANK0 registers through
+ * their set and clear aliases instead of calling the SDK's GPIO functions from flash.
+ *
+ * A PIO filter would need a program and a state machine of its own: PIO0 has four, of
+ * which the WS2812 holds 0 and Morse transmit 1 (MORSE_TX_SM), leaving 2 and 3. The
+ * masking needs neither and keeps the original edge times.
+ */
+
+/**
+ * @def KEY_IRQ_EDGES
+ * The edge interrupts of a pin, in its nibble of the IO_BANK0 INTR and INTE registers
+ */
+#define KEY_IRQ_EDGES (GPIO_IRQ_EDGE_FALL | GPIO_IRQ_EDGE_RISE)
+
+uint8_t key_level[NUM_PLAYERS];       /*!< Debounced level of each key, 1 - Released (pulled up), 0 - Pressed */
+uint8_t key_queued[NUM_PLAYERS];      /*!< 1 - gpio_isr has queued an edge for ALARM1 to mask the key on */
+uint8_t key_masked[NUM_PLAYERS];      /*!< 1 - The key's edge interrupts are masked while it settles */
+uint32_t key_edge_us[NUM_PLAYERS];    /*!< Time of the edge that started the key settling */
+uint32_t key_settle_us[NUM_PLAYERS];  /*!< Time the key has settled and is checked */
+uint32_t key_irqs[NUM_PLAYERS];       /*!< Edge interrupts taken per key */
+uint32_t key_accepted[NUM_PLAYERS];   /*!< Edges queued per key */
+uint32_t key_glitches[NUM_PLAYERS];   /*!< Pulses shorter than KEY_MIN_PULSE_US rejected per key */
+
+/**
+ * @brief Takes every key as released until main_asm() has set the pins up
+ */
+void key_debounce_init()
+{
+    for (int p = 0; p < NUM_PLAYERS; p++)
+        key_level[p] = 1;
+}
+
+/**
+ * @brief Masks a key's edge interrupts and starts it settling
+ *
+ * @param p       The player
+ * @param time_us The time of the edge
+ */
+static inline void key_mask(int p, uint32_t time_us)
+{
+    uint pin = player_pins[p];
+    hw_clear_bits(&iobank0_hw->proc0_irq_ctrl.inte[pin / 8], KEY_IRQ_EDGES << 4 * (pin % 8));
+    key_masked[p] = 1;
+    key_edge_us[p] = time_us;
+    key_settle_us[p] = time_us + KEY_MIN_PULSE_US;
+}
+
+/**
+ * @brief Clears the edges a key latched while it was masked and unmasks it
+ *
+ * @param p The player
+ */
+static inline void key_unmask(int p)
+{
+    uint pin = player_pins[p];
+    iobank0_hw->intr[pin / 8] = KEY_IRQ_EDGES << 4 * (pin % 8);
+    hw_set_bits(&iobank0_hw->proc0_irq_ctrl.inte[pin / 8], KEY_IRQ_EDGES << 4 * (pin % 8));
+    key_masked[p] = 0;
+}
+
+/**
+ * @brief Sets ALARM1 for the first key to finish settling
+ */
+void __not_in_flash_func(key_arm)()
+{
+    uint32_t target = 0;
+    int armed = 0;
+    for (int p = 0; p < NUM_PLAYERS; p++)
     {
-        if (current_level > 2)
+        if (key_masked[p] && (!armed || (int32_t)(key_settle_us[p] - target) < 0))
         {
-
-            // Space
-            current_input[current_input_length] = ' ';
-            printf(" ");
-            current_input_length++;
+            target = key_settle_us[p];
+            armed = 1;
         }
-        break;
     }
-    case 3:
+    if (!armed)
+        return;
+
+    set_debounce_alarm_at(target);
+
+    // Too late for the alarm, so fire it now
+    if ((int32_t)(time_us_32() - target) >= 0)
+        nvic_hw->ispr = 1u << TIMER_IRQ_1;
+}
+
+/**
+ * @brief Called from gpio_isr for every edge on a key, queues the first edge of a
+ *        burst and pends ALARM1 to mask the key
+ *
+ * @param p       The player
+ * @param type    The input_event_type of the edge
+ * @param time_us The timestamp of the edge
+ */
+void __not_in_flash_func(key_edge)(uint32_t p, uint32_t type, uint32_t time_us)
+{
+    (void)type;
+    key_irqs[p]++;
+
+    // An edge latched before ALARM1 masked the key, its burst is already queued or settling
+    if (key_queued[p] || key_masked[p])
+        return;
+    key_queued[p] = 1;
+    key_edge_us[p] = time_us;
+    nvic_hw->ispr = 1u << TIMER_IRQ_1;
+}
+
+/**
+ * @brief Called from the ALARM1 interrupt, masks the keys gpio_isr has queued an edge
+ *        for, then queues or drops the edge of every key that has settled and unmasks it
+ */
+void __not_in_flash_func(key_debounce_isr)()
+{
+    for (int p = 0; p < NUM_PLAYERS; p++)
+    {
+        if (!key_queued[p])
+            continue;
+        key_mask(p, key_edge_us[p]);
+        key_queued[p] = 0;
+    }
+
+    for (int p = 0; p < NUM_PLAYERS; p++)
     {
-        // End Of Line (EOL)
-        if ((current_level == 3) || (current_level == 4))
+        uint32_t read_us = time_us_32();
+        if (!key_masked[p] || (int32_t)(read_us - key_settle_us[p]) < 0)
+            continue;
+
+        uint pin = player_pins[p];
+        uint8_t level = gpio_get(pin);
+        if (level != key_level[p])
         {
-            current_input[current_input_length - 1] = '\0';
+            key_level[p] = level;
+            key_accepted[p]++;
+            asm_event_push(p, level ? EVENT_RELEASE : EVENT_PRESS, key_edge_us[p]);
         }
         else
+            key_glitches[p]++;
+
+        // Unmasking clears the edges latched while masked, so a change since the read is
+        // caught here, stamped with the read it came just after
+        key_unmask(p);
+        if (gpio_get(pin) != key_level[p])
+            key_mask(p, read_us);
+    }
+    key_arm();
+}
+
+/**
+ * @brief Prints the key interrupts, edges and glitches of the active player
+ */
+void key_report()
+{
+    int p = active_player;
+    char value[FMT_MAX_LEN];
+    stats_line("Key interrupts: \t\t", fmt_uint(value, key_irqs[p], 0));
+    stats_line("Key edges: \t\t\t", fmt_uint(value, key_accepted[p], 0));
+    stats_line("Glitches rejected: \t\t", fmt_uint(value, key_glitches[p], 0));
+}
+
+// -------------------------------------- Audio Input --------------------------------------
+
+/*
+ * Tones from a radio or an oscillator can be copied instead of keyed. The audio is
+ * biased to mid-rail and AC coupled into ADC0, which free-runs at AUDIO_SAMPLE_HZ into
+ * two DMA buffers. Each channel chains to the other, so sampling never stops while the
+ * buffer that just filled is processed. The DMA interrupt runs the tone detector
+ * (tone_detect.c) over that buffer and queues the edges it finds for AUDIO_PLAYER, the
+ * same way gpio_isr queues key edges, so from there on a tone is handled like a press.
+ *
+ * DMA_IRQ_0 runs at gpio_isr's priority, so neither can interrupt the other part way
+ * through asm_event_push(). The detector costs about ten cycles a sample, under 0.2% of
+ * the CPU at 8 kHz even at the idle clock. clk_adc runs from the USB PLL, so switching
+ * clk_sys doesn't change the sample rate.
+ */
+
+/**
+ * @def AUDIO_PIN
+ * GPIO of the ADC input the audio is on
+ */
+#define AUDIO_PIN 26
+
+/**
+ * @def AUDIO_ADC_INPUT
+ * ADC input of AUDIO_PIN
+ */
+#define AUDIO_ADC_INPUT 0
+
+/**
+ * @def AUDIO_SAMPLE_HZ
+ * ADC sample rate
+ */
+#define AUDIO_SAMPLE_HZ 8000
+
+/**
+ * @def AUDIO_TONE_HZ
+ * Frequency of the tone to copy
+ */
+#define AUDIO_TONE_HZ 700
+
+/**
+ * @def AUDIO_BLOCK
+ * Samples per detector block, 8 ms at 8 kHz, fine enough for 40+ WPM
+ */
+#define AUDIO_BLOCK 64
+
+/**
+ * @def AUDIO_BUFFER
+ * Samples per DMA buffer (a multiple of AUDIO_BLOCK)
+ */
+#define AUDIO_BUFFER 256
+
+/**
+ * @def AUDIO_RING_BITS
+ * log2 of the size of one DMA buffer in bytes, the write address wraps within it
+ */
+#define AUDIO_RING_BITS 9
+
+/**
+ * @def AUDIO_BUFFER_US
+ * Time one DMA buffer takes to fill
+ */
+#define AUDIO_BUFFER_US (AUDIO_BUFFER * 1000000 / AUDIO_SAMPLE_HZ)
+
+/**
+ * @def AUDIO_PLAYER
+ * The player the tones are input for
+ */
+#define AUDIO_PLAYER 0
+
+/**
+ * @def AUDIO_IRQ_PRIORITY
+ * Must be the same as GPIO_IRQ_PRIORITY in assign02.S
+ */
+#define AUDIO_IRQ_PRIORITY 0x00
+
+#if AUDIO_INPUT
+uint16_t audio_buf[2][AUDIO_BUFFER] __attribute__((aligned(1 << AUDIO_RING_BITS))); /*!< The ping-pong buffers */
+int audio_dma[2];          /*!< DMA channel filling each buffer */
+int audio_next = 0;        /*!< The buffer that fills next */
+tone_detector audio_tone;  /*!< Tone detector state */
+uint32_t audio_buffers;    /*!< Buffers processed */
+uint32_t audio_overruns;   /*!< Buffers processed late, after the other one had filled too */
+uint32_t audio_busy_us;    /*!< Time spent in the DMA interrupt */
+
+/**
+ * @brief DMA interrupt, runs the tone detector over every buffer that has filled (in
+ *        the order they filled) and queues the edges it finds
+ */
+void __not_in_flash_func(audio_dma_isr)()
+{
+    irq_nest_enter();
+    uint32_t now = time_us_32();
+    int pending = dma_channel_get_irq0_status(audio_dma[0]) + dma_channel_get_irq0_status(audio_dma[1]);
+    if (pending == 2)
+        audio_overruns++;
+
+    while (dma_channel_get_irq0_status(audio_dma[audio_next]))
+    {
+        dma_channel_acknowledge_irq0(audio_dma[audio_next]);
+
+        // The last sample of the latest buffer has just arrived
+        uint32_t start = now - pending-- * AUDIO_BUFFER_US;
+        tone_edge edges[AUDIO_BUFFER / AUDIO_BLOCK];
+        int n = tone_process(&audio_tone, audio_buf[audio_next], AUDIO_BUFFER, start, edges, AUDIO_BUFFER / AUDIO_BLOCK);
+        for (int i = 0; i < n; i++)
+            asm_event_push(AUDIO_PLAYER, edges[i].release ? EVENT_RELEASE : EVENT_PRESS, edges[i].time_us);
+
+        audio_buffers++;
+        audio_next ^= 1;
+    }
+    audio_busy_us += time_us_32() - now;
+    irq_nest_exit();
+}
+
+/**
+ * @brief Starts sampling the audio input. Must run after main_asm(), which moves the
+ *        vector table the DMA interrupt handler is installed in.
+ */
+void audio_init()
+{
+    adc_init();
+    adc_gpio_init(AUDIO_PIN);
+    adc_select_input(AUDIO_ADC_INPUT);
+    adc_fifo_setup(true, true, 1, false, false);
+    adc_set_clkdiv(48000000.0f / AUDIO_SAMPLE_HZ - 1);
+    tone_init(&audio_tone, AUDIO_SAMPLE_HZ, AUDIO_TONE_HZ, AUDIO_BLOCK);
+
+    for (int i = 0; i < 2; i++)
+        audio_dma[i] = dma_claim_unused_channel(true);
+    for (int i = 0; i < 2; i++)
+    {
+        dma_channel_config c = dma_channel_get_default_config(audio_dma[i]);
+        channel_config_set_transfer_data_size(&c, DMA_SIZE_16);
+        channel_config_set_read_increment(&c, false);
+        channel_config_set_write_increment(&c, true);
+        channel_config_set_ring(&c, true, AUDIO_RING_BITS);
+        channel_config_set_dreq(&c, DREQ_ADC);
+        channel_config_set_chain_to(&c, audio_dma[i ^ 1]);
+        dma_channel_configure(audio_dma[i], &c, audio_buf[i], &adc_hw->fifo, AUDIO_BUFFER, false);
+        dma_channel_set_irq0_enabled(audio_dma[i], true);
+    }
+
+    irq_set_exclusive_handler(DMA_IRQ_0, audio_dma_isr);
+    irq_set_priority(DMA_IRQ_0, AUDIO_IRQ_PRIORITY);
+    irq_set_enabled(DMA_IRQ_0, true);
+    dma_channel_start(audio_dma[0]);
+    adc_run(true);
+}
+
+/**
+ * @brief Prints the share of the CPU the audio input is using
+ */
+void audio_report()
+{
+    char value[FMT_MAX_LEN];
+    stats_line("Audio load: \t\t\t", fmt_percent(value, audio_busy_us, audio_buffers * AUDIO_BUFFER_US, 0));
+    stats_line("Audio overruns: \t\t", fmt_uint(value, audio_overruns, 0));
+}
+#endif
+
+// -------------------------------------- Input Injection --------------------------------------
+
+/*
+ * A host script can key whole games over stdio (inject.c describes the protocol).
+ * The injected edges are pushed into the same queues as gpio_isr's, stamped with
+ * the times they were scheduled for, so everything from the gap timeouts to
+ * check_input() runs exactly as it would for a real key. Once a command has been
+ * received, the game also reports its outcomes as "@" lines:
+ *   @STATE <player> <state> <level>
+ *   @ASK <player> <level> <answer> <code>
+ *   @VERDICT <player> <CORRECT|WRONG> <lives> <remaining> <input>
+ */
+
+/** Events posted to the injection task */
+enum inject_event
+{
+    INJECT_EVENT_RX = 1u << 0 /*!< Characters are waiting on stdin */
+};
+
+inject_state injector;   /*!< Parser and queue of injected edges */
+int inject_task_id;      /*!< Task feeding in the injected edges */
+int inject_active = 0;   /*!< 1 - A host is scripting the game, print the outcome reports */
+
+/**
+ * @brief Reports a player's game state
+ *
+ * @param p The player
+ */
+void report_state(int p)
+{
+    char player[FMT_MAX_LEN], level[FMT_MAX_LEN];
+    if (inject_active)
+        printf("@STATE %s %s %s\n", fmt_int(player, p, 0), game_state_names[players.state[p]],
+               fmt_int(level, players.session[p].level, 0));
+}
+
+/**
+ * @brief Reports the question a player has been asked, with its answer
+ *
+ * @param p The player
+ */
+void report_question(int p)
+{
+    if (!inject_active)
+        return;
+
+    char player[FMT_MAX_LEN], level[FMT_MAX_LEN];
+    const session_question *q = session_current(&players.session[p]);
+    if (q)
+        printf("@ASK %s %s %s %s\n", fmt_int(player, p, 0), fmt_int(level, players.session[p].level, 0), q->text,
+               q->code);
+}
+
+/**
+ * @brief Reports the verdict on a player's answer
+ *
+ * @param p       The player
+ * @param correct 1 - The answer was accepted
+ * @param input   The input as it was submitted
+ */
+void report_verdict(int p, int correct, const char *input)
+{
+    char player[FMT_MAX_LEN], lives[FMT_MAX_LEN], remaining[FMT_MAX_LEN];
+    if (inject_active)
+        printf("@VERDICT %s %s %s %s %s\n", fmt_int(player, p, 0), correct ? "CORRECT" : "WRONG",
+               fmt_int(lives, players.session[p].lives, 0), fmt_int(remaining, players.session[p].remaining, 0),
+               input);
+}
+
+/**
+ * @brief Called from the stdio driver's interrupt when characters arrive
+ */
+void inject_chars_available(void *param)
+{
+    (void)param;
+    sched_post(&sched, inject_task_id, INJECT_EVENT_RX);
+}
+
+/**
+ * @brief Injection task, parses the received commands and feeds in the edges that are due
+ */
+void inject_task(void *ctx, uint32_t events)
+{
+    (void)ctx;
+    (void)events;
+    char reply[32];
+    int c;
+    while ((c = getchar_timeout_us(0)) != PICO_ERROR_TIMEOUT)
+    {
+        if (!inject_feed(&injector, c, time_us_32(), reply, sizeof(reply)))
+            continue;
+
+        printf("%s\n", reply);
+        if (!inject_active)
         {
-            current_input[current_input_length] = '\0';
+            // Tell the new host where every game is up to
+            inject_active = 1;
+            for (int p = 0; p < NUM_PLAYERS; p++)
+                report_state(p);
         }
+    }
 
-        printf("\n");
-        current_input_length++;
-        input_complete = 1;
-        break;
+    inject_edge edge;
+    while (inject_due(&injector, time_us_32(), &edge))
+    {
+        // Keep the interrupts that also push out part way through a push
+        uint32_t irq = save_and_disable_interrupts();
+        asm_event_push(edge.player, edge.release ? EVENT_RELEASE : EVENT_PRESS, edge.due_us);
+        restore_interrupts(irq);
     }
-    default:
-        break;
+
+    uint32_t due;
+    if (inject_next(&injector, &due))
+        sched_timer(&sched, inject_task_id, due);
+}
+
+/**
+ * @brief Adds the injection task and starts listening on stdio
+ */
+void inject_init_task()
+{
+    inject_init(&injector, NUM_PLAYERS);
+    inject_task_id = sched_add(&sched, inject_task, NULL, "inject");
+    stdio_set_chars_available_callback(inject_chars_available, NULL);
+}
+
+// -------------------------------------- Morse Transmit --------------------------------------
+
+/*
+ * After a wrong answer the right one is keyed out on MORSE_TX_PIN, to a sounder or an
+ * oscillator, so the player hears how it should have gone. Text queued with
+ * transmit_send() is encoded with the codes of session_letters (morse_tx.c) into
+ * run-length words, a key level and how long to hold it in microseconds, and the
+ * morse_tx PIO program (morse_tx.pio, on the state machine beside the WS2812's) keys
+ * the pin from them on a 1 MHz tick, so every element and gap is exact to the tick whatever the CPU
+ * is doing. DMA feeds the words to the PIO from two buffers in turn, paced by its TX
+ * FIFO. The CPU only runs once a buffer has been sent, to start the other one from the
+ * DMA interrupt and to encode more text into the free one from the transmit task.
+ *
+ * The tick is divided down from clk_sys, which stops for a moment when it is switched,
+ * so clock_set_op() holds clk_sys at its operating point from the first word until the
+ * FIFO has run dry (the last word is always a key up). Every operating point is a whole
+ * number of MHz, so the divider is exact.
+ */
+
+/**
+ * @def MORSE_TX_CHUNK
+ * Words per DMA buffer, about ten letters
+ */
+#define MORSE_TX_CHUNK 64
+
+/** Events posted to the transmit task */
+enum transmit_event
+{
+    TRANSMIT_EVENT_QUEUED = 1u << 0, /*!< Text has been queued */
+    TRANSMIT_EVENT_SENT = 1u << 1    /*!< The DMA has finished a buffer */
+};
+
+#if MORSE_TX
+morse_tx transmitter;                     /*!< Encoder, holds the text waiting to be keyed out */
+uint32_t transmit_buf[2][MORSE_TX_CHUNK]; /*!< The ping-pong buffers of words */
+volatile uint32_t transmit_len[2];        /*!< Words waiting to be sent in each buffer, 0 - Free to fill */
+int transmit_fill_next = 0;               /*!< The buffer that is filled next */
+volatile int transmit_send_next = 0;      /*!< The buffer being sent, or sent next */
+volatile int transmit_dma_busy = 0;       /*!< 1 - The DMA is sending transmit_send_next */
+int transmit_dma;                         /*!< DMA channel feeding the PIO */
+int transmit_task_id;                     /*!< Task encoding the text */
+uint32_t transmit_buffers;                /*!< Buffers sent, one DMA interrupt each */
+
+/**
+ * @brief Starts the DMA sending a buffer to the PIO
+ *
+ * @param b The buffer
+ */
+static inline void transmit_start(int b)
+{
+    dma_channel_transfer_from_buffer_now(transmit_dma, transmit_buf[b], transmit_len[b]);
+    transmit_dma_busy = 1;
+}
+
+/**
+ * @brief DMA interrupt, frees the buffer just sent and starts the other one straight
+ *        away if it is ready, so the FIFO doesn't run dry between them
+ */
+void __not_in_flash_func(transmit_dma_isr)()
+{
+    irq_nest_enter();
+    dma_channel_acknowledge_irq1(transmit_dma);
+    int b = transmit_send_next;
+    transmit_len[b] = 0;
+    transmit_send_next = b ^ 1;
+    if (transmit_len[b ^ 1])
+        transmit_start(b ^ 1);
+    else
+        transmit_dma_busy = 0;
+    transmit_buffers++;
+    sched_post(&sched, transmit_task_id, TRANSMIT_EVENT_SENT);
+    irq_nest_exit();
+}
+
+/**
+ * @brief Transmit task, encodes queued text into the free buffers, starts the DMA if it
+ *        is idle and lets clk_sys go once the last word is playing
+ *
+ * @param ctx    Unused
+ * @param events Unused, every event is handled the same way
+ */
+void transmit_task(void *ctx, uint32_t events)
+{
+    (void)ctx;
+    (void)events;
+    while (transmit_len[transmit_fill_next] == 0)
+    {
+        int n = morse_tx_fill(&transmitter, transmit_buf[transmit_fill_next], MORSE_TX_CHUNK);
+        if (n == 0)
+            break;
+        transmit_len[transmit_fill_next] = n;
+        transmit_fill_next ^= 1;
+    }
+
+    // The interrupt starts buffers too
+    uint32_t irq = save_and_disable_interrupts();
+    if (!transmit_dma_busy && transmit_len[transmit_send_next])
+    {
+        transmit_busy = 1;
+        transmit_start(transmit_send_next);
+    }
+    restore_interrupts(irq);
+
+    if (transmit_busy && !transmit_dma_busy)
+    {
+        // The words left in the FIFO still need the tick, check again a unit later
+        if (pio_sm_is_tx_fifo_empty(pio0, MORSE_TX_SM))
+            transmit_busy = 0;
+        else
+            sched_timer(&sched, transmit_task_id, time_us_32() + transmitter.unit_us);
     }
 }
 
+/**
+ * @brief Loads the codes of session_letters into the encoder and starts the PIO program
+ *        and the DMA channel that feeds it. Must run after main_asm(), which moves the
+ *        vector table the DMA interrupt handler is installed in.
+ */
+void transmit_init()
+{
+    morse_tx_init(&transmitter);
+    for (int i = 0; i < SESSION_LETTERS; i++)
+        morse_tx_add_code(&transmitter, session_letters[i].text[0], session_letters[i].code);
+    morse_tx_set_speed(&transmitter, MORSE_TX_WPM, MORSE_TX_FARNSWORTH_WPM);
+
+    uint offset = pio_add_program(pio0, &morse_tx_program);
+    morse_tx_program_init(pio0, MORSE_TX_SM, offset, MORSE_TX_PIN, MORSE_TX_TICK_HZ);
+
+    transmit_dma = dma_claim_unused_channel(true);
+    dma_channel_config c = dma_channel_get_default_config(transmit_dma);
+    channel_config_set_transfer_data_size(&c, DMA_SIZE_32);
+    channel_config_set_read_increment(&c, true);
+    channel_config_set_write_increment(&c, false);
+    channel_config_set_dreq(&c, pio_get_dreq(pio0, MORSE_TX_SM, true));
+    dma_channel_configure(transmit_dma, &c, &pio0->txf[MORSE_TX_SM], transmit_buf[0], 0, false);
+    dma_channel_set_irq1_enabled(transmit_dma, true);
+
+    irq_set_exclusive_handler(DMA_IRQ_1, transmit_dma_isr);
+    irq_set_enabled(DMA_IRQ_1, true);
+}
+
+/**
+ * @brief Adds the transmit task
+ */
+void transmit_init_task()
+{
+    transmit_task_id = sched_add(&sched, transmit_task, NULL, "transmit");
+}
+
+/**
+ * @brief Prints the letters keyed out and the wake ups it took
+ */
+void transmit_report()
+{
+    char value[FMT_MAX_LEN];
+    stats_line("Letters keyed out: \t\t", fmt_uint(value, transmitter.letters, 0));
+    stats_line("Transmit wake ups: \t\t", fmt_uint(value, transmit_buffers, 0));
+}
+#endif
+
+/**
+ * @brief Queues text to be keyed out on MORSE_TX_PIN
+ *
+ * @param text Letters and digits of session_letters (either case), ' ' between words
+ */
+void transmit_send(const char *text)
+{
+#if MORSE_TX
+    morse_tx_queue(&transmitter, text);
+    sched_post(&sched, transmit_task_id, TRANSMIT_EVENT_QUEUED);
+#else
+    (void)text;
+#endif
+}
+
 // -------------------------------------- Display Message --------------------------------------
 
 /**
@@ -673,8 +2679,9 @@ void instructions()
     printf("\n");
     printf("1. For a dot (.), Hold down GPIO PIN 21 <0.25s \n");
     printf("2. For a dash (-), Hold down GPIO PIN 21 for >0.25s \n");
-    printf("3. For a space, Leave the button unpressed for 1s \n");
-    printf("4. To submit, Leave the button unpressed for 2s \n");
+    printf("3. For a space, Leave the button unpressed for about 3 dots \n");
+    printf("4. To submit, Leave the button unpressed for about 7 dots \n");
+    printf("   (or key .-.-. as the last letter of a word) \n");
     printf("\n");
 }
 
@@ -689,13 +2696,61 @@ void difficulty_level_inputs()
     printf("\t* Enter ..--- for Level 2   *\n");
     printf("\t* Enter ...-- for Level 3   *\n");
     printf("\t* Enter ....- for Level 4   *\n");
+    printf("\t* Enter ----- free keying   *\n");
+    printf("\t* Enter -.... speed run     *\n");
     printf("\t*                           *\n");
     printf("\t* Enter ..... to exit       *\n");
     printf("\t*                           *\n");
     printf("\t*****************************\n");
 }
 
-// -------------------------------------- LED --------------------------------------
+// -------------------------------------- LED --------------------------------------
+
+/**
+ * @def LED_BREATHE_STEP_US
+ * Time between brightness steps while the LED is breathing
+ */
+#define LED_BREATHE_STEP_US 40000
+
+/**
+ * @def LED_BREATHE_MIN
+ * Dimmest blue level while breathing
+ */
+#define LED_BREATHE_MIN 0x04
+
+int led_breathing = 0; /*!< 1 - The LED is breathing blue while waiting for a level select */
+int led_level = 0x3F;  /*!< Current blue level while breathing */
+int led_step = -1;     /*!< Change in led_level per step */
+
+/**
+ * @brief Starts or stops the LED breathing blue
+ *
+ * @param on 1 - Start, 0 - Stop
+ */
+void led_breathe(int on)
+{
+    led_breathing = on;
+    if (on)
+        sched_timer(&sched, led_task_id, time_us_32() + LED_BREATHE_STEP_US);
+    else
+        sched_cancel(&sched, led_task_id);
+}
+
+/**
+ * @brief LED task, steps the breathing brightness each time its timer expires
+ */
+void led_task(void *ctx, uint32_t events)
+{
+    (void)ctx;
+    if (!(events & SCHED_EVENT_TIMER) || !led_breathing)
+        return;
+
+    led_level += led_step;
+    if (led_level <= LED_BREATHE_MIN || led_level >= 0x3F)
+        led_step = -led_step;
+    put_pixel(urgb_u32(0x0, 0x0, led_level));
+    sched_timer(&sched, led_task_id, time_us_32() + LED_BREATHE_STEP_US);
+}
 
 /**
  * @brief Sets the correct LED color based on the current level and number of lives.
@@ -707,9 +2762,12 @@ void difficulty_level_inputs()
  */
 void set_correct_led()
 {
-    if (current_level != 0)
+    int p = active_player;
+
+    led_breathe(0);
+    if (players.session[p].level != 0)
     {
-        switch (lives)
+        switch (players.session[p].lives)
         {
         case 3:
             // Set Green
@@ -739,9 +2797,19 @@ void set_correct_led()
  */
 void set_red_led()
 {
+    led_breathe(0);
     put_pixel(urgb_u32(0x3F, 0x0, 0x0));
 }
 
+/**
+ * @brief Sets the LED color to Green.
+ */
+void set_green_led()
+{
+    led_breathe(0);
+    put_pixel(urgb_u32(0x0, 0x3F, 0x0));
+}
+
 /**
  * @brief Sets the LED color to Blue.
  */
@@ -750,281 +2818,177 @@ void set_blue_led()
     put_pixel(urgb_u32(0x0, 0x0, 0x3F));
 }
 
-// -------------------------------------- Game Logic --------------------------------------
+// -------------------------------------- Memory Report --------------------------------------
+
+/** Struct defining one of the game's global buffers */
+typedef struct memory_arena
+{
+    const char *name;
+    uint32_t bytes;
+} memory_arena;
+
+/** The game's global buffers, all statically allocated (the heap is only used by the SDK) */
+const memory_arena memory_arenas[] = {
+    {"players", sizeof(players)},
+    {"sched", sizeof(sched)},
+    {"letter_codes", sizeof(letter_codes)},
+    {"word_codes", sizeof(word_codes)},
+    {"player_hmm", sizeof(player_hmm)},
+    {"event_queue", sizeof(event_queue)},
+    {"telemetry", sizeof(telemetry)},
+    {"edge_log_buf", sizeof(edge_log_buf)},
+    {"injector", sizeof(injector)},
+    {"player_transcriber", sizeof(player_transcriber)},
+    {"boot_phases", sizeof(boot_phases)},
+    {"saved_game", sizeof(saved_game)},
+    {"saved_trace", sizeof(saved_trace)},
+#if AUDIO_INPUT
+    {"audio_buf", sizeof(audio_buf)},
+    {"audio_tone", sizeof(audio_tone)},
+#endif
+#if MORSE_TX
+    {"transmitter", sizeof(transmitter)},
+    {"transmit_buf", sizeof(transmit_buf)},
+#endif
+};
+
+/**
+ * @def MEMORY_ARENA_COUNT
+ * Number of entries in memory_arenas
+ */
+#define MEMORY_ARENA_COUNT (int)(sizeof(memory_arenas) / sizeof(memory_arenas[0]))
 
 /**
- * @brief Clears the current input, making it ready for a new round
+ * @brief Gets the total size of the game's global buffers
  */
-void clear_input()
+uint32_t memory_arena_total()
 {
-    for (int i = 0; i < 100; i++)
-        current_input[i] = 0;
-    current_input_length = 0;
+    uint32_t total = 0;
+    for (int i = 0; i < MEMORY_ARENA_COUNT; i++)
+        total += memory_arenas[i].bytes;
+    return total;
 }
 
 /**
- * @brief Handles the level select, based on the current input
+ * @brief Paints both cores' stacks, first thing at reset
  */
-void select_difficulty()
+void memory_init()
 {
-    if (strcmp(current_input, ".----") == 0)
-    {
-        current_level = 1;
+    stack_paint(__StackBottom, __StackTop);
+    stack_paint(__StackOneBottom, __StackOneTop);
+}
+
+/**
+ * @brief Prints the stack high-water marks, the deepest handler nesting and the size
+ *        of every global buffer as one machine readable line
+ *
+ *        #MEM core0=<used>/<size> core1=<used>/<size> irq_depth=<most> arenas=<total>/<budget> <buffer>=<bytes> ...
+ */
+void memory_report()
+{
+    char used0[FMT_MAX_LEN], size0[FMT_MAX_LEN], used1[FMT_MAX_LEN], size1[FMT_MAX_LEN];
+    char depth[FMT_MAX_LEN], total[FMT_MAX_LEN], budget[FMT_MAX_LEN];
+    printf("#MEM core0=%s/%s core1=%s/%s irq_depth=%s arenas=%s/%s",
+           fmt_uint(used0, stack_used(__StackBottom, __StackTop), 0),
+           fmt_uint(size0, (__StackTop - __StackBottom) * sizeof(uint32_t), 0),
+           fmt_uint(used1, stack_used(__StackOneBottom, __StackOneTop), 0),
+           fmt_uint(size1, (__StackOneTop - __StackOneBottom) * sizeof(uint32_t), 0),
+           fmt_uint(depth, irq_depth_max, 0), fmt_uint(total, memory_arena_total(), 0),
+           fmt_uint(budget, MEMORY_ARENA_BUDGET, 0));
+    for (int i = 0; i < MEMORY_ARENA_COUNT; i++)
+        printf(" %s=%s", memory_arenas[i].name, fmt_uint(total, memory_arenas[i].bytes, 0));
+    printf("\n");
+}
+
+// -------------------------------------- Game Logic --------------------------------------
+
+/*
+ * The rules are the player's game_session: session_answer() checks and scores the
+ * answer and picks the next question. This section prints what it decided.
+ */
+
+/**
+ * @brief Handles the level select, based on the active player's answer. Speed run and
+ *        free keying are options of this firmware, the session knows the levels and quit.
+ *
+ * @param input The answer as it was keyed
+ */
+void select_difficulty(const char *input)
+{
+    int p = active_player;
+
+    // The boot time barely varies, when the player started keying does
+    session_seed(&players.session[p], players.first_press[p]);
+    uint32_t events = session_answer(&players.session[p], 0);
+
+    if (strcmp(input, SPEEDRUN_SELECT) == 0)
+        speedrun_toggle();
+    else if (strcmp(input, TRANSCRIBE_SELECT) == 0)
+        set_green_led();
+    else if (events & SESSION_EV_QUESTION)
         // Turns Green to signify game in progress
         set_correct_led();
-        // level_1();
-        return;
-    }
-    else if (strcmp(current_input, "..---") == 0)
-    {
-        current_level = 2;
-        set_correct_led();
-        return;
-    }
-    else if (strcmp(current_input, "...--") == 0)
-    {
-        current_level = 3;
-        set_correct_led();
-        return;
-    }
-    else if (strcmp(current_input, "....-") == 0)
-    {
-        current_level = 4;
-        set_correct_led();
-        return;
-    }
-    else if (strcmp(current_input, ".....") == 0)
-    {
-        quit = 1;
-        return;
-    }
-    else
-    {
+    else if (events & SESSION_EV_INVALID)
         printf("Error: Invalid input.");
-        return;
-    }
 }
 
 /**
- * @brief Based on the current level, check if the input is valid and progress as necessary
+ * @brief Has the active player's session act on their answer, and prints the verdict
+ *        and their progress at the current level
+ *
+ * @param input The answer as it was keyed. New keying can overwrite the session's copy
+ *              once it has been acted on, so this is the caller's.
  */
-void check_input()
+void check_input(const char *input)
 {
+    int p = active_player;
+    game_session *s = &players.session[p];
+
     // Handle for level select
-    if (current_level == 0)
-    {
-        select_difficulty();
-    }
-    else if (current_level == 1)
+    if (s->phase == SESSION_SELECT)
     {
-        // Level 1
-        if (strcmp(current_input, table[char_to_solve].code) == 0)
-        {
-            remaining--;
-            printf("\nCORRECT!\n\n");
-            printf("Remaining: %d\n", remaining);
-            if(lives<3){
-                printf("Lives Incremented\n");
-                lives++;
-            }
-            set_correct_led();
-            printf("Lives: %d\n\n\n", lives);
-            right_input++;
-        }
-        else
-        {
-            lives--;
-            set_correct_led();
-            printf("\nWRONG! :((\n\n");
-            int present = 0;
-            int i;
-            for(i = 0; i<36; i++){
-                if (strcmp(current_input, table[i].code) == 0)
-                {
-                    printf("Inputted Values is: %c\n", table[i].letter);
-                    present = 1;
-                }
-            }
-            if(present != 1){
-                printf("Inputted Values is: ?\n");
-            }
-            
-            remaining = 5;
-            printf("Remaining back to: %d\n", remaining);
-            printf("Lives: %d\n\n\n", lives);
-            wrong_input++;
-        }
+        select_difficulty(input);
+        return;
     }
-    else if (current_level == 2)
+    if (s->phase != SESSION_QUESTION)
     {
-        // Level 2
-        if (strcmp(current_input, table[char_to_solve].code) == 0)
-        {
-            remaining--;
-            printf("\nCORRECT!\n\n");
-            printf("Remaining: %d\n", remaining);
-            if(lives<3){
-                printf("Lives Incremented\n");
-                lives++;
-            }
-            set_correct_led();
-            printf("Lives: %d\n\n\n", lives);
-            right_input++;
-        }
-        else
-        {
-            lives--;
-            set_correct_led();
-            printf("\nWRONG! :((\n\n");
-            int present = 0;
-            int i;
-            for(i = 0; i<36; i++){
-                if (strcmp(current_input, table[i].code) == 0)
-                {
-                    printf("Inputted Values is: %c\n", table[i].letter);
-                    present = 1;
-                }
-            }
-            if(present != 1){
-                printf("Inputted Values is: ?\n");
-            }
-            
-            printf("%c in Morse is: %s\n", table[char_to_solve].letter, table[char_to_solve].code);
-            remaining = 5;
-            printf("Remaining back to: %d\n", remaining);
-            printf("Lives: %d\n\n\n", lives);
-            wrong_input++;
-        }
-    }
-    else if (current_level == 3)
-    {
-        // Level 3
-        if (strcmp(current_input, wTable[char_to_solve].code) == 0)
-        {  
-            remaining--;
-            printf("\nCORRECT!\n\n");
-            printf("Remaining: %d\n", remaining);
-            if(lives<3){
-                printf("Lives Incremented\n");
-                lives++;
-            }
-            set_correct_led();
-            printf("Lives: %d\n\n\n", lives);
-            right_input++;
-        }
-        else
-        {
-            lives--;
-            set_correct_led();
-            printf("\nWRONG! :((\n\n");
-            char delm[2]=" ";
-            char *token;
-            token = strtok(current_input, delm);
-            int wrong = 0;
-            printf("Inputted Value is: ");
-
-            while(token != NULL)
-            {
-                int present = 0;
-                
-                int i;
-                for(i = 0; i<36; i++){
-                    if (strcmp(token, table[i].code) == 0)
-                    {
-                        //strcat(tempVal, table[i].letter);
-                        printf("%c", table[i].letter);
-                        //printf("Inputted Values is: %c\n", table[i].letter);
-                        present = 1;
-                    }
-                }
-                if(present != 1){
-                    wrong = 1;
-                }
-
-                token = strtok(NULL, delm);
-            }
-            
-            if(wrong == 1){
-                printf("?\n");
-            }
-            else{
-                printf("\n");
-            }
-            
-            remaining = 5;
-            printf("Remaining back to: %d\n", remaining);
-            printf("Lives: %d\n\n\n", lives);
-            wrong_input++;
-        }
+        printf("ERROR");
+        return;
     }
-    else if (current_level == 4)
+
+    const session_question *q = session_current(s);
+    int level = s->level;
+    int lives = s->lives;
+    char value[FMT_MAX_LEN];
+    session_answer(s, input_matches(input, q));
+
+    if (s->correct)
     {
-        // Level 4
-        if (strcmp(current_input, wTable[char_to_solve].code) == 0)
-        {
-            remaining--;
-            printf("\nCORRECT!\n\n");
-            printf("Remaining: %d\n", remaining);
-            if(lives<3){
-                printf("Lives Incremented\n");
-                lives++;
-            }
-            printf("Lives: %d\n\n\n", lives);
-            set_correct_led();
-            right_input++;
-        }
-        else
-        {
-            lives--;
-            set_correct_led();
-            printf("\nWRONG! :((\n\n");
-            char delm[2]=" ";
-            char *token;
-            token = strtok(current_input, delm);
-            int wrong = 0;
-            printf("Inputted Value is: ");
-
-            while(token != NULL)
-            {
-                int present = 0;
-                
-                int i;
-                for(i = 0; i<36; i++){
-                    if (strcmp(token, table[i].code) == 0)
-                    {
-                        //strcat(tempVal, table[i].letter);
-                        printf("%c", table[i].letter);
-                        //printf("Inputted Values is: %c\n", table[i].letter);
-                        present = 1;
-                    }
-                }
-                if(present != 1){
-                    wrong = 1;
-                }
-
-                token = strtok(NULL, delm);
-            }
-            
-            if(wrong == 1){
-                printf("?\n");
-            }
-            else{
-                printf("\n");
-            }
-            
-            printf("%s in Morse is: %s\n", wTable[char_to_solve].word, wTable[char_to_solve].code);
-            remaining = 5;
-            printf("Remaining back to: %d\n", remaining);
-            printf("Lives: %d\n\n\n", lives);
-            wrong_input++;
-        }
+        printf("\nCORRECT!\n\n");
+        printf("Remaining: %s\n", fmt_int(value, s->remaining, 0));
+        if (s->lives > lives)
+            printf("Lives Incremented\n");
+        set_correct_led();
+        printf("Lives: %s\n\n\n", fmt_int(value, s->lives, 0));
+        return;
     }
+
+    set_correct_led();
+    printf("\nWRONG! :((\n\n");
+    suggest_nearest(input, level > 2);
+    if (level <= 2)
+        printf("Inputted Values is: %s\n", s->decoded);
     else
+        printf("Inputted Value is: %s\n", s->decoded);
+
+    // Levels 2 and 4 don't show the code with the question, so show it and key it out
+    if (level == 2 || level == 4)
     {
-        printf("ERROR");
+        printf("%s in Morse is: %s\n", q->text, q->code);
+        transmit_send(q->text);
     }
-
-    clear_input();
+    printf("Remaining back to: %s\n", fmt_int(value, s->remaining, 0));
+    printf("Lives: %s\n\n\n", fmt_int(value, s->lives, 0));
 }
 
 /**
@@ -1032,64 +2996,10 @@ void check_input()
  */
 void reset_game()
 {
-    right_input = 0;
-    lives = 3;
-    remaining = 5;
-    wrong_input = 0;
-    current_level = 0;
-    input_complete = 0;
+    session_restart(&players.session[active_player]);
     set_blue_led();
 }
 
-/**
- * @brief Starts playing the game and doesn't quit out of this routinen
- * until the player specifies the 'quit' character sequence
- */
-void start_game()
-{
-    // put_pixel(urgb_u32(0x00, 0x3F, 0x00)); // Set the RGB LED color to green
-
-    while (quit == 0)
-    {
-        // Dont print instructions again if it's the initial round
-        if (initial_round)
-            initial_round = 0;
-        else
-            difficulty_level_inputs();
-
-        // Stall for level select
-        while (input_complete == 0)
-        {
-        }
-
-        // Check for level
-        check_input();
-        input_complete = 0;
-
-        if (current_level == 1)
-        {
-            level_1();
-        }
-        else if (current_level == 2)
-        {
-            level_2();
-        }
-        else if (current_level == 3)
-        {
-            level_3();
-        }
-        else if (current_level == 4)
-        {
-            level_4();
-        }
-
-        reset_game();
-        clear_input();
-    }
-
-    printf("GOODBYE :(\n");
-}
-
 /**
  * @brief A function called upon in start the game function that
  * calculates your overall accuracy throughout the game by
@@ -1097,27 +3007,34 @@ void start_game()
  */
 void calculate_stats(int reset)
 {
+    const game_session *s = &players.session[active_player];
+    uint32_t right = s->right;
+    uint32_t attempts = right + s->wrong;
+    char value[FMT_MAX_LEN];
+
     printf("\n\n********************* STATS *********************");
     printf("\n*\t\t\t\t\t\t*");
-    printf("\n*\tAttempts: \t\t\t%d\t*", right_input + wrong_input);
-    printf("\n*\tCorrect: \t\t\t%d\t*", right_input);
-    printf("\n*\tIncorrect: \t\t\t%d\t*", wrong_input);
-    printf("\n*\tAccuracy: \t\t\t%.2f%%\t*", (float)right_input / (right_input + wrong_input) * 100);
-    printf("\n*\tWin Streak: \t\t\t%d\t*", wins);
-    printf("\n*\tLives Left: \t\t\t%d\t*", lives);
-    if (right_input != 0 || wrong_input != 0)
-    {
-        float stat = (float)right_input / (right_input + wrong_input) * 100;
+    stats_line("Attempts: \t\t\t", fmt_uint(value, attempts, 0));
+    stats_line("Correct: \t\t\t", fmt_uint(value, right, 0));
+    stats_line("Incorrect: \t\t\t", fmt_uint(value, s->wrong, 0));
+    stats_line("Accuracy: \t\t\t", fmt_percent(value, right, attempts, 0));
+    stats_line("Win Streak: \t\t\t", fmt_uint(value, s->wins, 0));
+    stats_line("Lives Left: \t\t\t", fmt_int(value, s->lives, 0));
+    clock_energy_report(attempts, reset);
+    key_report();
+#if AUDIO_INPUT
+    audio_report();
+#endif
+#if MORSE_TX
+    transmit_report();
+#endif
+    if (attempts != 0)
+    {
+        // The session counts the answers of each level afresh
         if (reset)
-        {
-            right_input = 0;
-            wrong_input = 0;
-            printf("\n*\tCorrect %% for this level: \t%.2f%%\t*", stat);
-        }
+            stats_line("Correct % for this level: \t", fmt_percent(value, right, attempts, 0));
         else
-        {
-            printf("\n*\tCorrect Percent :\t\t\t%.2f%%\t*", stat);
-        }
+            stats_line("Correct Percent :\t\t\t", fmt_percent(value, right, attempts, 0));
     }
     printf("\n*\t\t\t\t\t\t*");
     printf("\n*************************************************\n\n");
@@ -1130,27 +3047,235 @@ void calculate_stats(int reset)
 void game_finished()
 {
     calculate_stats(1);
-    if (lives == 0)
+    if (players.session[active_player].lives == 0)
         set_red_led();
     printf("\n\n\n\n\n\n\t*****************************\n");
     printf("\t*                           *\n");
     printf("\t* Enter .---- to play again *\n");
     printf("\t* Enter ..--- to exit       *\n");
     printf("\t*****************************\n\n\n");
-    clear_input();
-    while (input_complete == 0)
+#if EDGE_LOG_STREAM
+    edge_capture_stream();
+#endif
+    memory_report();
+}
+
+/**
+ * @brief Handles the answer to the play again or exit prompt, through the active
+ *        player's session
+ */
+void select_replay()
+{
+    if (session_answer(&players.session[active_player], 0) & SESSION_EV_INVALID)
+        printf("Error: Invalid input.");
+}
+
+// -------------------------------------- Game State Machine --------------------------------------
+
+/*
+ * Each player's game used to be a stack of loops (start_game() -> level_N() ->
+ * game_finished()) that each spun until the next input was complete. It is now a
+ * state machine: entering a state prints its prompt, and each complete input runs
+ * one transition and returns to the scheduler.
+ */
+
+int players_left = NUM_PLAYERS; /*!< The number of players still in the game */
+
+/**
+ * @brief Moves the active player's game into a state and prints its prompt
+ *
+ * @param state The game_state to enter
+ */
+void game_enter(game_state state)
+{
+    int p = active_player;
+
+    players.state[p] = state;
+    switch (state)
+    {
+    case GAME_SELECT:
+        // Dont print instructions again if it's the initial round
+        if (!initial_round)
+            difficulty_level_inputs();
+        reset_game();
+        led_breathe(1);
+        break;
+    case GAME_QUESTION:
+        ask_question();
+        speedrun_prompt(p);
+        report_question(p);
+        break;
+    case GAME_REPLAY:
+        game_finished();
+        break;
+    case GAME_TRANSCRIBE:
+        transcription_start(p, session_unit(&players.session[p]));
+        break;
+    case GAME_QUIT:
+        printf("GOODBYE :(\n");
+        if (--players_left == 0)
+            quit = 1;
+        break;
+    default:
+        break;
+    }
+    report_state(p);
+    telemetry_game(p);
+    postmortem_checkpoint();
+}
+
+/**
+ * @brief Game task, runs one transition of a player's game for each complete input
+ *
+ * @param ctx    The player
+ * @param events The game_event bits posted to the task
+ */
+void game_task(void *ctx, uint32_t events)
+{
+    int p = (int)(intptr_t)ctx;
+
+    // Free keying text is printed as it comes, at whatever clock the game is idling at
+    if ((events & GAME_EVENT_TEXT) && players.state[p] == GAME_TRANSCRIBE)
     {
+        active_player = p;
+        if (transcription_show(p))
+            game_enter(GAME_SELECT);
     }
-    if (strcmp(current_input, ".----") == 0)
+
+    game_session *s = &players.session[p];
+    if (!(events & GAME_EVENT_INPUT) || !s->complete)
+        return;
+
+    active_player = p;
+    clock_set_op(CLOCK_OP_RENDER);
+
+    // Once the session has acted on the answer new keying can overwrite it, so keep it
+    char answer[SESSION_INPUT_SIZE];
+    strcpy(answer, s->input);
+
+    switch (players.state[p])
+    {
+    case GAME_SELECT:
+        // Check for level
+        check_input(answer);
+        if (s->phase == SESSION_QUIT)
+            game_enter(GAME_QUIT);
+        else if (strcmp(answer, TRANSCRIBE_SELECT) == 0)
+            game_enter(GAME_TRANSCRIBE);
+        else if (s->phase == SESSION_QUESTION)
+        {
+            speedrun_start(p);
+            print_level_banner(s->level);
+            game_enter(GAME_QUESTION);
+        }
+        else
+            game_enter(GAME_SELECT);
+        break;
+    case GAME_QUESTION:
     {
+        // The session asks the next question as it scores this one
+        int question = s->target;
+        check_input(answer);
+        report_verdict(p, s->correct, answer);
+        telemetry_round(p, s->correct, question);
+        speedrun_round(p, s->correct);
+        if (s->phase == SESSION_QUESTION)
+            game_enter(GAME_QUESTION);
+        else
+        {
+            print_level_result(s->level);
+            speedrun_level_end(p);
+            game_enter(GAME_REPLAY);
+        }
+        break;
+    }
+    case GAME_REPLAY:
+        select_replay();
+        game_enter(s->phase == SESSION_QUIT ? GAME_QUIT : GAME_SELECT);
+        break;
+    default:
+        break;
     }
-    else if (strcmp(current_input, "..---") == 0)
+}
+
+/**
+ * @brief Banner task, prints the boot report and (unless a session was resumed) the
+ *        welcome banners once the game is already accepting input
+ *
+ * @param ctx    1 - A checkpointed session was resumed
+ * @param events Unused
+ */
+void banner_task(void *ctx, uint32_t events)
+{
+    (void)events;
+    boot_report();
+    memory_report();
+    if (ctx)
+        return;
+    welcome();
+    instructions();
+    difficulty_level_inputs();
+}
+
+/**
+ * @brief Adds the game, LED and banner tasks to the scheduler, before the deferred
+ *        input work can post to them
+ *
+ * @param resumed 1 - A checkpointed session was resumed
+ */
+void scheduler_init(int resumed)
+{
+    sched_init(&sched);
+    for (int p = 0; p < NUM_PLAYERS; p++)
+        game_task_id[p] = sched_add(&sched, game_task, (void *)(intptr_t)p, "game");
+    led_task_id = sched_add(&sched, led_task, NULL, "led");
+    sched_post(&sched, sched_add(&sched, banner_task, (void *)(intptr_t)resumed, "banner"), 1);
+    inject_init_task();
+    telemetry_init_task();
+#if MORSE_TX
+    transmit_init_task();
+#endif
+}
+
+/**
+ * @brief Starts playing the game and doesn't quit out of this routine
+ * until every player has keyed the 'quit' character sequence
+ *
+ * @param resumed 1 - Carry on from the restored checkpoint, 0 - Start at the level select
+ */
+void start_game(int resumed)
+{
+    // A resumed session skipped the banners, so the level select is printed again
+    if (resumed)
+        initial_round = 0;
+
+    for (int p = 0; p < NUM_PLAYERS; p++)
     {
-        quit = 1;
+        active_player = p;
+        if (!resumed)
+        {
+            game_enter(GAME_SELECT);
+            continue;
+        }
+
+        if (players.state[p] == GAME_QUESTION)
+        {
+            print_level_banner(players.session[p].level);
+            set_correct_led();
+        }
+        game_enter(players.state[p]);
     }
-    else
+    initial_round = 0;
+
+    // Let the deferred work catch up on the edges keyed while booting
+    deferred_hold = 0;
+    scb_hw->icsr = M0PLUS_ICSR_PENDSVSET_BITS;
+    boot_mark("ready");
+
+    while (quit == 0)
     {
-        printf("Error: Invalid input.");
+        if (sched_run(&sched, time_us_32()) == 0)
+            scheduler_idle();
     }
 }
 
@@ -1167,28 +3292,53 @@ void game_finished()
  */
 int main()
 {
-    srand(time(NULL));
+    memory_init();
+    boot_mark("reset");
+
+    // Arm the keys first, edges are timestamped and queued from here on (the edge log's
+    // time base has to come before the first of them)
+    stations_init();
+    key_debounce_init();
+    edge_capture_init();
+    main_asm();
+#if AUDIO_INPUT
+    audio_init();
+#endif
+    boot_mark("keys");
+
     // Initialise all STDIO as we will be using the GPIOs
     stdio_init_all();
-    morse_init();
-    word_morse_init();
+    boot_mark("stdio");
+
+    // Must run before watchdog_enable(), which rewrites the scratch registers the reset reason is read from
+    int resumed = postmortem_init();
+    watchdog_enable(0x7fffff, 1); // Watchdog Enables to Max Timeout
+    boot_mark("postmortem");
+
+    hmm_init();
+    match_init();
+    transcription_init();
+    boot_mark("tables");
 
     // Initialise the PIO interface with the WS2812 code
     PIO pio = pio0;
     uint offset = pio_add_program(pio, &ws2812_program);
-    ws2812_program_init(pio, 0, offset, WS2812_PIN, 800000, IS_RGBW);
-    watchdog_enable(0x7fffff, 1); // Watchdog Enables to Max Timeout
-
-    welcome();
-    instructions();
-    difficulty_level_inputs();
+    ws2812_program_init(pio, 0, offset, WS2812_PIN, WS2812_FREQ, IS_RGBW);
+    clock_init();
     set_blue_led();
+    boot_mark("led");
 
-    main_asm();
+#if MORSE_TX
+    transmit_init();
+    boot_mark("transmit");
+#endif
 
-    start_game();
+    scheduler_init(resumed);
+    boot_mark("sched");
+
+    start_game(resumed);
 
     printf("\n\n\n");
 
     return (0);
-}
\ No newline at end of file
+}
@@ -0,0 +1,141 @@
+#include "edge_log.h"
+
+/**
+ * @file edge_log.c
+ * @brief A record's value is (delta << (1 + player_bits)) | (release << player_bits) | player,
+ * written 7 bits at a time from the bottom with the top bit set on every byte but the last.
+ * Positions count every byte ever written, so a cursor that has fallen behind the dropped
+ * records can tell how much it missed.
+ */
+
+void edge_log_init(edge_log *log, uint8_t *buf, uint32_t size, int shift, int player_bits, uint32_t now_us)
+{
+    log->buf = buf;
+    log->size = size;
+    log->head = 0;
+    log->tail = 0;
+    log->head_q = now_us >> shift;
+    log->tail_q = log->head_q;
+    log->records = 0;
+    log->dropped = 0;
+    log->shift = shift;
+    log->player_bits = player_bits;
+}
+
+/**
+ * @brief Reads the varint at a byte position of the ring
+ *
+ * @param value Set to the value
+ * @return uint32_t The length of the varint in bytes
+ */
+static uint32_t ring_varint(const edge_log *log, uint32_t pos, uint32_t *value)
+{
+    uint32_t v = 0;
+    uint32_t len = 0;
+    uint8_t byte;
+    do
+    {
+        byte = log->buf[(pos + len) & (log->size - 1)];
+        v |= (uint32_t)(byte & 0x7F) << (7 * len);
+        len++;
+    } while ((byte & 0x80) && len < EDGE_LOG_MAX_RECORD);
+
+    *value = v;
+    return len;
+}
+
+/**
+ * @brief Drops the oldest record
+ */
+static void drop_oldest(edge_log *log)
+{
+    uint32_t value;
+    log->tail += ring_varint(log, log->tail, &value);
+    log->tail_q += value >> (1 + log->player_bits);
+    log->dropped++;
+}
+
+void edge_log_add(edge_log *log, int player, int release, uint32_t time_us)
+{
+    uint32_t time_q = time_us >> log->shift;
+    uint32_t delta = time_q - log->head_q;
+    uint32_t value = (delta << (1 + log->player_bits)) | ((uint32_t)release << log->player_bits) | (uint32_t)player;
+
+    // A delta too big to pack (over an hour at 1 us) wraps, the edges around it keep their order
+    uint8_t record[EDGE_LOG_MAX_RECORD];
+    uint32_t len = 0;
+    while (value >= 0x80)
+    {
+        record[len++] = (value & 0x7F) | 0x80;
+        value >>= 7;
+    }
+    record[len++] = value;
+
+    while (log->size - (log->head - log->tail) < len)
+        drop_oldest(log);
+
+    for (uint32_t i = 0; i < len; i++)
+        log->buf[(log->head + i) & (log->size - 1)] = record[i];
+    log->head += len;
+    log->head_q = time_q;
+    log->records++;
+}
+
+void edge_log_rewind(const edge_log *log, edge_cursor *cursor)
+{
+    cursor->pos = log->tail;
+    cursor->time_q = log->tail_q;
+}
+
+int edge_log_read(const edge_log *log, edge_cursor *cursor, uint8_t *out, int max,
+                  edge_cursor *start, uint32_t *lost)
+{
+    *lost = 0;
+    if ((int32_t)(log->tail - cursor->pos) > 0)
+    {
+        *lost = log->tail - cursor->pos;
+        edge_log_rewind(log, cursor);
+    }
+    *start = *cursor;
+
+    // Copy whole records only, so every chunk decodes on its own
+    int copied = 0;
+    while (cursor->pos != log->head)
+    {
+        uint32_t value;
+        uint32_t len = ring_varint(log, cursor->pos, &value);
+        if (copied + (int)len > max)
+            break;
+
+        for (uint32_t i = 0; i < len; i++)
+            out[copied++] = log->buf[(cursor->pos + i) & (log->size - 1)];
+        cursor->pos += len;
+        cursor->time_q += value >> (1 + log->player_bits);
+    }
+    return copied;
+}
+
+int edge_log_decode(const uint8_t *bytes, int len, int *pos, uint32_t *time_q,
+                    int player_bits, edge_record *rec)
+{
+    uint32_t value = 0;
+    int i = *pos;
+    int shift = 0;
+    while (1)
+    {
+        if (i >= len || shift >= 7 * EDGE_LOG_MAX_RECORD)
+            return 0;
+        uint8_t byte = bytes[i++];
+        value |= (uint32_t)(byte & 0x7F) << shift;
+        shift += 7;
+        if (!(byte & 0x80))
+            break;
+    }
+
+    *pos = i;
+    *time_q += value >> (1 + player_bits);
+    rec->time_q = *time_q;
+    rec->player = value & ((1u << player_bits) - 1);
+    rec->release = (value >> player_bits) & 1;
+    return 1;
+}
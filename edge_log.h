@@ -0,0 +1,104 @@
+#ifndef EDGE_LOG_H
+#define EDGE_LOG_H
+
+#include <stdint.h>
+
+/**
+ * @file edge_log.h
+ * @brief Always-on capture of the raw key timeline. Each press or release is one record:
+ * the time since the previous record (in units of 2^shift microseconds) with the edge type
+ * and player packed below it, written as a LEB128 varint into a ring buffer. Keying at
+ * human speeds takes two or three bytes per edge, so a 4 KB buffer holds about 1,500 to
+ * 2,000 edges: a few minutes of continuous keying, not hours. The oldest records are
+ * dropped whole when the buffer is full, so anything kept longer has to be streamed off
+ * before it wraps. It has no hardware dependencies so the host tools use the same
+ * encoder and decoder.
+ */
+
+/**
+ * @def EDGE_LOG_MAX_RECORD
+ * Longest encoded record, a 32 bit varint
+ */
+#define EDGE_LOG_MAX_RECORD 5
+
+/** Struct defining one decoded edge */
+typedef struct edge_record
+{
+    uint32_t time_q; /*!< Absolute time of the edge, in units of 2^shift microseconds */
+    uint8_t player;  /*!< Player whose key it was */
+    uint8_t release; /*!< 0 - Press, 1 - Release */
+} edge_record;
+
+/** Struct defining a ring buffer of encoded edges */
+typedef struct edge_log
+{
+    uint8_t *buf;
+    uint32_t size;        /*!< Size of buf in bytes (power of 2) */
+    uint32_t head;        /*!< Total bytes ever written */
+    uint32_t tail;        /*!< Total bytes ever dropped, the oldest record starts here */
+    uint32_t head_q;      /*!< Time of the newest record */
+    uint32_t tail_q;      /*!< Time the oldest record's delta is relative to */
+    uint32_t records;     /*!< Total records ever written */
+    uint32_t dropped;     /*!< Records dropped to make room */
+    uint8_t shift;        /*!< Time resolution is 2^shift microseconds */
+    uint8_t player_bits;  /*!< Bits used for the player number */
+} edge_log;
+
+/** Struct defining a read position in a log, e.g. how far it has been streamed */
+typedef struct edge_cursor
+{
+    uint32_t pos;    /*!< Byte position (as head and tail count them) */
+    uint32_t time_q; /*!< Time the record at pos is relative to */
+} edge_cursor;
+
+/**
+ * @brief Sets up an empty log
+ *
+ * @param buf         Storage for the encoded records
+ * @param size        Size of buf, a power of 2
+ * @param shift       Time resolution is 2^shift microseconds
+ * @param player_bits Bits needed for the largest player number (0 for one player)
+ * @param now_us      Time the first record is relative to
+ */
+void edge_log_init(edge_log *log, uint8_t *buf, uint32_t size, int shift, int player_bits, uint32_t now_us);
+
+/**
+ * @brief Appends an edge, dropping the oldest records if there isn't room
+ *
+ * @param release 0 - Press, 1 - Release
+ */
+void edge_log_add(edge_log *log, int player, int release, uint32_t time_us);
+
+/**
+ * @brief Sets a cursor to the oldest record still in the log
+ */
+void edge_log_rewind(const edge_log *log, edge_cursor *cursor);
+
+/**
+ * @brief Copies whole records from the cursor onwards and advances it past them. If the
+ *        records at the cursor have already been dropped it skips to the oldest one left.
+ *
+ * @param out    Filled with the encoded records
+ * @param max    Size of out
+ * @param start  Set to the cursor the copied records start from
+ * @param lost   Set to the number of bytes skipped because they were dropped
+ * @return int The number of bytes copied
+ */
+int edge_log_read(const edge_log *log, edge_cursor *cursor, uint8_t *out, int max,
+                  edge_cursor *start, uint32_t *lost);
+
+/**
+ * @brief Decodes the next record of a stream of encoded records
+ *
+ * @param bytes       The encoded records
+ * @param len         Length of bytes
+ * @param pos         Read position, advanced past the record
+ * @param time_q      Time the record is relative to, updated to the record's time
+ * @param player_bits Bits used for the player number
+ * @param rec         The decoded record
+ * @return int 1 if a record was decoded, 0 at the end of the stream (or a cut off record)
+ */
+int edge_log_decode(const uint8_t *bytes, int len, int *pos, uint32_t *time_q,
+                    int player_bits, edge_record *rec);
+
+#endif
@@ -0,0 +1,144 @@
+#include "fmt.h"
+
+/**
+ * @file fmt.c
+ * @brief Digits are written backwards into a scratch buffer and copied out behind the
+ * padding. The divisions are 32-bit, which the RP2040's SIO divider does in 8 cycles.
+ */
+
+/** Powers of ten up to 10^FMT_MAX_DECIMALS */
+static const uint32_t pow10[FMT_MAX_DECIMALS + 1] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+
+/**
+ * @brief Writes the digits of v backwards, least significant first
+ *
+ * @param min_digits Least digits written, zero filled
+ * @return int The digits written
+ */
+static int digits_reversed(char *rev, uint32_t v, int min_digits)
+{
+    int n = 0;
+    do
+    {
+        rev[n++] = (char)('0' + v % 10);
+        v /= 10;
+    } while (v || n < min_digits);
+    return n;
+}
+
+/**
+ * @brief Copies a reversed string into out, right aligned in width
+ *
+ * @return char* out
+ */
+static char *emit(char *out, const char *rev, int n, int width)
+{
+    int pad = width > n ? width - n : 0;
+    if (pad > FMT_MAX_LEN - 1 - n)
+        pad = FMT_MAX_LEN - 1 - n;
+    char *o = out;
+    while (pad-- > 0)
+        *o++ = ' ';
+    while (n > 0)
+        *o++ = rev[--n];
+    *o = '\0';
+    return out;
+}
+
+char *fmt_uint(char *out, uint32_t v, int width)
+{
+    char rev[FMT_MAX_LEN];
+    return emit(out, rev, digits_reversed(rev, v, 1), width);
+}
+
+char *fmt_int(char *out, int32_t v, int width)
+{
+    char rev[FMT_MAX_LEN];
+    uint32_t magnitude = v < 0 ? 0u - (uint32_t)v : (uint32_t)v;
+    int n = digits_reversed(rev, magnitude, 1);
+    if (v < 0)
+        rev[n++] = '-';
+    return emit(out, rev, n, width);
+}
+
+char *fmt_hex(char *out, uint32_t v, int digits)
+{
+    char rev[FMT_MAX_LEN];
+    int n = 0;
+    if (digits > 8)
+        digits = 8;
+    do
+    {
+        rev[n++] = "0123456789abcdef"[v & 0xf];
+        v >>= 4;
+    } while (v || n < digits);
+    return emit(out, rev, n, 0);
+}
+
+/**
+ * @brief fmt_fixed() with a suffix character after the number (0 for none)
+ */
+static char *fixed_suffix(char *out, uint32_t num, uint32_t den, int decimals, int width, char suffix)
+{
+    char rev[FMT_MAX_LEN];
+    int n = 0;
+    if (suffix)
+        rev[n++] = suffix;
+    if (den == 0)
+    {
+        rev[0] = '-';
+        return emit(out, rev, 1, width);
+    }
+    if (decimals > FMT_MAX_DECIMALS)
+        decimals = FMT_MAX_DECIMALS;
+    if (decimals < 0)
+        decimals = 0;
+
+    // Long division: each step brings down a zero, so rem * 10 must fit. A larger den
+    // loses low bits of both, which is far below the last decimal shown
+    while (den > UINT32_MAX / 10)
+    {
+        num >>= 1;
+        den >>= 1;
+    }
+    uint32_t whole = num / den;
+    uint32_t rem = num % den;
+    uint32_t frac = 0;
+    for (int i = 0; i < decimals; i++)
+    {
+        rem *= 10;
+        frac = frac * 10 + rem / den;
+        rem %= den;
+    }
+    if (rem >= den - rem)
+    {
+        if (++frac == pow10[decimals])
+        {
+            frac = 0;
+            whole++;
+        }
+    }
+
+    if (decimals)
+    {
+        n += digits_reversed(rev + n, frac, decimals);
+        rev[n++] = '.';
+    }
+    n += digits_reversed(rev + n, whole, 1);
+    return emit(out, rev, n, width);
+}
+
+char *fmt_fixed(char *out, uint32_t num, uint32_t den, int decimals, int width)
+{
+    return fixed_suffix(out, num, den, decimals, width, 0);
+}
+
+char *fmt_percent(char *out, uint32_t part, uint32_t whole, int width)
+{
+    while (part > UINT32_MAX / 100)
+    {
+        part >>= 1;
+        whole >>= 1;
+    }
+    return fixed_suffix(out, part * 100, whole, 2, width, '%');
+}
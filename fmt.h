@@ -0,0 +1,72 @@
+#ifndef FMT_H
+#define FMT_H
+
+#include <stdint.h>
+
+/**
+ * @file fmt.h
+ * @brief Integer and fixed-point number formatting, so the game's output never needs
+ * float arithmetic or printf's float conversions (the RP2040 has no FPU, and %f pulls
+ * the soft-float routines and printf's float support into the image). Every function
+ * writes a NUL terminated string into the caller's buffer, at least FMT_MAX_LEN bytes,
+ * and returns it so the result can be passed straight to printf's %s. A width above the
+ * length of the number right aligns it in spaces. It has no hardware dependencies.
+ */
+
+/**
+ * @def FMT_MAX_LEN
+ * Buffer size for any formatted number, its sign, point, suffix and padding
+ */
+#define FMT_MAX_LEN 24
+
+/**
+ * @def FMT_MAX_DECIMALS
+ * Most digits after the point
+ */
+#define FMT_MAX_DECIMALS 6
+
+/**
+ * @brief Formats an unsigned integer
+ *
+ * @param width Least characters written, 0 for no padding
+ * @return char* out
+ */
+char *fmt_uint(char *out, uint32_t v, int width);
+
+/**
+ * @brief Formats a signed integer
+ *
+ * @param width Least characters written, 0 for no padding
+ * @return char* out
+ */
+char *fmt_int(char *out, int32_t v, int width);
+
+/**
+ * @brief Formats an unsigned integer in lower case hexadecimal, without a prefix
+ *
+ * @param digits Least digits written, zero filled, 0 for no padding
+ * @return char* out
+ */
+char *fmt_hex(char *out, uint32_t v, int digits);
+
+/**
+ * @brief Formats num / den to a number of decimal places, rounded half up, by long
+ *        division (no 64-bit or float arithmetic)
+ *
+ * @param den      Above 429,496,729 both are halved until the remainder times ten fits
+ * @param decimals Digits after the point, 0 to FMT_MAX_DECIMALS
+ * @param width    Least characters written, 0 for no padding
+ * @return char* out, "-" if den is 0
+ */
+char *fmt_fixed(char *out, uint32_t num, uint32_t den, int decimals, int width);
+
+/**
+ * @brief Formats part / whole as a percentage to two decimal places with a % sign
+ *
+ * @param part  Above 42,949,672 both are halved until part * 100 fits
+ * @param width Least characters written, 0 for no padding
+ * @return char* out, "-" if whole is 0
+ */
+char *fmt_percent(char *out, uint32_t part, uint32_t whole, int width);
+
+#endif
@@ -0,0 +1,412 @@
+#include <string.h>
+
+#include "game_session.h"
+
+/**
+ * @file game_session.c
+ * @brief The gap timing is the firmware's Gap Classification: the unit is a moving
+ * average of the player's own elements, a release longer than SESSION_GAP_LETTER_UNITS
+ * ends a letter and one longer than SESSION_GAP_WORD_UNITS submits the answer.
+ */
+
+const session_question session_letters[SESSION_LETTERS] = {
+    {"A", ".-"}, {"B", "-..."}, {"C", "-.-."}, {"D", "-.."}, {"E", "."}, {"F", "..-."},
+    {"G", "--."}, {"H", "...."}, {"I", ".."}, {"J", ".---"}, {"K", "-.-"}, {"L", ".-.."},
+    {"M", "--"}, {"N", "-."}, {"O", "---"}, {"P", ".--."}, {"Q", "--.-"}, {"R", ".-."},
+    {"S", "..."}, {"T", "-"}, {"U", "..-"}, {"V", "...-"}, {"W", ".--"}, {"X", "-..-"},
+    {"Y", "-.--"}, {"Z", "--.."}, {"0", "-----"}, {"1", ".----"}, {"2", "..---"},
+    {"3", "...--"}, {"4", "....-"}, {"5", "....."}, {"6", "-...."}, {"7", "--..."},
+    {"8", "---.."}, {"9", "----."},
+};
+
+const session_question session_words[SESSION_WORDS] = {
+    {"justin", ".--- ..- ... - .. -."},
+    {"conor", "-.-. --- -. --- .-."},
+    {"hannah", ".... .- -. -. .- ...."},
+    {"surya", "... ..- .-. -.-- .-"},
+    {"brian", "-... .-. .. .- -."},
+    {"apple", ".- .--. .--. .-.. ."},
+    {"banana", "-... .- -. .- -. .-"},
+    {"shoe", "... .... --- ."},
+    {"hat", ".... .- -"},
+    {"fish", "..-. .. ... ...."},
+    {"bird", "-... .. .-. -.."},
+    {"door", "-.. --- --- .-."},
+    {"table", "- .- -... .-.. ."},
+    {"lamp", ".-.. .- -- .--."},
+    {"spoon", "... .--. --- --- -."},
+    {"chair", "-.-. .... .- .. .-."},
+    {"sun", "... ..- -."},
+    {"bicycle", "-... .. -.-. -.-- -.-. .-.. ."},
+    {"ocean", "--- -.-. . .- -."},
+    {"compass", "-.-. --- -- .--. .- ... ..."},
+    {"umbrella", "..- -- -... .-. . .-.. .-.. .-"},
+    {"volcano", "...- --- .-.. -.-. .- -. ---"},
+    {"computer", "-.-. --- -- .--. ..- - . .-."},
+    {"system", "... -.-- ... - . --"},
+    {"game", "--. .- -- ."},
+};
+
+/** The level select options, in level order */
+static const char *const level_codes[] = {".----", "..---", "...--", "....-"};
+
+/**
+ * @brief Draws a number below n from the session's generator
+ */
+static uint32_t session_random(game_session *s, uint32_t n)
+{
+    uint32_t x = s->rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    s->rng = x;
+    return x % n;
+}
+
+/**
+ * @brief Updates the unit estimate with the unit implied by one element
+ *
+ * @param element_us The length of a dot, or a third of the length of a dash
+ */
+static void update_unit(game_session *s, uint32_t element_us)
+{
+    uint32_t unit = session_unit(s);
+
+    // Exponential moving average with a weight of 1/4 per element
+    int32_t delta = (int32_t)element_us - (int32_t)unit;
+    unit += delta / 4;
+
+    if (unit < SESSION_UNIT_MIN_US)
+        unit = SESSION_UNIT_MIN_US;
+    else if (unit > SESSION_UNIT_MAX_US)
+        unit = SESSION_UNIT_MAX_US;
+    s->unit_us = unit;
+}
+
+/**
+ * @brief Starts a level, or goes back to the level select with level 0
+ */
+static void start_level(game_session *s, int level)
+{
+    s->level = (uint8_t)level;
+    s->lives = SESSION_LIVES;
+    s->remaining = SESSION_ROUNDS;
+    s->right = 0;
+    s->wrong = 0;
+}
+
+/**
+ * @brief Asks the next question of the current level
+ */
+static uint32_t ask(game_session *s)
+{
+    s->phase = SESSION_QUESTION;
+    s->target = (uint8_t)session_random(s, s->level <= 2 ? SESSION_LETTERS : SESSION_WORDS);
+    return SESSION_EV_QUESTION;
+}
+
+/**
+ * @brief Acts on a complete input in the level select
+ */
+static uint32_t on_select(game_session *s)
+{
+    for (int level = 1; level <= 4; level++)
+    {
+        if (strcmp(s->input, level_codes[level - 1]) == 0)
+        {
+            start_level(s, level);
+            return ask(s);
+        }
+    }
+    if (strcmp(s->input, ".....") == 0)
+    {
+        s->phase = SESSION_QUIT;
+        return SESSION_EV_QUIT;
+    }
+    return SESSION_EV_INVALID;
+}
+
+/**
+ * @brief Checks a complete answer, scores it and asks the next question or ends the level
+ */
+static uint32_t on_answer(game_session *s, int accept)
+{
+    const session_question *q = session_current(s);
+    s->correct = accept || strcmp(s->input, q->code) == 0;
+
+    if (s->correct)
+    {
+        s->remaining--;
+        if (s->lives < SESSION_LIVES)
+            s->lives++;
+        s->right++;
+    }
+    else
+    {
+        session_decode(s->input, s->decoded, sizeof(s->decoded));
+        s->lives--;
+        s->remaining = SESSION_ROUNDS;
+        s->wrong++;
+    }
+
+    if (s->remaining > 0 && s->lives > 0)
+        return SESSION_EV_VERDICT | ask(s);
+
+    if (s->lives > 0)
+        s->wins++;
+    s->phase = SESSION_REPLAY;
+    return SESSION_EV_VERDICT | SESSION_EV_LEVEL_END;
+}
+
+/**
+ * @brief Acts on a complete input at the end of a level, anything but exit plays again
+ */
+static uint32_t on_replay(game_session *s)
+{
+    if (strcmp(s->input, "..---") == 0)
+    {
+        s->phase = SESSION_QUIT;
+        return SESSION_EV_QUIT;
+    }
+
+    uint32_t events = strcmp(s->input, ".----") == 0 ? 0 : SESSION_EV_INVALID;
+    start_level(s, 0);
+    s->phase = SESSION_SELECT;
+    return events | SESSION_EV_SELECT;
+}
+
+/**
+ * @brief Ends the input (dropping a trailing letter space) and holds it for session_answer()
+ */
+static uint32_t complete(game_session *s)
+{
+    if (s->length > 0 && s->input[s->length - 1] == ' ')
+        s->length--;
+    s->input[s->length] = '\0';
+    s->length = 0;
+    s->deadline_armed = 0;
+    s->word_gap = 0;
+    s->complete = 1;
+    return SESSION_EV_ANSWER;
+}
+
+/**
+ * @brief Adds an element or letter space to the input, keeping it terminated
+ */
+static uint32_t add_element(game_session *s, char c)
+{
+    if (s->length >= SESSION_INPUT_SIZE - 1)
+        return 0;
+    s->input[s->length++] = c;
+    s->input[s->length] = '\0';
+    return SESSION_EV_ELEMENT;
+}
+
+/**
+ * @brief Submits the input straight away if its last letter is the AR prosign
+ *
+ * @return int 1 if the input was submitted, 0 otherwise
+ */
+static int prosign_submit(game_session *s)
+{
+    int n = sizeof(SESSION_PROSIGN_SUBMIT) - 1;
+
+    // AR must follow at least one letter and a letter space
+    if (s->length <= n || s->input[s->length - n - 1] != ' ')
+        return 0;
+    if (strncmp(&s->input[s->length - n], SESSION_PROSIGN_SUBMIT, n) != 0)
+        return 0;
+
+    // Drop the prosign and the space before it
+    s->length -= n + 1;
+    return 1;
+}
+
+void session_init(game_session *s, uint32_t seed)
+{
+    memset(s, 0, sizeof(*s));
+    s->rng = seed ? seed : 0x9E3779B9u;
+    s->phase = SESSION_SELECT;
+    start_level(s, 0);
+}
+
+void session_restart(game_session *s)
+{
+    s->phase = SESSION_SELECT;
+    start_level(s, 0);
+    s->complete = 0;
+    s->length = 0;
+    s->input[0] = '\0';
+    s->deadline_armed = 0;
+    s->word_gap = 0;
+}
+
+void session_seed(game_session *s, uint32_t entropy)
+{
+    s->rng ^= entropy * 0x9E3779B9u;
+    if (s->rng == 0)
+        s->rng = 0x9E3779B9u;
+}
+
+uint32_t session_key(game_session *s, int pressed, uint32_t time_us)
+{
+    if (s->phase == SESSION_QUIT || s->complete)
+        return 0;
+
+    if (pressed)
+    {
+        s->key_down = 1;
+        s->press_us = time_us;
+        s->word_gap = 0;
+        s->deadline_armed = 0;
+        return 0;
+    }
+    if (!s->key_down)
+        return 0;
+
+    uint32_t duration = time_us - s->press_us;
+    s->key_down = 0;
+    s->release_us = time_us;
+
+    // Dot if the press was shorter than the long press time, otherwise dash
+    uint32_t events;
+    if (duration < SESSION_LONG_PRESS_US)
+    {
+        events = add_element(s, '.');
+        update_unit(s, duration);
+    }
+    else
+    {
+        events = add_element(s, '-');
+        update_unit(s, duration / 3);
+    }
+
+    // Start timing the gap that follows
+    s->word_gap = 0;
+    s->deadline_us = time_us + SESSION_GAP_LETTER_UNITS * session_unit(s);
+    s->deadline_armed = 1;
+    return events;
+}
+
+uint32_t session_poll(game_session *s, uint32_t now_us)
+{
+    uint32_t events = 0;
+    while (s->deadline_armed && (int32_t)(now_us - s->deadline_us) >= 0)
+    {
+        s->deadline_armed = 0;
+        if (s->key_down || s->length == 0)
+            break;
+
+        if (s->word_gap)
+            return events | complete(s);
+
+        // Letter gap, insert a space (or submit on AR) and time the rest of the word gap
+        s->word_gap = 1;
+        if (prosign_submit(s))
+            return events | complete(s);
+        if (s->level > 2)
+            events |= add_element(s, ' ');
+        s->deadline_us += (SESSION_GAP_WORD_UNITS - SESSION_GAP_LETTER_UNITS) * session_unit(s);
+        s->deadline_armed = 1;
+    }
+    return events;
+}
+
+int session_deadline(const game_session *s, uint32_t *at_us)
+{
+    if (!s->deadline_armed)
+        return 0;
+    *at_us = s->deadline_us;
+    return 1;
+}
+
+uint32_t session_answer(game_session *s, int accept)
+{
+    if (!s->complete)
+        return 0;
+
+    uint32_t events;
+    switch (s->phase)
+    {
+    case SESSION_SELECT:
+        events = on_select(s);
+        break;
+    case SESSION_QUESTION:
+        events = on_answer(s, accept);
+        break;
+    case SESSION_REPLAY:
+        events = on_replay(s);
+        break;
+    default:
+        events = 0;
+        break;
+    }
+
+    // Keys are taken again once the answer has been acted on
+    s->complete = 0;
+    return events;
+}
+
+uint32_t session_submit(game_session *s, const char *code)
+{
+    if (s->phase == SESSION_QUIT)
+        return 0;
+
+    size_t n = strlen(code);
+    if (n > SESSION_INPUT_SIZE - 1)
+        n = SESSION_INPUT_SIZE - 1;
+    memcpy(s->input, code, n);
+    s->length = (uint8_t)n;
+    s->key_down = 0;
+    return complete(s) | session_answer(s, 0);
+}
+
+uint32_t session_skip(game_session *s)
+{
+    if (s->phase != SESSION_QUESTION)
+        return 0;
+    return ask(s);
+}
+
+uint32_t session_unit(const game_session *s)
+{
+    return s->unit_us ? s->unit_us : SESSION_UNIT_DEFAULT_US;
+}
+
+const session_question *session_current(const game_session *s)
+{
+    if (s->phase != SESSION_QUESTION)
+        return NULL;
+    return s->level <= 2 ? &session_letters[s->target] : &session_words[s->target];
+}
+
+int session_decode(const char *code, char *text, int size)
+{
+    int n = 0, known = 1;
+    while (*code && n < size - 1)
+    {
+        // One letter's code, up to the next space
+        int len = 0;
+        while (code[len] && code[len] != ' ')
+            len++;
+
+        char c = '?';
+        for (int i = 0; i < SESSION_LETTERS; i++)
+        {
+            const char *letter = session_letters[i].code;
+            if ((int)strlen(letter) == len && strncmp(letter, code, len) == 0)
+            {
+                c = session_letters[i].text[0];
+                break;
+            }
+        }
+        known &= c != '?';
+        if (len > 0)
+            text[n++] = c;
+        code += len;
+        while (*code == ' ')
+            code++;
+    }
+    text[n] = '\0';
+    return known;
+}
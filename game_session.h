@@ -0,0 +1,252 @@
+#ifndef GAME_SESSION_H
+#define GAME_SESSION_H
+
+#include <stdint.h>
+
+/**
+ * @file game_session.h
+ * @brief The game's rounds, scoring and keying decode as a library: every call takes the
+ * session it works on, nothing is global, nothing blocks and nothing is printed. Each
+ * call returns what happened as SESSION_EV_* bits and the caller renders it from the
+ * session (the question, the verdict and the score), so any number of sessions can run
+ * at once, on any threads, as long as each session is only used by one at a time. The
+ * rules are the firmware's: the level select codes, 5 right answers in a row to win a
+ * level, 3 lives with one back for every right answer, and the same unit tracking gap
+ * timing and AR submit. A keyed answer is held until session_answer() acts on it, so the
+ * caller can look at it first (the firmware re-checks it with its HMM decoder and takes
+ * its own menu options), and nearest code suggestions are left to the caller. The
+ * firmware plays its game through this, and the question tables and timing constants
+ * here are the only copy. It has no hardware dependencies.
+ */
+
+/**
+ * @def SESSION_INPUT_SIZE
+ * Longest answer, in elements and spaces, including the terminator
+ */
+#define SESSION_INPUT_SIZE 100
+
+/**
+ * @def SESSION_LIVES
+ * Lives at the start of a level, and the most a player can have
+ */
+#define SESSION_LIVES 3
+
+/**
+ * @def SESSION_ROUNDS
+ * Right answers in a row that win a level
+ */
+#define SESSION_ROUNDS 5
+
+/**
+ * @def SESSION_LETTERS
+ * Letters and digits asked at levels 1 and 2
+ */
+#define SESSION_LETTERS 36
+
+/**
+ * @def SESSION_WORDS
+ * Words asked at levels 3 and 4
+ */
+#define SESSION_WORDS 25
+
+/**
+ * @def SESSION_LONG_PRESS_US
+ * Presses this long or longer are dashes
+ */
+#define SESSION_LONG_PRESS_US 250000
+
+/**
+ * @def SESSION_GAP_LETTER_UNITS
+ * Releases longer than this many units end a letter (midpoint of 1 and 3)
+ */
+#define SESSION_GAP_LETTER_UNITS 2
+
+/**
+ * @def SESSION_GAP_WORD_UNITS
+ * Releases longer than this many units end the word and submit it (midpoint of 3 and 7)
+ */
+#define SESSION_GAP_WORD_UNITS 5
+
+/**
+ * @def SESSION_UNIT_MIN_US
+ * Fastest unit the estimate may track (60 ms = 20 WPM)
+ */
+#define SESSION_UNIT_MIN_US 60000
+
+/**
+ * @def SESSION_UNIT_MAX_US
+ * Slowest unit the estimate may track, a dot can't be longer than SESSION_LONG_PRESS_US
+ */
+#define SESSION_UNIT_MAX_US SESSION_LONG_PRESS_US
+
+/**
+ * @def SESSION_UNIT_DEFAULT_US
+ * Unit assumed before the player has keyed anything
+ */
+#define SESSION_UNIT_DEFAULT_US (SESSION_LONG_PRESS_US / 2)
+
+/**
+ * @def SESSION_PROSIGN_SUBMIT
+ * The AR (end of message) prosign, keyed as its own letter to submit straight away
+ */
+#define SESSION_PROSIGN_SUBMIT ".-.-."
+
+/** Where a session's game is up to */
+typedef enum session_phase
+{
+    SESSION_SELECT,   /*!< Waiting for a level (or quit) to be keyed */
+    SESSION_QUESTION, /*!< Waiting for the answer to the question */
+    SESSION_REPLAY,   /*!< The level is over, waiting for play again or exit */
+    SESSION_QUIT      /*!< The player has left */
+} session_phase;
+
+/** What a call did, any combination can be returned */
+enum
+{
+    SESSION_EV_ELEMENT = 1u << 0,  /*!< A dot, dash or letter space was added to the input */
+    SESSION_EV_ANSWER = 1u << 1,   /*!< The input is complete, held for session_answer() */
+    SESSION_EV_INVALID = 1u << 2,  /*!< It wasn't one of the options of the level select or replay */
+    SESSION_EV_VERDICT = 1u << 3,  /*!< An answer was checked, see correct (and decoded if wrong) */
+    SESSION_EV_QUESTION = 1u << 4, /*!< A new question was asked */
+    SESSION_EV_LEVEL_END = 1u << 5, /*!< The level was won (lives left) or lost */
+    SESSION_EV_SELECT = 1u << 6,   /*!< Back at the level select */
+    SESSION_EV_QUIT = 1u << 7      /*!< The player has left */
+};
+
+/** Struct defining one player's game */
+typedef struct game_session
+{
+    // Game progress
+    uint8_t phase;     /*!< A session_phase */
+    uint8_t level;     /*!< 0 = Level select, 1 - 4 = level X */
+    uint8_t lives;
+    uint8_t remaining; /*!< Right answers still needed to win the level */
+    uint8_t target;    /*!< Index of the question in session_letters or session_words */
+    uint8_t correct;   /*!< 1 - The last answer checked was right */
+    uint16_t wins;     /*!< Levels won */
+    uint16_t right;    /*!< Right answers this level */
+    uint16_t wrong;    /*!< Wrong answers this level */
+    uint32_t rng;      /*!< xorshift32 state the questions are drawn from */
+
+    // Keying
+    uint32_t press_us;    /*!< Time of the last press */
+    uint32_t release_us;  /*!< Time of the last release */
+    uint32_t unit_us;     /*!< Estimate of the player's unit (dot) length, 0 before the first element */
+    uint32_t deadline_us; /*!< Time the next gap timeout is due */
+    uint8_t key_down;
+    uint8_t deadline_armed; /*!< 1 - A gap timeout is due at deadline_us */
+    uint8_t word_gap;       /*!< 0 - Next timeout is a letter gap, 1 - Next timeout is the word gap */
+
+    // The answer
+    uint8_t complete;                  /*!< 1 - input is an answer waiting for session_answer(), keys are ignored */
+    uint8_t length;                    /*!< Characters in input */
+    char input[SESSION_INPUT_SIZE];    /*!< The input being keyed, then the answer as it was submitted */
+    char decoded[SESSION_INPUT_SIZE];  /*!< The last wrong answer, decoded, with '?' for unknown letters */
+} game_session;
+
+/** Struct defining a question */
+typedef struct session_question
+{
+    const char *text; /*!< The letter or word */
+    const char *code; /*!< Its Morse code, letters separated by spaces */
+} session_question;
+
+extern const session_question session_letters[SESSION_LETTERS]; /*!< Levels 1 and 2 */
+extern const session_question session_words[SESSION_WORDS];     /*!< Levels 3 and 4 */
+
+/**
+ * @brief Starts a session at the level select
+ *
+ * @param seed Seeds the questions, any value
+ */
+void session_init(game_session *s, uint32_t seed);
+
+/**
+ * @brief Goes back to the level select, keeping the levels won and the unit estimate.
+ *        Any input is dropped.
+ */
+void session_restart(game_session *s);
+
+/**
+ * @brief Mixes something unpredictable, such as the time of a key press, into the
+ *        questions
+ */
+void session_seed(game_session *s, uint32_t entropy);
+
+/**
+ * @brief Feeds in a press or release of the key
+ *
+ * @param pressed 1 - Press, 0 - Release
+ * @param time_us When it happened, in order and no earlier than the last poll
+ * @return uint32_t SESSION_EV_* bits
+ */
+uint32_t session_key(game_session *s, int pressed, uint32_t time_us);
+
+/**
+ * @brief Runs the gap timeouts that are due, which add letter spaces and submit the answer
+ *
+ * @param now_us The current time
+ * @return uint32_t SESSION_EV_* bits
+ */
+uint32_t session_poll(game_session *s, uint32_t now_us);
+
+/**
+ * @brief Gets when session_poll() next has something to do
+ *
+ * @param at_us Set to the time, if there is one
+ * @return int 1 if a timeout is due at at_us, 0 if nothing is until the next key
+ */
+int session_deadline(const game_session *s, uint32_t *at_us);
+
+/**
+ * @brief Acts on the answer (or menu option) held in input: checks and scores it, and
+ *        asks the next question, ends the level or moves on from the menu
+ *
+ * @param accept 1 - Count the answer right even if it isn't exactly the code, because
+ *               the caller's own check accepted it
+ * @return uint32_t SESSION_EV_* bits, 0 if no answer was held
+ */
+uint32_t session_answer(game_session *s, int accept);
+
+/**
+ * @brief Submits a whole answer (or menu option) as if it had been keyed and acts on it,
+ *        for callers that take typed input
+ *
+ * @param code '.', '-' and ' ' between letters
+ * @return uint32_t SESSION_EV_* bits
+ */
+uint32_t session_submit(game_session *s, const char *code);
+
+/**
+ * @brief Asks a new question of the current level in place of the one being asked,
+ *        without scoring it, such as when a game is resumed
+ *
+ * @return uint32_t SESSION_EV_QUESTION, 0 if no question was being asked
+ */
+uint32_t session_skip(game_session *s);
+
+/**
+ * @brief Gets the unit estimate the gaps are timed with
+ *
+ * @return uint32_t The estimate, or SESSION_UNIT_DEFAULT_US before the first element
+ */
+uint32_t session_unit(const game_session *s);
+
+/**
+ * @brief Gets the question being asked
+ *
+ * @return const session_question* The question, NULL if none is being asked
+ */
+const session_question *session_current(const game_session *s);
+
+/**
+ * @brief Decodes an answer letter by letter
+ *
+ * @param code Letters separated by spaces
+ * @param text Filled with the letters, '?' for codes that aren't letters
+ * @param size Size of text
+ * @return int 1 if every letter was known, 0 otherwise
+ */
+int session_decode(const char *code, char *text, int size);
+
+#endif
@@ -0,0 +1,435 @@
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "tone_detect.h"
+
+/**
+ * @file audio_decode.c
+ * @brief Runs a WAV recording of a Morse tone through the firmware's tone detector, the
+ * same way the ADC's DMA buffers are fed to it, then decodes the edges to text. Reports
+ * the throughput of the detector and, given the text that was sent, the accuracy.
+ * It can also generate test recordings with a chosen speed and signal to noise ratio.
+ *
+ * Usage: audio_decode <in.wav> [expected text] [tone Hz] [block]
+ *        audio_decode --generate <out.wav> <text> [wpm] [SNR dB] [tone Hz] [sample Hz]
+ */
+
+/**
+ * @def BUFFER_SAMPLES
+ * Samples per detector call, the firmware's DMA buffer size
+ */
+#define BUFFER_SAMPLES 256
+
+/**
+ * @def MAX_TEXT
+ * Longest text decoded or generated
+ */
+#define MAX_TEXT 4096
+
+/** The letters and digits the game uses, in session_letters order (game_session.c) */
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--..", "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...",
+    "---..", "----."};
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// -------------------------------------- WAV files --------------------------------------
+
+static uint32_t read_le(const uint8_t *p, int bytes)
+{
+    uint32_t v = 0;
+    for (int i = bytes - 1; i >= 0; i--)
+        v = (v << 8) | p[i];
+    return v;
+}
+
+static void write_le(FILE *f, uint32_t v, int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        fputc((v >> (8 * i)) & 0xFF, f);
+}
+
+/**
+ * @brief Loads the first channel of an 8 or 16 bit PCM WAV file as 12 bit ADC samples
+ *
+ * @param rate  Set to the sample rate
+ * @param count Set to the number of samples
+ * @return uint16_t* The samples (malloc'd), NULL on error
+ */
+static uint16_t *load_wav(const char *path, uint32_t *rate, long *count)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return NULL;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    rewind(f);
+    uint8_t *data = malloc(size);
+    if (!data || fread(data, 1, size, f) != (size_t)size || size < 12 || memcmp(data, "RIFF", 4) || memcmp(data + 8, "WAVE", 4))
+    {
+        fprintf(stderr, "%s: not a WAV file\n", path);
+        fclose(f);
+        free(data);
+        return NULL;
+    }
+    fclose(f);
+
+    int channels = 0, bits = 0, format = 0;
+    uint16_t *samples = NULL;
+    for (long pos = 12; pos + 8 <= size;)
+    {
+        uint32_t len = read_le(data + pos + 4, 4);
+        const uint8_t *body = data + pos + 8;
+        if (pos + 8 + len > (uint32_t)size)
+            len = size - pos - 8;
+
+        if (memcmp(data + pos, "fmt ", 4) == 0 && len >= 16)
+        {
+            format = read_le(body, 2);
+            channels = read_le(body + 2, 2);
+            *rate = read_le(body + 4, 4);
+            bits = read_le(body + 14, 2);
+        }
+        else if (memcmp(data + pos, "data", 4) == 0 && format == 1 && channels > 0 && (bits == 8 || bits == 16))
+        {
+            int frame = channels * bits / 8;
+            *count = len / frame;
+            samples = malloc(*count * sizeof(uint16_t) + 1);
+            for (long i = 0; i < *count; i++)
+            {
+                const uint8_t *s = body + i * frame;
+                samples[i] = bits == 8 ? s[0] << 4 : (uint16_t)(((int16_t)read_le(s, 2) >> 4) + 2048);
+            }
+            break;
+        }
+        pos += 8 + len + (len & 1);
+    }
+    free(data);
+    if (!samples)
+        fprintf(stderr, "%s: only 8 and 16 bit PCM is supported\n", path);
+    return samples;
+}
+
+/**
+ * @brief Writes 16 bit mono PCM samples as a WAV file
+ */
+static int save_wav(const char *path, const int16_t *samples, long count, uint32_t rate)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        perror(path);
+        return 0;
+    }
+    fwrite("RIFF", 1, 4, f);
+    write_le(f, 36 + count * 2, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    write_le(f, 16, 4);
+    write_le(f, 1, 2);
+    write_le(f, 1, 2);
+    write_le(f, rate, 4);
+    write_le(f, rate * 2, 4);
+    write_le(f, 2, 2);
+    write_le(f, 16, 2);
+    fwrite("data", 1, 4, f);
+    write_le(f, count * 2, 4);
+    for (long i = 0; i < count; i++)
+        write_le(f, (uint16_t)samples[i], 2);
+    fclose(f);
+    return 1;
+}
+
+// -------------------------------------- Generating --------------------------------------
+
+/**
+ * @brief Standard normal random number (Box-Muller)
+ */
+static double gaussian(void)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = rand() / (RAND_MAX + 1.0);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+/**
+ * @brief Adds a keyed tone (or silence) of the given length to the recording, with 5 ms
+ *        raised cosine ramps so the keying doesn't click
+ */
+static void add_element(int16_t *out, long *n, long max, double seconds, int tone, double tone_hz,
+                        uint32_t rate, double amplitude, double noise)
+{
+    long len = (long)(seconds * rate);
+    long ramp = rate / 200;
+    for (long i = 0; i < len && *n < max; i++, (*n)++)
+    {
+        double v = 0;
+        if (tone)
+        {
+            double env = 1;
+            if (i < ramp)
+                env = 0.5 - 0.5 * cos(M_PI * i / ramp);
+            else if (len - i < ramp)
+                env = 0.5 - 0.5 * cos(M_PI * (len - i) / ramp);
+            v = amplitude * env * sin(2.0 * M_PI * tone_hz * *n / rate);
+        }
+        v += noise * gaussian();
+        out[*n] = (int16_t)(v > 32767 ? 32767 : v < -32768 ? -32768 : v);
+    }
+}
+
+static int generate(int argc, char **argv)
+{
+    if (argc < 4)
+        return 2;
+    const char *text = argv[3];
+    double wpm = argc > 4 ? atof(argv[4]) : 20;
+    double snr_db = argc > 5 ? atof(argv[5]) : 10;
+    double tone_hz = argc > 6 ? atof(argv[6]) : 700;
+    uint32_t rate = argc > 7 ? (uint32_t)atol(argv[7]) : 8000;
+
+    // PARIS timing, and the noise power over the whole band relative to the tone's
+    double unit = 1.2 / wpm;
+    double amplitude = 8000;
+    double noise = amplitude / sqrt(2.0) / pow(10.0, snr_db / 20);
+
+    long max = (long)(rate * (strlen(text) * 22 * unit + 1));
+    int16_t *out = malloc(max * sizeof(int16_t));
+    long n = 0;
+    add_element(out, &n, max, 0.3, 0, tone_hz, rate, amplitude, noise);
+    for (const char *c = text; *c; c++)
+    {
+        if (*c == ' ')
+        {
+            add_element(out, &n, max, 4 * unit, 0, tone_hz, rate, amplitude, noise);
+            continue;
+        }
+        const char *letter = strchr(letters, *c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c);
+        if (!letter || !*c)
+            continue;
+        for (const char *e = codes[letter - letters]; *e; e++)
+        {
+            add_element(out, &n, max, (*e == '-' ? 3 : 1) * unit, 1, tone_hz, rate, amplitude, noise);
+            add_element(out, &n, max, unit, 0, tone_hz, rate, amplitude, noise);
+        }
+        add_element(out, &n, max, 2 * unit, 0, tone_hz, rate, amplitude, noise);
+    }
+    add_element(out, &n, max, 0.3, 0, tone_hz, rate, amplitude, noise);
+
+    int ok = save_wav(argv[2], out, n, rate);
+    if (ok)
+        printf("%s: %.1f s at %lu Hz, %.0f WPM, %.0f dB SNR, %.0f Hz tone\n", argv[2], (double)n / rate,
+               (unsigned long)rate, wpm, snr_db, tone_hz);
+    free(out);
+    return ok ? 0 : 1;
+}
+
+// -------------------------------------- Decoding --------------------------------------
+
+static int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Estimates the unit from the tone lengths: the mean of the shorter of two
+ *        clusters (dots), found by splitting at the largest jump in the sorted lengths.
+ *        Each cluster must hold an eighth of the lengths, so a few noise blips can't
+ *        make a cluster of their own.
+ */
+static uint32_t estimate_unit(const uint32_t *marks, int count)
+{
+    uint32_t *sorted = malloc(count * sizeof(uint32_t));
+    memcpy(sorted, marks, count * sizeof(uint32_t));
+    qsort(sorted, count, sizeof(uint32_t), compare_u32);
+
+    int split = count;
+    if (sorted[count - 1] >= 2 * sorted[0])
+    {
+        double best = 0;
+        for (int i = count / 8 > 0 ? count / 8 : 1; i <= count - count / 8 && i < count; i++)
+        {
+            double ratio = (double)sorted[i] / sorted[i - 1];
+            if (ratio > best)
+            {
+                best = ratio;
+                split = i;
+            }
+        }
+    }
+    uint64_t sum = 0;
+    for (int i = 0; i < split; i++)
+        sum += sorted[i];
+    free(sorted);
+    return (uint32_t)(sum / split);
+}
+
+/**
+ * @brief Decodes edges to text: dot below 2 units, letter gap from 2 units and word
+ *        gap from 5 units, as the firmware spaces and submits
+ */
+static void decode_edges(const tone_edge *edges, int count, char *text, int size)
+{
+    uint32_t *marks = malloc((count / 2 + 1) * sizeof(uint32_t));
+    int n = 0;
+    for (int i = 1; i < count; i++)
+    {
+        if (edges[i].release && !edges[i - 1].release)
+            marks[n++] = edges[i].time_us - edges[i - 1].time_us;
+    }
+    text[0] = '\0';
+    if (n == 0)
+    {
+        free(marks);
+        return;
+    }
+    uint32_t unit = estimate_unit(marks, n);
+    free(marks);
+
+    char code[16];
+    int code_len = 0, len = 0;
+    for (int i = 0; i < count; i++)
+    {
+        const tone_edge *e = &edges[i];
+        int last = i + 1 == count;
+        if (!e->release && i > 0)
+        {
+            uint32_t gap = e->time_us - edges[i - 1].time_us;
+            if (gap >= 2 * unit && code_len > 0)
+            {
+                code[code_len] = '\0';
+                char found = '?';
+                for (int k = 0; k < 36; k++)
+                {
+                    if (strcmp(code, codes[k]) == 0)
+                        found = letters[k];
+                }
+                if (len < size - 2)
+                    text[len++] = found;
+                code_len = 0;
+            }
+            if (gap >= 5 * unit && len > 0 && len < size - 2)
+                text[len++] = ' ';
+        }
+        if (e->release && i > 0 && !edges[i - 1].release && code_len < (int)sizeof(code) - 1)
+            code[code_len++] = e->time_us - edges[i - 1].time_us < 2 * unit ? '.' : '-';
+        if (last && code_len > 0)
+        {
+            code[code_len] = '\0';
+            char found = '?';
+            for (int k = 0; k < 36; k++)
+            {
+                if (strcmp(code, codes[k]) == 0)
+                    found = letters[k];
+            }
+            if (len < size - 1)
+                text[len++] = found;
+        }
+    }
+    text[len] = '\0';
+    printf("Unit %lu us (%.1f WPM)\n", (unsigned long)unit, 1.2e6 / unit);
+}
+
+/**
+ * @brief Edit distance between two strings, ignoring case
+ */
+static int distance(const char *a, const char *b)
+{
+    int la = strlen(a), lb = strlen(b);
+    int *row = malloc((lb + 1) * sizeof(int));
+    for (int j = 0; j <= lb; j++)
+        row[j] = j;
+    for (int i = 1; i <= la; i++)
+    {
+        int diag = row[0];
+        row[0] = i;
+        for (int j = 1; j <= lb; j++)
+        {
+            int up = row[j];
+            char ca = a[i - 1] >= 'a' && a[i - 1] <= 'z' ? a[i - 1] - 'a' + 'A' : a[i - 1];
+            int cost = ca != b[j - 1];
+            int best = diag + cost;
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    int d = row[lb];
+    free(row);
+    return d;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--generate") == 0)
+        return generate(argc, argv);
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: audio_decode <in.wav> [expected text] [tone Hz] [block]\n"
+                        "       audio_decode --generate <out.wav> <text> [wpm] [SNR dB] [tone Hz] [sample Hz]\n");
+        return 2;
+    }
+
+    const char *expected = argc > 2 ? argv[2] : NULL;
+    uint32_t tone_hz = argc > 3 ? (uint32_t)atol(argv[3]) : 700;
+    int block = argc > 4 ? atoi(argv[4]) : 64;
+
+    uint32_t rate = 0;
+    long count = 0;
+    uint16_t *samples = load_wav(argv[1], &rate, &count);
+    if (!samples)
+        return 1;
+
+    // Fed a DMA buffer at a time, each stamped with the time of its first sample
+    long max_edges = count / block + 1;
+    tone_edge *edges = malloc(max_edges * sizeof(tone_edge));
+    int found = 0;
+    tone_detector t;
+    tone_init(&t, rate, tone_hz, block);
+    double t0 = now_ns();
+    for (long i = 0; i < count; i += BUFFER_SAMPLES)
+    {
+        int n = count - i < BUFFER_SAMPLES ? (int)(count - i) : BUFFER_SAMPLES;
+        uint32_t start_us = (uint32_t)(i * 1000000 / rate);
+        found += tone_process(&t, samples + i, n, start_us, edges + found, max_edges - found);
+    }
+    double elapsed = now_ns() - t0;
+
+    double seconds = (double)count / rate;
+    printf("%s: %.1f s at %lu Hz, %d edges, block %d (%.1f ms, %.0f Hz bandwidth)\n", argv[1], seconds,
+           (unsigned long)rate, found, block, 1000.0 * block / rate, (double)rate / block);
+    printf("Detector: %.2f ns/sample, %.0fx real time\n", elapsed / count, seconds * 1e9 / elapsed);
+
+    static char text[MAX_TEXT];
+    decode_edges(edges, found, text, sizeof(text));
+    printf("Decoded: %s\n", text);
+
+    int status = 0;
+    if (expected)
+    {
+        int d = distance(expected, text);
+        int len = strlen(expected);
+        printf("Expected: %s\nCharacter error rate: %.1f%% (%d edits)\n", expected, len ? 100.0 * d / len : 0.0, d);
+        status = d != 0;
+    }
+    free(edges);
+    free(samples);
+    return status;
+}
@@ -0,0 +1,301 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/**
+ * @file bench_game.c
+ * @brief Times the game's hot paths in the firmware's own code: assign02.c is built in
+ * against the host SDK stand-in (sdk/), so what is measured is exactly what runs on the
+ * board, only on a different CPU. Every case is warmed up, then timed as a number of
+ * samples and reported as percentiles. The game's console output goes to /dev/null so
+ * rendering is timed as formatting only.
+ *
+ * Usage: bench_game [samples]
+ *        bench_game --save <baseline file> [samples]
+ *        bench_game --check <baseline file> [tolerance %] [samples]
+ *
+ * --save writes the median of every case, --check exits non-zero if any median is more
+ * than the tolerance (default 25%) over its baseline.
+ */
+
+#define main firmware_main
+#include "assign02.c"
+#undef main
+
+/**
+ * @def WARMUP_SAMPLES
+ * Samples run and thrown away before each case is timed
+ */
+#define WARMUP_SAMPLES 20
+
+/**
+ * @def MAX_SAMPLES
+ * Most samples that can be taken of a case
+ */
+#define MAX_SAMPLES 10000
+
+/** Struct defining one benchmark case */
+typedef struct bench_case
+{
+    const char *name;  /*!< Name in the report and the baseline file (no spaces) */
+    void (*run)(void); /*!< Runs the case once */
+    int reps;          /*!< Runs per sample, so a sample is well above the clock resolution */
+} bench_case;
+
+static char answer[SESSION_INPUT_SIZE]; /*!< The keyed answer, as the game task passes it to check_input() */
+
+/**
+ * @brief Puts the active player at a level with an answer keyed and ready to check
+ *
+ * @param level  The level to play
+ * @param target Index of the question in session_letters or session_words
+ * @param code   The keyed answer
+ */
+static void setup_answer(int level, int target, const char *code)
+{
+    game_session *s = &players.session[0];
+    session_restart(s);
+    s->phase = SESSION_QUESTION;
+    s->level = level;
+    s->target = target;
+    strcpy(s->input, code);
+    s->complete = 1;
+    strcpy(answer, code);
+}
+
+/** Level 1, right answer: exact match against session_letters */
+static void letter_right(void)
+{
+    setup_answer(1, 0, session_letters[0].code);
+    check_input(answer);
+}
+
+/** Level 2, wrong answer: the decode against session_letters and the suggestions */
+static void letter_wrong(void)
+{
+    setup_answer(2, 0, session_letters[1].code);
+    check_input(answer);
+}
+
+/** Level 3, right answer: word verification against session_words */
+static void word_right(void)
+{
+    setup_answer(3, 0, session_words[0].code);
+    check_input(answer);
+}
+
+/** Level 3, wrong answer: the HMM re-check, the word decode and the suggestions */
+static void word_wrong_l3(void)
+{
+    setup_answer(3, 0, session_words[1].code);
+    check_input(answer);
+}
+
+/** Level 4, wrong answer: the HMM re-check, the word decode, the suggestions and the correction */
+static void word_wrong_l4(void)
+{
+    setup_answer(4, 0, session_words[2].code);
+    check_input(answer);
+}
+
+/**
+ * Keying a whole word through the deferred input work at 12 WPM: every press and release,
+ * and the gap timeouts that add the letter spaces and submit it
+ */
+static void key_word(void)
+{
+    const uint32_t unit = 100000;
+    game_session *s = &players.session[0];
+    session_restart(s);
+    s->phase = SESSION_QUESTION;
+    s->level = 3;
+
+    uint32_t t = 0, at;
+    for (const char *c = session_words[0].code; *c; c++)
+    {
+        if (*c == ' ')
+        {
+            t += 2 * unit;
+            continue;
+        }
+        process_timeout(0, t);
+        process_input_event(0, &(input_event){t, EVENT_PRESS});
+        t += *c == '-' ? 3 * unit : unit;
+        process_input_event(0, &(input_event){t, EVENT_RELEASE});
+        t += unit;
+    }
+    while (session_deadline(s, &at))
+        process_timeout(0, at);
+}
+
+/** The welcome banner */
+static void render_welcome(void)
+{
+    welcome();
+}
+
+/** The end of level stats */
+static void render_stats(void)
+{
+    game_session *s = &players.session[0];
+    s->right = 7;
+    s->wrong = 3;
+    s->wins = 2;
+    s->lives = 2;
+    calculate_stats(0);
+}
+
+static const bench_case cases[] = {
+    {"letter_right", letter_right, 50},
+    {"letter_wrong", letter_wrong, 50},
+    {"word_right", word_right, 50},
+    {"word_wrong_l3", word_wrong_l3, 50},
+    {"word_wrong_l4", word_wrong_l4, 50},
+    {"key_word", key_word, 200},
+    {"welcome", render_welcome, 50},
+    {"calculate_stats", render_stats, 50},
+};
+
+#define CASE_COUNT (int)(sizeof(cases) / sizeof(cases[0]))
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Value at percentile pct of a sorted array
+ */
+static double percentile(const double *v, int n, int pct)
+{
+    return v[(n - 1) * pct / 100];
+}
+
+/**
+ * @brief Times one case, filling ns with the sorted time per run of every sample
+ */
+static void time_case(const bench_case *c, double *ns, int samples)
+{
+    for (int i = 0; i < WARMUP_SAMPLES + samples; i++)
+    {
+        double t0 = now_ns();
+        for (int r = 0; r < c->reps; r++)
+            c->run();
+        double t = (now_ns() - t0) / c->reps;
+        if (i >= WARMUP_SAMPLES)
+            ns[i - WARMUP_SAMPLES] = t;
+    }
+    qsort(ns, samples, sizeof(ns[0]), compare_double);
+}
+
+/**
+ * @brief Looks up a case's median in a baseline file
+ *
+ * @return double The median (ns), or 0 if the case isn't in the file
+ */
+static double baseline_of(FILE *f, const char *name)
+{
+    char line[128], key[64];
+    double value;
+    rewind(f);
+    while (fgets(line, sizeof(line), f))
+    {
+        if (sscanf(line, "%63s %lf", key, &value) == 2 && strcmp(key, name) == 0)
+            return value;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    const char *save = NULL, *check = NULL;
+    double tolerance = 25;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "--save") == 0)
+    {
+        save = argv[2];
+        arg = 3;
+    }
+    else if (argc > 2 && strcmp(argv[1], "--check") == 0)
+    {
+        check = argv[2];
+        arg = 3;
+        if (argc > 3)
+            tolerance = atof(argv[arg++]);
+    }
+    int samples = argc > arg ? atoi(argv[arg]) : 200;
+    if (samples < 1 || samples > MAX_SAMPLES)
+        samples = 200;
+
+    FILE *baseline = NULL;
+    if (save || check)
+    {
+        baseline = fopen(save ? save : check, save ? "w" : "r");
+        if (!baseline)
+        {
+            perror(save ? save : check);
+            return 2;
+        }
+    }
+
+    // The report keeps the real stdout, the game's output is thrown away
+    FILE *out = fdopen(dup(fileno(stdout)), "w");
+    if (!out || !freopen("/dev/null", "w", stdout))
+        return 2;
+
+    hmm_init();
+    match_init();
+    stations_init();
+    clock_init();
+    scheduler_init(1);
+    deferred_hold = 0;
+
+    fprintf(out, "Game hot paths, %d warm-up + %d samples per case\n\n", WARMUP_SAMPLES, samples);
+    fprintf(out, "%-16s %10s %10s %10s %10s", "case", "min ns", "p50 ns", "p90 ns", "p99 ns");
+    fprintf(out, check ? " %10s %8s\n" : "\n", "base ns", "change");
+
+    static double ns[MAX_SAMPLES];
+    int failed = 0;
+    for (int i = 0; i < CASE_COUNT; i++)
+    {
+        time_case(&cases[i], ns, samples);
+        double p50 = percentile(ns, samples, 50);
+        fprintf(out, "%-16s %10.0f %10.0f %10.0f %10.0f", cases[i].name, ns[0], p50,
+                percentile(ns, samples, 90), percentile(ns, samples, 99));
+
+        if (save)
+            fprintf(baseline, "%s %.0f\n", cases[i].name, p50);
+        if (check)
+        {
+            double base = baseline_of(baseline, cases[i].name);
+            if (base <= 0)
+                fprintf(out, " %10s %8s", "-", "new");
+            else
+            {
+                double change = (p50 - base) / base * 100;
+                int slower = change > tolerance;
+                fprintf(out, " %10.0f %+7.1f%%%s", base, change, slower ? "  FAIL" : "");
+                failed += slower;
+            }
+        }
+        fprintf(out, "\n");
+    }
+
+    if (baseline)
+        fclose(baseline);
+    if (check)
+        fprintf(out, "\n%d case(s) more than %.0f%% over the baseline\n", failed, tolerance);
+    fclose(out);
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,195 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "morse_hmm.h"
+
+/**
+ * @file bench_hmm.c
+ * @brief Generates noisy keying of random words and compares the decoding accuracy of
+ * the firmware's threshold classifier with the HMM decoder, then times the decoder.
+ *
+ * Usage: bench_hmm [trials per row]
+ */
+
+/**
+ * @def LONG_PRESS
+ * Dot/dash threshold used by the firmware (microseconds)
+ */
+#define LONG_PRESS 250000
+
+/**
+ * @def UNIT_MIN_US
+ * Lower clamp of the firmware's unit estimate
+ */
+#define UNIT_MIN_US 60000
+
+/**
+ * @def MAX_ELEMENTS
+ * Most marks and gaps in one generated word
+ */
+#define MAX_ELEMENTS 128
+
+/** The letters and digits the game uses, in session_letters order (game_session.c) */
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--..", "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...",
+    "---..", "----."};
+
+/** Struct defining one generated word and its keying */
+typedef struct trace
+{
+    char word[HMM_MAX_TEXT];
+    int count;                      /*!< Number of durations, marks and gaps alternate */
+    uint32_t duration[MAX_ELEMENTS]; /*!< Mark, gap, mark, gap ... mark */
+} trace;
+
+/**
+ * @brief Random multiplicative timing error, log-normal with the given sigma
+ */
+static double jitter(double sigma)
+{
+    double u1 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    double u2 = (rand() + 1.0) / (RAND_MAX + 2.0);
+    return exp(sigma * sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2));
+}
+
+/**
+ * @brief Keys a random word of 1 - 8 letters at the given unit length and jitter
+ */
+static void generate(trace *t, double unit_us, double sigma)
+{
+    int len = 1 + rand() % 8;
+    t->count = 0;
+    for (int i = 0; i < len; i++)
+    {
+        int c = rand() % 36;
+        t->word[i] = letters[c];
+        for (const char *e = codes[c]; *e; e++)
+        {
+            if (t->count > 0)
+                t->duration[t->count++] = unit_us * (e == codes[c] ? 3 : 1) * jitter(sigma);
+            t->duration[t->count++] = unit_us * (*e == '-' ? 3 : 1) * jitter(sigma);
+        }
+    }
+    t->word[len] = '\0';
+}
+
+/**
+ * @brief The firmware's decoding: fixed LONG_PRESS threshold, gaps against an adaptive unit
+ */
+static void decode_threshold(const trace *t, uint32_t *unit_us, char *out)
+{
+    char code[8];
+    int code_len = 0, out_len = 0;
+
+    for (int i = 0; i <= t->count; i++)
+    {
+        int end_of_letter = (i == t->count) || (i % 2 == 1 && t->duration[i] >= 2 * *unit_us);
+        if (end_of_letter)
+        {
+            code[code_len] = '\0';
+            char c = '?';
+            for (int j = 0; j < 36; j++)
+            {
+                if (strcmp(code, codes[j]) == 0)
+                    c = letters[j];
+            }
+            out[out_len++] = c;
+            code_len = 0;
+        }
+        if (i == t->count || i % 2 == 1)
+            continue;
+
+        uint32_t d = t->duration[i];
+        uint32_t element = d < LONG_PRESS ? d : d / 3;
+        if (code_len < 7)
+            code[code_len++] = d < LONG_PRESS ? '.' : '-';
+
+        int32_t delta = (int32_t)element - (int32_t)*unit_us;
+        *unit_us += delta / 4;
+        if (*unit_us < UNIT_MIN_US)
+            *unit_us = UNIT_MIN_US;
+        else if (*unit_us > LONG_PRESS)
+            *unit_us = LONG_PRESS;
+    }
+    out[out_len] = '\0';
+}
+
+/**
+ * @brief Feeds a trace through the HMM decoder
+ */
+static int decode_hmm(morse_hmm *hmm, const trace *t, uint32_t unit_us, char *out)
+{
+    morse_hmm_reset(hmm, unit_us);
+    for (int i = 0; i < t->count; i++)
+    {
+        if (i % 2 == 0)
+            morse_hmm_mark(hmm, t->duration[i]);
+        else
+            morse_hmm_gap(hmm, t->duration[i]);
+    }
+    return morse_hmm_decode(hmm, out, HMM_MAX_TEXT);
+}
+
+int main(int argc, char **argv)
+{
+    int trials = argc > 1 ? atoi(argv[1]) : 2000;
+    static const int wpms[] = {6, 10, 15};
+    static const double sigmas[] = {0.1, 0.2, 0.3, 0.4};
+
+    static morse_hmm hmm;
+    morse_hmm_init(&hmm);
+    for (int i = 0; i < 36; i++)
+        morse_hmm_add_code(&hmm, letters[i], codes[i]);
+
+    srand(1);
+    printf("Word accuracy over %d random words per row\n\n", trials);
+    printf(" WPM  jitter  threshold     HMM   HMM conf\n");
+
+    long elements = 0;
+    double seconds = 0;
+    for (unsigned w = 0; w < sizeof(wpms) / sizeof(wpms[0]); w++)
+    {
+        for (unsigned s = 0; s < sizeof(sigmas) / sizeof(sigmas[0]); s++)
+        {
+            // PARIS timing, one unit is 1.2 s / WPM
+            double unit = 1200000.0 / wpms[w];
+            uint32_t unit_est = LONG_PRESS / 2;
+            int right_threshold = 0, right_hmm = 0;
+            long conf_sum = 0;
+
+            for (int i = 0; i < trials; i++)
+            {
+                trace t;
+                char out[HMM_MAX_TEXT * 2];
+                generate(&t, unit, sigmas[s]);
+
+                // The HMM starts from the unit the firmware knew before this word
+                uint32_t unit_before = unit_est;
+                decode_threshold(&t, &unit_est, out);
+                right_threshold += strcmp(out, t.word) == 0;
+
+                struct timespec t0, t1;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                conf_sum += decode_hmm(&hmm, &t, unit_before, out);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                seconds += (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) * 1e-9;
+                elements += t.count;
+                right_hmm += strcmp(out, t.word) == 0;
+            }
+
+            printf("%4d  %5.2f   %7.1f%%  %6.1f%%  %7.1f%%\n", wpms[w], sigmas[s],
+                   100.0 * right_threshold / trials, 100.0 * right_hmm / trials,
+                   (double)conf_sum / trials);
+        }
+    }
+
+    printf("\nHMM cost: %.3f us per element (%ld elements), state %zu bytes\n",
+           seconds * 1e6 / elements, elements, sizeof(hmm));
+    return 0;
+}
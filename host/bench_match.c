@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "morse_match.h"
+
+/**
+ * @file bench_match.c
+ * @brief Times the nearest code search against a large random word dictionary and checks
+ * the bit-parallel distance against the textbook dynamic programming version.
+ *
+ * Usage: bench_match [dictionary size] [queries]
+ */
+
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--.."};
+
+/**
+ * @brief Writes the code of a random word of 2 - 10 letters, at most max_len long
+ */
+static void random_word_code(char *out, int max_len)
+{
+    int letters = 2 + rand() % 9;
+    out[0] = '\0';
+    for (int i = 0; i < letters; i++)
+    {
+        const char *c = codes[rand() % 26];
+        if ((int)(strlen(out) + strlen(c) + 1) >= max_len)
+            break;
+        if (i > 0)
+            strcat(out, " ");
+        strcat(out, c);
+    }
+}
+
+/**
+ * @brief Keys a code with one random mistake
+ */
+static void corrupt(const char *in, char *out)
+{
+    int len = strlen(in);
+    int pos = rand() % len;
+    strcpy(out, in);
+    switch (rand() % 3)
+    {
+    case 0:
+        // Swap a dot and a dash
+        if (out[pos] != ' ')
+            out[pos] = out[pos] == '.' ? '-' : '.';
+        break;
+    case 1:
+        // Drop an element
+        memmove(&out[pos], &out[pos + 1], len - pos);
+        break;
+    default:
+        // Merge two letters
+        for (char *p = out; *p; p++)
+        {
+            if (*p == ' ')
+            {
+                memmove(p, p + 1, strlen(p));
+                break;
+            }
+        }
+        break;
+    }
+}
+
+/**
+ * @brief Reference Levenshtein distance
+ */
+static int dp_distance(const char *a, const char *b)
+{
+    int n = strlen(a), m = strlen(b);
+    int row[MATCH_MAX_LEN + 1];
+    for (int j = 0; j <= m; j++)
+        row[j] = j;
+    for (int i = 1; i <= n; i++)
+    {
+        int diag = row[0];
+        row[0] = i;
+        for (int j = 1; j <= m; j++)
+        {
+            int up = row[j];
+            int best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    return row[m];
+}
+
+static double now_us(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e6 + t.tv_nsec * 1e-3;
+}
+
+int main(int argc, char **argv)
+{
+    int size = argc > 1 ? atoi(argv[1]) : 5000;
+    int queries = argc > 2 ? atoi(argv[2]) : 2000;
+
+    char(*words)[MATCH_MAX_LEN + 1] = malloc(size * sizeof(*words));
+    match_code *dict = malloc(size * sizeof(*dict));
+    srand(1);
+    for (int i = 0; i < size; i++)
+    {
+        random_word_code(words[i], MATCH_MAX_LEN);
+        match_pack(words[i], &dict[i]);
+    }
+
+    // Check the bit-parallel kernel against the reference on random pairs
+    for (int i = 0; i < 20000; i++)
+    {
+        const char *a = words[rand() % size];
+        const char *b = words[rand() % size];
+        match_code pa, pb;
+        match_pack(a, &pa);
+        match_pack(b, &pb);
+        if (match_distance(&pa, &pb) != dp_distance(a, b))
+        {
+            printf("MISMATCH: \"%s\" vs \"%s\": %d != %d\n", a, b, match_distance(&pa, &pb), dp_distance(a, b));
+            return 1;
+        }
+    }
+
+    int found_original = 0;
+    int kinds[MATCH_OTHER + 1] = {0};
+    double total = 0;
+    for (int q = 0; q < queries; q++)
+    {
+        int target = rand() % size;
+        char keyed[MATCH_MAX_LEN + 1];
+        corrupt(words[target], keyed);
+
+        match_code input;
+        match_result results[3];
+        match_pack(keyed, &input);
+
+        double t0 = now_us();
+        int n = match_nearest(dict, size, &input, results, 3);
+        total += now_us() - t0;
+
+        for (int i = 0; i < n; i++)
+        {
+            if (strcmp(words[results[i].index], words[target]) == 0)
+                found_original++;
+        }
+        if (n > 0)
+            kinds[match_classify(&input, &dict[results[0].index])]++;
+    }
+
+    printf("Dictionary: %d words, %d queries with one mistake each\n", size, queries);
+    printf("Search: %.2f us per query (%.1f ns per entry)\n", total / queries, total * 1000 / queries / size);
+    printf("Original word in the top 3: %.1f%%\n", 100.0 * found_original / queries);
+    for (int k = 0; k <= MATCH_OTHER; k++)
+        printf("  %-18s %d\n", match_error_name(k), kinds[k]);
+
+    free(words);
+    free(dict);
+    return 0;
+}
@@ -0,0 +1,102 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "scheduler.h"
+
+/**
+ * @file bench_sched.c
+ * @brief Measures the scheduler's dispatch overhead: the cost of posting an event and
+ * running its (empty) handler, of a pass with every task ready, of expiring timers, and
+ * of an idle pass with nothing to do.
+ *
+ * Usage: bench_sched [iterations]
+ */
+
+static volatile uint32_t sink;
+
+/**
+ * @brief Handler that does no work, so only the scheduler is timed
+ */
+static void empty_task(void *ctx, uint32_t events)
+{
+    sink += events + (uint32_t)(size_t)ctx;
+}
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/**
+ * @brief Fills a scheduler with the given number of empty tasks
+ */
+static void setup(scheduler *s, int tasks)
+{
+    sched_init(s);
+    for (int i = 0; i < tasks; i++)
+        sched_add(s, empty_task, (void *)(size_t)i, "empty");
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = argc > 1 ? atol(argv[1]) : 2000000;
+    static const int sizes[] = {1, 4, 16, SCHED_MAX_TASKS};
+    static scheduler s;
+
+    printf("Scheduler dispatch overhead, %ld iterations per row\n\n", iterations);
+    printf("tasks  post+run  full pass  per task  timer+run  idle pass\n");
+    printf("           (ns)       (ns)      (ns)       (ns)       (ns)\n");
+
+    for (unsigned k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+    {
+        int tasks = sizes[k];
+        setup(&s, tasks);
+
+        // One event posted to one task, then dispatched
+        double t0 = now_ns();
+        for (long i = 0; i < iterations; i++)
+        {
+            sched_post(&s, i % tasks, 1);
+            sched_run(&s, 0);
+        }
+        double post_run = (now_ns() - t0) / iterations;
+
+        // Every task ready in the same pass
+        long passes = iterations / tasks;
+        t0 = now_ns();
+        for (long i = 0; i < passes; i++)
+        {
+            for (int t = 0; t < tasks; t++)
+                sched_post(&s, t, 1);
+            sched_run(&s, 0);
+        }
+        double full_pass = (now_ns() - t0) / passes;
+
+        // One timer expiring per pass
+        t0 = now_ns();
+        for (long i = 0; i < iterations; i++)
+        {
+            sched_timer(&s, i % tasks, (uint32_t)i);
+            sched_run(&s, (uint32_t)i);
+        }
+        double timer_run = (now_ns() - t0) / iterations;
+
+        // Nothing ready, every timer running but not due
+        for (int t = 0; t < tasks; t++)
+            sched_timer(&s, t, 0x7FFFFFFF);
+        t0 = now_ns();
+        for (long i = 0; i < iterations; i++)
+            sched_run(&s, 0);
+        double idle = (now_ns() - t0) / iterations;
+
+        if (s.dispatches == 0)
+            return 1;
+
+        printf("%5d  %8.1f  %9.1f  %8.1f  %9.1f  %9.1f\n", tasks, post_run, full_pass,
+               full_pass / tasks, timer_run, idle);
+    }
+    return 0;
+}
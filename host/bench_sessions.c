@@ -0,0 +1,318 @@
+#define _GNU_SOURCE
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "game_session.h"
+
+/**
+ * @file bench_sessions.c
+ * @brief Runs many game sessions (game_session.h) at once on host threads, the way a
+ * terminal trainer serving many users would. Each thread keeps a number of sessions live
+ * and steps them in turn, one key edge or gap timeout at a time, each with a simulated
+ * player keying at their own speed with timing jitter and a share of deliberate mistakes,
+ * in simulated time. A player plays a number of levels, then exits. Every verdict is
+ * checked against the answer the player meant to give, and the run fails if any differs.
+ * It reports sessions and answers per second per core (of the threads' CPU time), the
+ * cost of each call and the memory per session.
+ *
+ * Usage: bench_sessions [sessions per thread] [threads] [live sessions per thread] [mistake %]
+ */
+
+/**
+ * @def LEVELS_PER_SESSION
+ * Levels each simulated player plays before exiting
+ */
+#define LEVELS_PER_SESSION 3
+
+/**
+ * @def JITTER_PCT
+ * Most a simulated element or gap is off its ideal length, in percent
+ */
+#define JITTER_PCT 10
+
+/** Struct defining a simulated player and their session */
+typedef struct player
+{
+    game_session s;
+    uint32_t rng;
+    uint32_t now_us;     /*!< The player's simulated time */
+    uint32_t unit_us;    /*!< Their dot length, 8 to 12 WPM so every dash is over SESSION_LONG_PRESS_US */
+    char code[SESSION_INPUT_SIZE]; /*!< What they are keying */
+    int pos;             /*!< Next element of code to key */
+    int key_down;
+    int expect_correct;  /*!< 1 - code is the right answer */
+    int levels;          /*!< Levels started */
+    int active;          /*!< 1 - The session is live */
+} player;
+
+/** Struct defining one thread's work and results */
+typedef struct worker
+{
+    pthread_t thread;
+    int sessions;      /*!< Sessions to run */
+    int live;          /*!< Sessions kept live at once */
+    int mistake_pct;
+    uint32_t seed;
+    long done;         /*!< Sessions finished */
+    long edges;        /*!< Key edges fed in */
+    long polls;        /*!< Gap timeouts run */
+    long answers;      /*!< Answers checked */
+    long wins;         /*!< Levels won */
+    long misjudged;    /*!< Verdicts that weren't what the player meant */
+    double seconds;    /*!< CPU time the thread used */
+} worker;
+
+static uint32_t next_random(uint32_t *x)
+{
+    *x ^= *x << 13;
+    *x ^= *x >> 17;
+    *x ^= *x << 5;
+    return *x;
+}
+
+/**
+ * @brief Gets a length of some units with jitter
+ */
+static uint32_t jittered(player *p, int units)
+{
+    uint32_t ideal = units * p->unit_us;
+    int pct = (int)(next_random(&p->rng) % (2 * JITTER_PCT + 1)) - JITTER_PCT;
+    return ideal + (int32_t)ideal * pct / 100;
+}
+
+/**
+ * @brief Starts a new simulated player in a slot
+ */
+static void player_start(player *p, uint32_t seed)
+{
+    session_init(&p->s, seed);
+    p->rng = seed * 2654435761u + 1;
+    p->now_us = 0;
+    p->unit_us = 100000 + next_random(&p->rng) % 50000;
+    p->code[0] = '\0';
+    p->pos = 0;
+    p->key_down = 0;
+    p->levels = 0;
+    p->active = 1;
+}
+
+/**
+ * @brief Decides what the player keys next, from where their game is up to
+ */
+static void player_choose(player *p, int mistake_pct)
+{
+    static const char *const levels[] = {".----", "..---", "...--", "....-"};
+    const session_question *q;
+
+    p->expect_correct = 0;
+    switch (p->s.phase)
+    {
+    case SESSION_SELECT:
+        strcpy(p->code, levels[next_random(&p->rng) % 4]);
+        p->levels++;
+        break;
+    case SESSION_QUESTION:
+        q = session_current(&p->s);
+        if ((int)(next_random(&p->rng) % 100) < mistake_pct)
+        {
+            // Key another question's answer
+            int n = p->s.level <= 2 ? SESSION_LETTERS : SESSION_WORDS;
+            int other = (p->s.target + 1 + next_random(&p->rng) % (n - 1)) % n;
+            strcpy(p->code, p->s.level <= 2 ? session_letters[other].code : session_words[other].code);
+        }
+        else
+        {
+            strcpy(p->code, q->code);
+            p->expect_correct = 1;
+        }
+        break;
+    case SESSION_REPLAY:
+        strcpy(p->code, p->levels < LEVELS_PER_SESSION ? ".----" : "..---");
+        break;
+    default:
+        break;
+    }
+    p->pos = 0;
+}
+
+/**
+ * @brief Runs the player's next key edge, or the gap timeouts once they have keyed
+ *        everything, and checks any verdict
+ *
+ * @return int 1 while the session is live, 0 once the player has left
+ */
+static int player_step(player *p, worker *w)
+{
+    uint32_t events = 0;
+    if (p->code[p->pos] != '\0')
+    {
+        char c = p->code[p->pos];
+        if (c == ' ')
+        {
+            // Letter space: 3 units between the letters, 1 of which has already passed
+            p->now_us += jittered(p, 2);
+            p->pos++;
+            return 1;
+        }
+        events = session_poll(&p->s, p->now_us);
+        if (!p->key_down)
+        {
+            events |= session_key(&p->s, 1, p->now_us);
+            p->key_down = 1;
+            p->now_us += jittered(p, c == '.' ? 1 : 3);
+        }
+        else
+        {
+            events |= session_key(&p->s, 0, p->now_us);
+            p->key_down = 0;
+            p->pos++;
+            p->now_us += jittered(p, 1);
+        }
+        w->edges++;
+    }
+    else
+    {
+        // Everything keyed, wait out the gaps
+        uint32_t at;
+        if (session_deadline(&p->s, &at))
+        {
+            p->now_us = at;
+            events = session_poll(&p->s, p->now_us);
+            w->polls++;
+        }
+    }
+
+    // Nothing else checks the answer, so it is acted on straight away
+    if (events & SESSION_EV_ANSWER)
+        events |= session_answer(&p->s, 0);
+
+    if (events & SESSION_EV_VERDICT)
+    {
+        w->answers++;
+        w->misjudged += p->s.correct != p->expect_correct;
+    }
+    if ((events & SESSION_EV_LEVEL_END) && p->s.lives > 0)
+        w->wins++;
+    if (events & SESSION_EV_QUIT)
+        return 0;
+    if (events & SESSION_EV_ANSWER)
+    {
+        // Thinking time before the next answer
+        p->now_us += 500000 + next_random(&p->rng) % 1000000;
+        player_choose(p, w->mistake_pct);
+    }
+    return 1;
+}
+
+/**
+ * @brief Reads a clock in seconds
+ *
+ * @param clock CLOCK_MONOTONIC, or CLOCK_THREAD_CPUTIME_ID for the calling thread's CPU time
+ */
+static double now_seconds(clockid_t clock)
+{
+    struct timespec t;
+    clock_gettime(clock, &t);
+    return t.tv_sec + t.tv_nsec / 1e9;
+}
+
+/**
+ * @brief Worker thread, keeps its live sessions stepping until all of its sessions are done
+ */
+static void *worker_run(void *arg)
+{
+    worker *w = arg;
+    player *players = calloc(w->live, sizeof(player));
+    if (!players)
+        return NULL;
+
+    int started = 0;
+    double t0 = now_seconds(CLOCK_THREAD_CPUTIME_ID);
+    for (int i = 0; i < w->live && started < w->sessions; i++, started++)
+    {
+        player_start(&players[i], w->seed + started);
+        player_choose(&players[i], w->mistake_pct);
+    }
+
+    int live = started;
+    while (live > 0)
+    {
+        for (int i = 0; i < w->live; i++)
+        {
+            player *p = &players[i];
+            if (!p->active || player_step(p, w))
+                continue;
+
+            w->done++;
+            p->active = 0;
+            live--;
+            if (started < w->sessions)
+            {
+                player_start(p, w->seed + started++);
+                player_choose(p, w->mistake_pct);
+                live++;
+            }
+        }
+    }
+    w->seconds = now_seconds(CLOCK_THREAD_CPUTIME_ID) - t0;
+    free(players);
+    return NULL;
+}
+
+int main(int argc, char **argv)
+{
+    int sessions = argc > 1 ? atoi(argv[1]) : 20000;
+    int threads = argc > 2 ? atoi(argv[2]) : (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int live = argc > 3 ? atoi(argv[3]) : 1000;
+    int mistake_pct = argc > 4 ? atoi(argv[4]) : 10;
+    if (sessions < 1 || threads < 1 || live < 1)
+    {
+        fprintf(stderr, "Usage: bench_sessions [sessions per thread] [threads] [live sessions per thread] [mistake %%]\n");
+        return 2;
+    }
+
+    worker *workers = calloc(threads, sizeof(worker));
+    double t0 = now_seconds(CLOCK_MONOTONIC);
+    for (int i = 0; i < threads; i++)
+    {
+        workers[i].sessions = sessions;
+        workers[i].live = live;
+        workers[i].mistake_pct = mistake_pct;
+        workers[i].seed = 1 + (uint32_t)i * (uint32_t)sessions;
+        pthread_create(&workers[i].thread, NULL, worker_run, &workers[i]);
+    }
+
+    worker total = {0};
+    double busy = 0;
+    for (int i = 0; i < threads; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+        total.done += workers[i].done;
+        total.edges += workers[i].edges;
+        total.polls += workers[i].polls;
+        total.answers += workers[i].answers;
+        total.wins += workers[i].wins;
+        total.misjudged += workers[i].misjudged;
+        busy += workers[i].seconds;
+    }
+    double elapsed = now_seconds(CLOCK_MONOTONIC) - t0;
+
+    printf("%ld sessions on %d thread(s), %d live per thread, in %.2f s\n", total.done, threads, live, elapsed);
+    printf("%ld answers (%ld levels won), %ld key edges, %ld gap timeouts\n", total.answers, total.wins, total.edges,
+           total.polls);
+    printf("per core: %.0f sessions/s, %.0f answers/s, %.0f ns per key edge or timeout\n", total.done / busy,
+           total.answers / busy, busy * 1e9 / (total.edges + total.polls));
+    printf("memory: %zu bytes per session (%zu with the simulated player), %zu kB for all the live sessions\n",
+           sizeof(game_session), sizeof(player), (size_t)threads * live * sizeof(game_session) / 1024);
+    if (total.misjudged)
+    {
+        printf("FAIL: %ld verdicts differed from the answer the player meant\n", total.misjudged);
+        return 1;
+    }
+    free(workers);
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "transcribe.h"
+
+/**
+ * @file bench_transcribe.c
+ * @brief Feeds a long simulated session of random text through the transcription decoder,
+ * with timing jitter and the speed drifting between two WPMs, running the letter and
+ * word gap timeouts the way the firmware does. Checks the transcript against the text
+ * sent and times every call, so a cost that grows with the session length would show
+ * up in the worst case.
+ *
+ * Usage: bench_transcribe [minutes] [min WPM] [max WPM] [jitter %]
+ */
+
+/** The letters and digits the game uses, in session_letters order (game_session.c) */
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--..", "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...",
+    "---..", "----."};
+
+/** Struct defining the simulated firmware around the decoder */
+typedef struct session
+{
+    transcriber t;
+    uint32_t release_us; /*!< Time of the last release */
+    int pending;         /*!< 1 - A letter is waiting for its gap */
+    double calls;        /*!< Decoder calls timed */
+    double total_ns;     /*!< Time spent in them */
+    double worst_ns;     /*!< Longest single call */
+    char *out;           /*!< The transcript */
+    long out_len;
+    uint32_t cursor;     /*!< Read position in the decoder's text ring */
+} session;
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void account(session *s, double t0)
+{
+    double ns = now_ns() - t0;
+    s->calls++;
+    s->total_ns += ns;
+    if (ns > s->worst_ns)
+        s->worst_ns = ns;
+}
+
+/**
+ * @brief Reads the new text out of the ring, as the display task does
+ */
+static void drain(session *s)
+{
+    char buf[64];
+    uint32_t lost;
+    int n;
+    while ((n = transcribe_read(&s->t, &s->cursor, buf, sizeof(buf), &lost)) > 0)
+    {
+        memcpy(s->out + s->out_len, buf, n);
+        s->out_len += n;
+    }
+}
+
+/**
+ * @brief Runs the letter and word gap timeouts that fall before a press at time t
+ */
+static void gaps_before(session *s, uint32_t t)
+{
+    if (!s->pending)
+        return;
+    uint32_t unit = transcribe_unit(&s->t);
+    uint32_t gap = t - s->release_us;
+    if (gap >= 2 * unit)
+    {
+        double t0 = now_ns();
+        transcribe_letter(&s->t, s->release_us + 2 * unit);
+        account(s, t0);
+        s->pending = 0;
+    }
+    if (gap >= 5 * unit)
+    {
+        double t0 = now_ns();
+        transcribe_space(&s->t, s->release_us + 5 * unit);
+        account(s, t0);
+    }
+    drain(s);
+}
+
+/**
+ * @brief Length of an element of the given number of units, with jitter
+ */
+static uint32_t jittered(double unit_us, int units, double jitter)
+{
+    double r = (rand() / (double)RAND_MAX * 2 - 1) * jitter;
+    return (uint32_t)(unit_us * units * (1 + r));
+}
+
+/**
+ * @brief Edit distance between two strings
+ */
+static long distance(const char *a, long la, const char *b, long lb)
+{
+    long *row = malloc((lb + 1) * sizeof(long));
+    for (long j = 0; j <= lb; j++)
+        row[j] = j;
+    for (long i = 1; i <= la; i++)
+    {
+        long diag = row[0];
+        row[0] = i;
+        for (long j = 1; j <= lb; j++)
+        {
+            long up = row[j];
+            long best = diag + (a[i - 1] != b[j - 1]);
+            if (up + 1 < best)
+                best = up + 1;
+            if (row[j - 1] + 1 < best)
+                best = row[j - 1] + 1;
+            row[j] = best;
+            diag = up;
+        }
+    }
+    long d = row[lb];
+    free(row);
+    return d;
+}
+
+int main(int argc, char **argv)
+{
+    double minutes = argc > 1 ? atof(argv[1]) : 20;
+    double min_wpm = argc > 2 ? atof(argv[2]) : 15;
+    double max_wpm = argc > 3 ? atof(argv[3]) : 45;
+    double jitter = (argc > 4 ? atof(argv[4]) : 10) / 100;
+
+    static session s;
+    transcribe_init(&s.t);
+    for (int i = 0; i < 36; i++)
+        transcribe_add_code(&s.t, letters[i], codes[i]);
+    transcribe_reset(&s.t, 125000);
+
+    // Enough for the whole session at the top speed
+    long max_chars = (long)(minutes * max_wpm * 5 * 1.5) + 64;
+    char *sent = malloc(max_chars);
+    s.out = malloc(max_chars * 2);
+    long sent_len = 0;
+
+    // The speed drifts from min to max and back every 5 minutes
+    uint64_t end_us = (uint64_t)(minutes * 60e6);
+    uint64_t now = 1000000;
+    while (now < end_us && sent_len < max_chars - 16)
+    {
+        double phase = (double)(now % 300000000) / 300000000;
+        double wpm = min_wpm + (max_wpm - min_wpm) * (phase < 0.5 ? 2 * phase : 2 - 2 * phase);
+        double unit = 1.2e6 / wpm;
+
+        int word_len = 1 + rand() % 7;
+        for (int k = 0; k < word_len; k++)
+        {
+            int c = rand() % 36;
+            sent[sent_len++] = letters[c];
+            for (const char *e = codes[c]; *e; e++)
+            {
+                gaps_before(&s, (uint32_t)now);
+                uint32_t mark = jittered(unit, *e == '-' ? 3 : 1, jitter);
+
+                double t0 = now_ns();
+                transcribe_mark(&s.t, mark);
+                account(&s, t0);
+                s.pending = 1;
+
+                now += mark;
+                s.release_us = (uint32_t)now;
+                now += jittered(unit, e[1] ? 1 : (k + 1 < word_len ? 3 : 7), jitter);
+            }
+        }
+        sent[sent_len++] = ' ';
+    }
+    gaps_before(&s, (uint32_t)now + 10000000);
+
+    // The transcript ends with a space after the last word too
+    long d = distance(sent, sent_len, s.out, s.out_len);
+    printf("%.0f minutes, %.0f-%.0f WPM, %.0f%% jitter: %ld characters sent, %ld decoded\n", minutes,
+           min_wpm, max_wpm, jitter * 100, sent_len, s.out_len);
+    printf("Character error rate: %.3f%% (%ld edits), %lu unknown letters\n", 100.0 * d / sent_len, d,
+           (unsigned long)s.t.unknown);
+    printf("Decoder calls: %.0f, mean %.1f ns, worst %.0f ns\n", s.calls, s.total_ns / s.calls, s.worst_ns);
+    printf("Live rate at the end: %lu CPM, %lu WPM, unit %lu us\n", (unsigned long)transcribe_cpm(&s.t, (uint32_t)now),
+           (unsigned long)transcribe_cpm(&s.t, (uint32_t)now) / 5, (unsigned long)transcribe_unit(&s.t));
+    printf("Decoder state: %zu bytes, whatever the session length\n", sizeof(transcriber));
+
+    free(sent);
+    free(s.out);
+    return d * 100 > sent_len ? 1 : 0;
+}
@@ -0,0 +1,134 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file boot_stats.c
+ * @brief Reads console captures of any number of boots, collects the #BOOT line the
+ * firmware prints once it is ready and reports every boot phase's duration (the time
+ * since the end of the previous phase) and the boot to ready time across the boots.
+ * With a budget the exit status is non-zero when the median boot to ready time is
+ * over it, so it can gate a change the same way the benchmarks do.
+ *
+ * Usage: boot_stats [ready budget us] < console.log
+ */
+
+/**
+ * @def MAX_PHASES
+ * Most distinct phase names tracked
+ */
+#define MAX_PHASES 16
+
+/**
+ * @def MAX_BOOTS
+ * Most boots kept
+ */
+#define MAX_BOOTS 1024
+
+/** Struct defining the durations of one phase across the boots */
+typedef struct phase_stats
+{
+    char name[32];
+    unsigned long us[MAX_BOOTS]; /*!< Duration at each boot the phase appeared in */
+    int count;
+} phase_stats;
+
+phase_stats phases[MAX_PHASES];
+int phase_count = 0;
+
+/**
+ * @brief Finds (or adds) the stats of the named phase
+ */
+phase_stats *find_phase(const char *name)
+{
+    for (int i = 0; i < phase_count; i++)
+    {
+        if (strcmp(phases[i].name, name) == 0)
+            return &phases[i];
+    }
+    if (phase_count == MAX_PHASES)
+        return NULL;
+    phase_stats *s = &phases[phase_count++];
+    snprintf(s->name, sizeof(s->name), "%s", name);
+    s->count = 0;
+    return s;
+}
+
+int compare_ul(const void *a, const void *b)
+{
+    unsigned long x = *(const unsigned long *)a;
+    unsigned long y = *(const unsigned long *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Value at percentile pct of a sorted array
+ */
+unsigned long percentile(const unsigned long *v, int n, int pct)
+{
+    return v[(n - 1) * pct / 100];
+}
+
+int main(int argc, char **argv)
+{
+    unsigned long budget = argc > 1 ? strtoul(argv[1], NULL, 10) : 0;
+    phase_stats *ready = find_phase("boot to ready");
+
+    char line[1024];
+    int boots = 0;
+    while (fgets(line, sizeof(line), stdin))
+    {
+        char *fields = strstr(line, "#BOOT");
+        if (!fields || boots == MAX_BOOTS)
+            continue;
+
+        // Each field is <phase>=<time since reset>, the last one is the ready time
+        unsigned long previous = 0, at = 0;
+        int first = 1;
+        for (char *tok = strtok(fields + 5, " \r\n"); tok; tok = strtok(NULL, " \r\n"))
+        {
+            char *eq = strchr(tok, '=');
+            if (!eq)
+                continue;
+            *eq = '\0';
+            at = strtoul(eq + 1, NULL, 10);
+
+            // The first mark is reached before main() runs anything, it is the runtime init
+            phase_stats *s = find_phase(tok);
+            if (s && s->count < MAX_BOOTS)
+                s->us[s->count++] = first ? at : at - previous;
+            previous = at;
+            first = 0;
+        }
+        if (!first)
+        {
+            ready->us[ready->count++] = at;
+            boots++;
+        }
+    }
+
+    if (boots == 0)
+    {
+        printf("No #BOOT lines found\n");
+        return 1;
+    }
+
+    printf("%d boot(s)\n\n", boots);
+    printf("%-16s %8s %10s %10s %10s %10s\n", "phase", "boots", "min us", "median us", "p90 us", "max us");
+    for (int i = 1; i <= phase_count; i++)
+    {
+        // Boot to ready goes last
+        phase_stats *s = &phases[i % phase_count];
+        qsort(s->us, s->count, sizeof(s->us[0]), compare_ul);
+        printf("%-16s %8d %10lu %10lu %10lu %10lu\n", s->name, s->count, s->us[0],
+               percentile(s->us, s->count, 50), percentile(s->us, s->count, 90), s->us[s->count - 1]);
+    }
+
+    unsigned long median = percentile(ready->us, ready->count, 50);
+    if (budget && median > budget)
+    {
+        printf("\nFAIL: median boot to ready %lu us is over the %lu us budget\n", median, budget);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,225 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "edge_log.h"
+#include "morse_hmm.h"
+
+/**
+ * @file edge_replay.c
+ * @brief Reads a console capture of the firmware, decodes the #EDGES lines streamed at the
+ * end of each level and re-runs each answer through the same decoding the firmware uses:
+ * the LONG_PRESS threshold with the adaptive letter space, and the HMM decoder.
+ *
+ * Usage: edge_replay < console.log
+ */
+
+/**
+ * @def LONG_PRESS
+ * Dot/dash threshold used by the firmware (microseconds)
+ */
+#define LONG_PRESS 250000
+
+/**
+ * @def UNIT_MIN_US
+ * Lower clamp of the firmware's unit estimate
+ */
+#define UNIT_MIN_US 60000
+
+/**
+ * @def MAX_PLAYERS
+ * Most stations the firmware supports
+ */
+#define MAX_PLAYERS 16
+
+/**
+ * @def MAX_CODE
+ * Longest code kept for one answer
+ */
+#define MAX_CODE 100
+
+/** The letters and digits the game uses, in session_letters order (game_session.c) */
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--..", "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...",
+    "---..", "----."};
+
+/** Struct defining the replay state of one player */
+typedef struct replay
+{
+    uint32_t press_us;   /*!< Time of the last press */
+    uint32_t release_us; /*!< Time of the last release */
+    uint32_t unit_us;    /*!< The firmware's unit estimate */
+    int key_down;
+    int answers;         /*!< Answers replayed so far */
+    int marks;           /*!< Dots and dashes in the current answer */
+    char code[MAX_CODE]; /*!< The current answer as the threshold classifier sees it */
+    int code_len;
+    morse_hmm hmm;
+} replay;
+
+static replay players[MAX_PLAYERS];
+
+/**
+ * @brief Translates a code of letters separated by spaces, '?' for unknown letters
+ */
+static void translate(const char *code, char *out)
+{
+    char letter[MAX_CODE];
+    int n = 0;
+    for (const char *c = code;; c++)
+    {
+        if (*c == ' ' || *c == '\0')
+        {
+            letter[n] = '\0';
+            char found = '?';
+            for (int i = 0; i < 36; i++)
+            {
+                if (strcmp(letter, codes[i]) == 0)
+                    found = letters[i];
+            }
+            if (n > 0)
+                *out++ = found;
+            n = 0;
+            if (*c == '\0')
+                break;
+        }
+        else if (n < MAX_CODE - 1)
+            letter[n++] = *c;
+    }
+    *out = '\0';
+}
+
+/**
+ * @brief Prints the decoding of a player's current answer and starts a new one
+ */
+static void finish_answer(int p)
+{
+    replay *r = &players[p];
+    if (r->marks == 0)
+        return;
+
+    char text[MAX_CODE], hmm_text[HMM_MAX_TEXT];
+    r->code[r->code_len] = '\0';
+    translate(r->code, text);
+    int confidence = morse_hmm_decode(&r->hmm, hmm_text, sizeof(hmm_text));
+
+    printf("player %d answer %d: %-24s %-10s HMM %s (%d%%), unit %lu us\n", p, ++r->answers,
+           r->code, text, hmm_text, confidence, (unsigned long)r->unit_us);
+
+    r->marks = 0;
+    r->code_len = 0;
+    morse_hmm_reset(&r->hmm, r->unit_us);
+}
+
+/**
+ * @brief Feeds one edge through the firmware's classification
+ */
+static void replay_edge(const edge_record *e, int shift)
+{
+    replay *r = &players[e->player];
+    uint32_t t = e->time_q << shift;
+
+    if (!e->release)
+    {
+        uint32_t gap = t - r->release_us;
+        if (r->marks > 0)
+        {
+            // The firmware submits after 5 units and spaces letters after 2
+            if (gap >= 5 * r->unit_us)
+                finish_answer(e->player);
+            else
+            {
+                morse_hmm_gap(&r->hmm, gap);
+                if (gap >= 2 * r->unit_us && r->code_len < MAX_CODE - 1)
+                    r->code[r->code_len++] = ' ';
+            }
+        }
+        r->press_us = t;
+        r->key_down = 1;
+        return;
+    }
+
+    if (!r->key_down)
+        return;
+    uint32_t duration = t - r->press_us;
+    r->key_down = 0;
+    r->release_us = t;
+    morse_hmm_mark(&r->hmm, duration);
+    if (r->code_len < MAX_CODE - 1)
+        r->code[r->code_len++] = duration < LONG_PRESS ? '.' : '-';
+    r->marks++;
+
+    uint32_t element = duration < LONG_PRESS ? duration : duration / 3;
+    int32_t delta = (int32_t)element - (int32_t)r->unit_us;
+    r->unit_us += delta / 4;
+    if (r->unit_us < UNIT_MIN_US)
+        r->unit_us = UNIT_MIN_US;
+    else if (r->unit_us > LONG_PRESS)
+        r->unit_us = LONG_PRESS;
+}
+
+int main(void)
+{
+    for (int p = 0; p < MAX_PLAYERS; p++)
+    {
+        players[p].unit_us = LONG_PRESS / 2;
+        morse_hmm_init(&players[p].hmm);
+        for (int i = 0; i < 36; i++)
+            morse_hmm_add_code(&players[p].hmm, letters[i], codes[i]);
+        morse_hmm_reset(&players[p].hmm, players[p].unit_us);
+    }
+
+    char line[1024];
+    long edges = 0, bytes = 0;
+    while (fgets(line, sizeof(line), stdin))
+    {
+        int shift, player_bits;
+        unsigned long start, lost;
+        char hex[sizeof(line)];
+        int fields = sscanf(line, "#EDGES %d %d %lx %lu %1000s", &shift, &player_bits, &start, &lost, hex);
+        if (fields < 4)
+            continue;
+        if (fields == 4)
+            hex[0] = '\0';
+
+        if (lost)
+        {
+            // The answers in progress are cut short
+            for (int p = 0; p < MAX_PLAYERS; p++)
+            {
+                finish_answer(p);
+                players[p].key_down = 0;
+            }
+            printf("(%lu bytes of edges were dropped before they were streamed)\n", lost);
+        }
+
+        uint8_t data[sizeof(line) / 2];
+        int len = 0;
+        for (const char *h = hex; h[0] && h[1]; h += 2)
+        {
+            unsigned byte;
+            sscanf(h, "%2x", &byte);
+            data[len++] = byte;
+        }
+
+        int pos = 0;
+        uint32_t time_q = start;
+        edge_record e;
+        while (edge_log_decode(data, len, &pos, &time_q, player_bits, &e))
+        {
+            if (e.player < MAX_PLAYERS)
+                replay_edge(&e, shift);
+            edges++;
+        }
+        bytes += len;
+    }
+
+    for (int p = 0; p < MAX_PLAYERS; p++)
+        finish_answer(p);
+    if (edges > 0)
+        printf("%ld edges in %ld bytes (%.2f bytes per edge)\n", edges, bytes, (double)bytes / edges);
+    return 0;
+}
@@ -0,0 +1,116 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file mem_check.c
+ * @brief Lists the game's global buffers (memory_arenas in assign02.c, built against the
+ * host SDK stand-in) and fails if they add up to more than MEMORY_ARENA_BUDGET. The host
+ * build runs it after linking, so a change that grows the buffers past the budget fails
+ * the build. Pointers are twice the size here, so the host sizes are an upper bound on
+ * the board's. Given console captures it also reports the worst of the #MEM lines the
+ * firmware prints at boot and at the end of every game: the stack high-water marks of
+ * both cores and the deepest handler nesting, and fails if either stack came within
+ * the headroom of its end.
+ *
+ * Usage: mem_check [--headroom <bytes>] [console.log ...]
+ */
+
+#define main firmware_main
+#include "assign02.c"
+#undef main
+
+/**
+ * @def DEFAULT_HEADROOM
+ * Stack that must be left unused, in bytes
+ */
+#define DEFAULT_HEADROOM 256
+
+/** Struct defining the worst of the #MEM lines read */
+typedef struct mem_worst
+{
+    unsigned long used[2]; /*!< Deepest use of each core's stack */
+    unsigned long size[2]; /*!< Size of each core's stack */
+    unsigned long irq_depth;
+    int lines;
+} mem_worst;
+
+/**
+ * @brief Reads the #MEM lines of a console capture
+ *
+ * @return int 0 on success, -1 if it can't be opened
+ */
+static int read_log(const char *path, mem_worst *w)
+{
+    FILE *f = fopen(path, "r");
+    if (!f)
+    {
+        perror(path);
+        return -1;
+    }
+    char line[2048];
+    while (fgets(line, sizeof(line), f))
+    {
+        const char *at = strstr(line, "#MEM ");
+        unsigned long used[2], size[2], depth;
+        if (!at || sscanf(at, "#MEM core0=%lu/%lu core1=%lu/%lu irq_depth=%lu", &used[0], &size[0], &used[1],
+                          &size[1], &depth) != 5)
+            continue;
+        for (int c = 0; c < 2; c++)
+        {
+            if (used[c] > w->used[c])
+                w->used[c] = used[c];
+            w->size[c] = size[c];
+        }
+        if (depth > w->irq_depth)
+            w->irq_depth = depth;
+        w->lines++;
+    }
+    fclose(f);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1, failed = 0;
+    unsigned long headroom = DEFAULT_HEADROOM;
+    if (argc > 2 && strcmp(argv[1], "--headroom") == 0)
+    {
+        headroom = strtoul(argv[2], NULL, 10);
+        arg = 3;
+    }
+
+    uint32_t total = memory_arena_total();
+    printf("%-20s %8s %6s\n", "buffer", "bytes", "share");
+    for (int i = 0; i < MEMORY_ARENA_COUNT; i++)
+        printf("%-20s %8lu %5.1f%%\n", memory_arenas[i].name, (unsigned long)memory_arenas[i].bytes,
+               100.0 * memory_arenas[i].bytes / total);
+    printf("%-20s %8lu of a %lu byte budget\n", "total", (unsigned long)total, (unsigned long)MEMORY_ARENA_BUDGET);
+    if (total > MEMORY_ARENA_BUDGET)
+    {
+        printf("FAIL: the global buffers are over MEMORY_ARENA_BUDGET\n");
+        failed = 1;
+    }
+
+    mem_worst w = {{0, 0}, {0, 0}, 0, 0};
+    for (; arg < argc; arg++)
+    {
+        if (read_log(argv[arg], &w) < 0)
+            return 2;
+    }
+    if (w.lines == 0)
+        return failed;
+    printf("\n%d #MEM line(s), deepest handler nesting %lu\n", w.lines, w.irq_depth);
+    for (int c = 0; c < 2; c++)
+    {
+        if (w.size[c] == 0)
+        {
+            printf("core%d stack: not linked in\n", c);
+            continue;
+        }
+        int low = w.used[c] + headroom > w.size[c];
+        printf("core%d stack: %lu of %lu bytes used%s\n", c, w.used[c], w.size[c], low ? "  FAIL" : "");
+        failed |= low;
+    }
+    return failed;
+}
@@ -0,0 +1,434 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include "inject.h"
+
+/**
+ * @file morse_inject.c
+ * @brief Plays the game over the input injection protocol. It answers every @ASK with the
+ * right code (or, with a mistake rate, a corrupted one), checks each @VERDICT against what
+ * it sent, and exits non-zero on any mismatch. With --loopback it opens a pseudo-terminal
+ * and runs a simulated device on the other end, which parses the commands with the
+ * firmware's inject.c and classifies the edges with the firmware's timing rules, so the
+ * protocol can be exercised without a board.
+ *
+ * Usage: morse_inject <device | --loopback> [level] [answers] [unit_us] [mistake %]
+ */
+
+/**
+ * @def LONG_PRESS
+ * Dot/dash threshold used by the firmware (microseconds)
+ */
+#define LONG_PRESS 250000
+
+/**
+ * @def UNIT_MIN_US
+ * Lower clamp of the firmware's unit estimate
+ */
+#define UNIT_MIN_US 60000
+
+/**
+ * @def TIMEOUT_MS
+ * Longest wait for the device to say anything
+ */
+#define TIMEOUT_MS 30000
+
+static const char letters[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+static const char *const codes[] = {
+    ".-", "-...", "-.-.", "-..", ".", "..-.", "--.", "....", "..", ".---", "-.-", ".-..",
+    "--", "-.", "---", ".--.", "--.-", ".-.", "...", "-", "..-", "...-", ".--", "-..-",
+    "-.--", "--..", "-----", ".----", "..---", "...--", "....-", ".....", "-....", "--...",
+    "---..", "----."};
+static const char *const level_codes[] = {".....", ".----", "..---", "...--", "....-"};
+
+static uint32_t now_us(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint32_t)(t.tv_sec * 1000000ull + t.tv_nsec / 1000);
+}
+
+/**
+ * @brief Reads one line, waiting at most timeout_ms for each character
+ *
+ * @return int The length of the line, -1 on timeout or error
+ */
+static int read_line(int fd, char *line, int size, int timeout_ms)
+{
+    int len = 0;
+    while (1)
+    {
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) <= 0)
+            return -1;
+        char c;
+        if (read(fd, &c, 1) != 1)
+            return -1;
+        if (c == '\r')
+            continue;
+        if (c == '\n')
+            break;
+        if (len < size - 1)
+            line[len++] = c;
+    }
+    line[len] = '\0';
+    return len;
+}
+
+static void write_str(int fd, const char *s)
+{
+    size_t len = strlen(s);
+    while (len > 0)
+    {
+        ssize_t n = write(fd, s, len);
+        if (n <= 0)
+            return;
+        s += n;
+        len -= n;
+    }
+}
+
+/**
+ * @brief Puts a terminal into raw mode
+ */
+static void set_raw(int fd)
+{
+    struct termios t;
+    if (tcgetattr(fd, &t) == 0)
+    {
+        cfmakeraw(&t);
+        tcsetattr(fd, TCSANOW, &t);
+    }
+}
+
+// -------------------------------------- Simulated Device --------------------------------------
+
+/** Struct defining the simulated device's keying and game state */
+typedef struct sim
+{
+    int fd;
+    inject_state injector;
+    uint32_t press_us, release_us, unit_us, deadline;
+    int deadline_armed, word_gap, key_down;
+    char input[128];
+    int input_len;
+    int level, lives, remaining, question;
+    char state[16];
+} sim;
+
+/**
+ * @brief Enters a state and reports it, asking a new question in QUESTION
+ */
+static void sim_enter(sim *s, const char *state)
+{
+    char line[160];
+    snprintf(s->state, sizeof(s->state), "%s", state);
+    if (strcmp(state, "QUESTION") == 0)
+    {
+        s->question = rand() % 36;
+        snprintf(line, sizeof(line), "@ASK 0 %d %c %s\n", s->level, letters[s->question], codes[s->question]);
+        write_str(s->fd, line);
+    }
+    snprintf(line, sizeof(line), "@STATE 0 %s %d\n", state, s->level);
+    write_str(s->fd, line);
+}
+
+/**
+ * @brief Runs the game on a complete input
+ */
+static void sim_answer(sim *s)
+{
+    s->input[s->input_len] = '\0';
+    if (strcmp(s->state, "SELECT") == 0)
+    {
+        for (int l = 0; l < 5; l++)
+        {
+            if (strcmp(s->input, level_codes[l]) == 0)
+            {
+                s->level = l;
+                s->lives = 3;
+                s->remaining = 5;
+                sim_enter(s, l == 0 ? "QUIT" : "QUESTION");
+                return;
+            }
+        }
+        sim_enter(s, "SELECT");
+    }
+    else if (strcmp(s->state, "QUESTION") == 0)
+    {
+        // The simulation asks letters on every level
+        int correct = strcmp(s->input, codes[s->question]) == 0;
+        if (correct)
+        {
+            s->remaining--;
+            if (s->lives < 3)
+                s->lives++;
+        }
+        else
+        {
+            s->lives--;
+            s->remaining = 5;
+        }
+        char line[200];
+        snprintf(line, sizeof(line), "@VERDICT 0 %s %d %d %s\n", correct ? "CORRECT" : "WRONG",
+                 s->lives, s->remaining, s->input);
+        write_str(s->fd, line);
+        sim_enter(s, s->remaining > 0 && s->lives > 0 ? "QUESTION" : "REPLAY");
+    }
+    else if (strcmp(s->state, "REPLAY") == 0)
+    {
+        s->level = 0;
+        sim_enter(s, strcmp(s->input, "..---") == 0 ? "QUIT" : "SELECT");
+    }
+}
+
+/**
+ * @brief Classifies an edge the way the firmware's deferred input work does
+ */
+static void sim_edge(sim *s, const inject_edge *e)
+{
+    if (!e->release)
+    {
+        s->key_down = 1;
+        s->press_us = e->due_us;
+        s->deadline_armed = 0;
+        return;
+    }
+    if (!s->key_down)
+        return;
+
+    uint32_t duration = e->due_us - s->press_us;
+    s->key_down = 0;
+    s->release_us = e->due_us;
+    if (s->input_len < (int)sizeof(s->input) - 1)
+        s->input[s->input_len++] = duration < LONG_PRESS ? '.' : '-';
+
+    uint32_t element = duration < LONG_PRESS ? duration : duration / 3;
+    int32_t delta = (int32_t)element - (int32_t)s->unit_us;
+    s->unit_us += delta / 4;
+    if (s->unit_us < UNIT_MIN_US)
+        s->unit_us = UNIT_MIN_US;
+    else if (s->unit_us > LONG_PRESS)
+        s->unit_us = LONG_PRESS;
+
+    s->deadline = e->due_us + 2 * s->unit_us;
+    s->deadline_armed = 1;
+    s->word_gap = 0;
+}
+
+/**
+ * @brief Runs the letter and word gap timeouts
+ */
+static void sim_timeout(sim *s)
+{
+    s->deadline_armed = 0;
+    if (s->word_gap)
+    {
+        sim_answer(s);
+        s->input_len = 0;
+        return;
+    }
+    if (s->level > 2 && s->input_len < (int)sizeof(s->input) - 1)
+        s->input[s->input_len++] = ' ';
+    s->word_gap = 1;
+    s->deadline += 3 * s->unit_us;
+    s->deadline_armed = 1;
+}
+
+/**
+ * @brief The simulated device's main loop
+ */
+static int sim_run(int fd)
+{
+    sim s;
+    memset(&s, 0, sizeof(s));
+    s.fd = fd;
+    s.unit_us = LONG_PRESS / 2;
+    inject_init(&s.injector, 1);
+    snprintf(s.state, sizeof(s.state), "SELECT");
+    srand(2);
+
+    while (strcmp(s.state, "QUIT") != 0)
+    {
+        uint32_t now = now_us();
+        uint32_t due, wake = now + 1000000;
+        if (inject_next(&s.injector, &due) && (int32_t)(due - wake) < 0)
+            wake = due;
+        if (s.deadline_armed && (int32_t)(s.deadline - wake) < 0)
+            wake = s.deadline;
+
+        int wait_ms = (int32_t)(wake - now) > 0 ? (int)((wake - now + 999) / 1000) : 0;
+        struct pollfd pfd = {fd, POLLIN, 0};
+        if (poll(&pfd, 1, wait_ms) > 0)
+        {
+            char c, reply[32];
+            if (read(fd, &c, 1) != 1)
+                return 1;
+            if (inject_feed(&s.injector, c, now_us(), reply, sizeof(reply)))
+            {
+                strcat(reply, "\n");
+                write_str(fd, reply);
+                if (s.injector.lines == 1)
+                {
+                    snprintf(reply, sizeof(reply), "@STATE 0 %s %d\n", s.state, s.level);
+                    write_str(fd, reply);
+                }
+            }
+        }
+
+        // Edges first, a press cancels a gap timeout that falls due at the same time
+        inject_edge e;
+        now = now_us();
+        while (inject_due(&s.injector, now, &e))
+            sim_edge(&s, &e);
+        if (s.deadline_armed && !s.key_down && (int32_t)(now - s.deadline) >= 0)
+            sim_timeout(&s);
+    }
+    return 0;
+}
+
+// -------------------------------------- Player --------------------------------------
+
+/**
+ * @brief Keys a code on player 0
+ */
+static void key(int fd, uint32_t unit_us, const char *code)
+{
+    char line[INJECT_MAX_LINE];
+    inject_format_key(line, sizeof(line), 0, unit_us, code);
+    write_str(fd, line);
+}
+
+/**
+ * @brief Makes a code wrong by swapping its first element
+ */
+static void corrupt(char *code)
+{
+    code[0] = code[0] == '.' ? '-' : '.';
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "usage: %s <device | --loopback> [level] [answers] [unit_us] [mistake %%]\n", argv[0]);
+        return 2;
+    }
+    int level = argc > 2 ? atoi(argv[2]) : 1;
+    int answers = argc > 3 ? atoi(argv[3]) : 20;
+    uint32_t unit = argc > 4 ? strtoul(argv[4], NULL, 10) : 90000;
+    int mistakes = argc > 5 ? atoi(argv[5]) : 10;
+    if (level < 1 || level > 4)
+        level = 1;
+
+    // Dots and dashes are told apart by LONG_PRESS, not by the unit
+    if (unit >= LONG_PRESS || 3 * unit < LONG_PRESS)
+    {
+        fprintf(stderr, "unit must be from %d to %d us\n", (LONG_PRESS + 2) / 3, LONG_PRESS - 1);
+        return 2;
+    }
+
+    int fd;
+    pid_t child = -1;
+    if (strcmp(argv[1], "--loopback") == 0)
+    {
+        fd = posix_openpt(O_RDWR | O_NOCTTY);
+        if (fd < 0 || grantpt(fd) || unlockpt(fd))
+        {
+            perror("posix_openpt");
+            return 2;
+        }
+        child = fork();
+        if (child == 0)
+        {
+            int device = open(ptsname(fd), O_RDWR | O_NOCTTY);
+            set_raw(device);
+            exit(sim_run(device));
+        }
+    }
+    else
+    {
+        fd = open(argv[1], O_RDWR | O_NOCTTY);
+        if (fd < 0)
+        {
+            perror(argv[1]);
+            return 2;
+        }
+    }
+    set_raw(fd);
+    srand(1);
+
+    // Any command makes the device start reporting, X also clears a half sent script
+    write_str(fd, "X\n");
+
+    int sent = 0, verdicts = 0, mismatches = 0, expect_correct = 1;
+    uint32_t start = now_us();
+    char line[256];
+    while (read_line(fd, line, sizeof(line), TIMEOUT_MS) >= 0)
+    {
+        char state[16], answer[32], code[128], verdict[16];
+        int p, n, lives, remaining;
+
+        if (sscanf(line, "@STATE %d %15s %d", &p, state, &n) == 3 && p == 0)
+        {
+            if (strcmp(state, "QUIT") == 0)
+                break;
+            if (strcmp(state, "SELECT") == 0)
+                key(fd, unit, sent >= answers ? level_codes[0] : level_codes[level]);
+            else if (strcmp(state, "REPLAY") == 0)
+                key(fd, unit, sent >= answers ? "..---" : ".----");
+        }
+        else if (sscanf(line, "@ASK %d %d %31s %127[^\n]", &p, &n, answer, code) == 4 && p == 0)
+        {
+            if (sent >= answers)
+            {
+                // Lose the level to get back to the menu as fast as possible
+                corrupt(code);
+                expect_correct = 0;
+            }
+            else
+            {
+                expect_correct = rand() % 100 >= mistakes;
+                if (!expect_correct)
+                    corrupt(code);
+                sent++;
+            }
+            key(fd, unit, code);
+        }
+        else if (sscanf(line, "@VERDICT %d %15s %d %d", &p, verdict, &lives, &remaining) == 4 && p == 0)
+        {
+            verdicts++;
+            if ((strcmp(verdict, "CORRECT") == 0) != expect_correct)
+            {
+                mismatches++;
+                printf("MISMATCH: %s\n", line);
+            }
+        }
+        else if (strncmp(line, "@ERR", 4) == 0)
+        {
+            mismatches++;
+            printf("%s\n", line);
+        }
+    }
+
+    double seconds = (now_us() - start) / 1e6;
+    printf("%d answers, %d verdicts, %d mismatches in %.1f s (%.2f answers/s at %lu us per unit)\n",
+           sent, verdicts, mismatches, seconds, verdicts / seconds, (unsigned long)unit);
+
+    if (child > 0)
+    {
+        kill(child, SIGTERM);
+        waitpid(child, NULL, 0);
+    }
+    return mismatches > 0 || verdicts == 0;
+}
@@ -0,0 +1,260 @@
+#include <ctype.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/**
+ * @file morse_tx_timeline.c
+ * @brief Runs text through the firmware's Morse transmit path (the Morse Transmit
+ * section of assign02.c, built against the SDK stand-in) and prints the key down and
+ * key up timeline that the DMA feeds to the morse_tx PIO program. The words are taken
+ * as the DMA sends them, so the ping-pong buffers and their interrupts are run too. Every
+ * element and gap is checked against its length at the character and Farnsworth speeds,
+ * worked out here in floating point from the ARRL formula. The timeline is decoded back
+ * to text with session_letters and compared with what was sent. When the text starts
+ * with two PARIS words, the time from the start of one to the start of the next is
+ * checked against 60 s / the overall WPM. The host build runs it on PARIS PARIS.
+ *
+ * Usage: morse_tx_timeline [--wpm <character WPM>] [--farnsworth <overall WPM>] [--quiet] [text ...]
+ */
+
+#define main firmware_main
+#include "assign02.c"
+#undef main
+
+/**
+ * @def TIMELINE_MAX
+ * Most words the tool can take, about 1,500 letters
+ */
+#define TIMELINE_MAX 16384
+
+/**
+ * @def TOLERANCE_US
+ * Furthest an element or gap may be from its floating point length. The encoder
+ * rounds the dot down to a microsecond and gives the gaps what that leaves of PARIS, so
+ * they are up to 31 / 19 us a unit longer
+ */
+#define TOLERANCE_US 16
+
+uint32_t timeline[TIMELINE_MAX]; /*!< Words in the order the DMA sent them */
+int timeline_len;
+
+/**
+ * @brief Takes the words of each DMA transfer into the PIO's TX FIFO
+ */
+static void capture(volatile void *write_addr, const volatile void *read_addr, uint count)
+{
+    if (write_addr != &pio0->txf[MORSE_TX_SM])
+        return;
+    const volatile uint32_t *words = read_addr;
+    for (uint i = 0; i < count && timeline_len < TIMELINE_MAX; i++)
+        timeline[timeline_len++] = words[i];
+}
+
+/**
+ * @brief Finds the letter of a code in session_letters
+ *
+ * @return char The letter, '?' if the code isn't in the table
+ */
+static char decode_letter(const char *code)
+{
+    for (int i = 0; i < SESSION_LETTERS; i++)
+    {
+        if (strcmp(session_letters[i].code, code) == 0)
+            return session_letters[i].text[0];
+    }
+    return '?';
+}
+
+/**
+ * @brief Gets the text as it should decode: upper case, letters and digits of
+ *        session_letters only and single spaces between words
+ */
+static void expected_text(const char *text, char *out, int size)
+{
+    int n = 0;
+    for (; *text && n < size - 1; text++)
+    {
+        char c = (char)toupper((unsigned char)*text);
+        if (isspace((unsigned char)c))
+        {
+            if (n > 0 && out[n - 1] != ' ')
+                out[n++] = ' ';
+        }
+        else
+        {
+            for (int i = 0; i < SESSION_LETTERS; i++)
+            {
+                if (session_letters[i].text[0] == c)
+                    out[n++] = c;
+            }
+        }
+    }
+    while (n > 0 && out[n - 1] == ' ')
+        n--;
+    out[n] = '\0';
+}
+
+/**
+ * @brief Checks a length against its expected value
+ *
+ * @return int 1 if it is within TOLERANCE_US
+ */
+static int near(uint32_t us, double expected)
+{
+    return fabs(us - expected) <= TOLERANCE_US;
+}
+
+int main(int argc, char **argv)
+{
+    int wpm = MORSE_TX_WPM, farnsworth = MORSE_TX_FARNSWORTH_WPM, quiet = 0, arg = 1;
+    for (; arg < argc && strncmp(argv[arg], "--", 2) == 0; arg++)
+    {
+        if (strcmp(argv[arg], "--wpm") == 0 && arg + 1 < argc)
+            wpm = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--farnsworth") == 0 && arg + 1 < argc)
+            farnsworth = atoi(argv[++arg]);
+        else if (strcmp(argv[arg], "--quiet") == 0)
+            quiet = 1;
+        else
+            break;
+    }
+    if (wpm < 1 || farnsworth < 0 || (arg < argc && strncmp(argv[arg], "--", 2) == 0))
+    {
+        fprintf(stderr, "Usage: morse_tx_timeline [--wpm <character WPM>] [--farnsworth <overall WPM>] [--quiet] [text ...]\n");
+        return 2;
+    }
+
+    char text[MORSE_TX_QUEUE * 8] = "";
+    for (int i = arg; i < argc; i++)
+    {
+        if (i > arg)
+            strncat(text, " ", sizeof(text) - strlen(text) - 1);
+        strncat(text, argv[i], sizeof(text) - strlen(text) - 1);
+    }
+    if (arg == argc)
+        strcpy(text, "PARIS PARIS");
+
+    // The firmware's own set up, with the DMA captured
+    sched_init(&sched);
+    transmit_init();
+    transmit_init_task();
+    morse_tx_set_speed(&transmitter, wpm, farnsworth);
+    host_dma_sink = capture;
+
+    // Queue the text as the queue empties, the way a long message would be fed in
+    const char *next = text;
+    uint32_t wakeups = 0;
+    for (;;)
+    {
+        if (*next && transmitter.head - transmitter.tail < MORSE_TX_QUEUE)
+        {
+            char chunk[MORSE_TX_QUEUE + 1];
+            int n = MORSE_TX_QUEUE - (int)(transmitter.head - transmitter.tail);
+            strncpy(chunk, next, n);
+            chunk[n] = '\0';
+            transmit_send(chunk);
+            next += strlen(chunk);
+        }
+        int ran = sched_run(&sched, time_us_32());
+        if (dma_channel_get_irq1_status(transmit_dma))
+        {
+            transmit_dma_isr();
+            wakeups++;
+            continue;
+        }
+        if (ran == 0 && !*next && !transmit_busy)
+            break;
+    }
+
+    // The lengths worked out independently of morse_tx.c
+    double unit = 1.2e6 / wpm;
+    double letter_gap = 3 * unit, word_gap = 7 * unit;
+    if (farnsworth > 0 && farnsworth < wpm)
+    {
+        double gaps = (60.0 * wpm - 37.2 * farnsworth) / ((double)farnsworth * wpm) * 1e6;
+        letter_gap = gaps * 3 / 19;
+        word_gap = gaps * 7 / 19;
+    }
+
+    if (!quiet)
+        printf("%12s  %-4s  %10s  %6s\n", "start_us", "key", "length_us", "units");
+    char decoded[sizeof(text)], code[8];
+    int decoded_len = 0, code_len = 0, bad = 0, words = 0;
+    uint64_t t = 0, word_start[2] = {0, 0};
+    for (int i = 0; i < timeline_len; i++)
+    {
+        uint32_t level = MORSE_TX_WORD_LEVEL(timeline[i]);
+        uint32_t us = MORSE_TX_WORD_US(timeline[i]);
+        const char *what = "?";
+        if (level != (uint32_t)((i & 1) == 0))
+        {
+            what = "key down twice";
+            bad++;
+        }
+        else if (level)
+        {
+            int dash = near(us, 3 * unit);
+            if (dash || near(us, unit))
+            {
+                what = dash ? "-" : ".";
+                // The first element of each of the first two words
+                if (code_len == 0 && (decoded_len == 0 || decoded[decoded_len - 1] == ' ') && words < 2)
+                    word_start[words++] = t;
+                if (code_len < (int)sizeof(code) - 1)
+                    code[code_len++] = *what;
+            }
+            else
+            {
+                what = "not a dot or a dash";
+                bad++;
+            }
+        }
+        else if (near(us, unit) && i + 1 < timeline_len)
+            what = "";
+        else if (near(us, letter_gap) || near(us, word_gap))
+        {
+            code[code_len] = '\0';
+            decoded[decoded_len++] = decode_letter(code);
+            code_len = 0;
+            if (near(us, word_gap))
+                decoded[decoded_len++] = ' ';
+            what = near(us, word_gap) ? "word gap" : "letter gap";
+        }
+        else
+        {
+            what = "not a gap";
+            bad++;
+        }
+        if (!quiet)
+            printf("%12llu  %-4s  %10lu  %6.2f  %s\n", (unsigned long long)t, level ? "down" : "up",
+                   (unsigned long)us, us / unit, what);
+        t += us;
+    }
+    while (decoded_len > 0 && decoded[decoded_len - 1] == ' ')
+        decoded_len--;
+    decoded[decoded_len] = '\0';
+
+    char expected[sizeof(text)];
+    expected_text(text, expected, sizeof(expected));
+    printf("\n%d WPM characters, %d WPM overall: dot %.0f us, letter gap %.0f us, word gap %.0f us\n", wpm,
+           farnsworth > 0 && farnsworth < wpm ? farnsworth : wpm, unit, letter_gap, word_gap);
+    printf("%d words keyed over %.3f s from %lu DMA buffers, the CPU woke %lu times\n", timeline_len, t / 1e6,
+           (unsigned long)transmit_buffers, (unsigned long)wakeups);
+    printf("sent:    %s\ndecoded: %s\n", expected, decoded);
+
+    int failed = bad > 0 || strcmp(expected, decoded) != 0 || timeline_len == 0 ||
+                 MORSE_TX_WORD_LEVEL(timeline[timeline_len - 1]) != 0;
+    if (strncmp(expected, "PARIS PARIS", 11) == 0)
+    {
+        double paris_wpm = 60e6 / (double)(word_start[1] - word_start[0]);
+        int overall = farnsworth > 0 && farnsworth < wpm ? farnsworth : wpm;
+        int slow = fabs(paris_wpm - overall) > overall * 0.001;
+        printf("PARIS timed at %.3f WPM%s\n", paris_wpm, slow ? "  FAIL" : "");
+        failed |= slow;
+    }
+    if (failed)
+        printf("FAIL: %d element(s) or gap(s) mistimed, or the text didn't decode, or the key was left down\n", bad);
+    return failed;
+}
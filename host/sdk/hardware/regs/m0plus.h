@@ -0,0 +1,6 @@
+#ifndef HOST_HARDWARE_REGS_M0PLUS_H
+#define HOST_HARDWARE_REGS_M0PLUS_H
+
+#define M0PLUS_ICSR_PENDSVSET_BITS 0x10000000u
+
+#endif
@@ -0,0 +1,23 @@
+#ifndef HOST_HARDWARE_STRUCTS_IOBANK0_H
+#define HOST_HARDWARE_STRUCTS_IOBANK0_H
+
+#include <stdint.h>
+
+#include "hardware/address_mapped.h"
+
+typedef struct io_irq_ctrl_hw
+{
+    volatile uint32_t inte[4];
+    volatile uint32_t intf[4];
+    volatile uint32_t ints[4];
+} io_irq_ctrl_hw_t;
+
+typedef struct iobank0_hw
+{
+    volatile uint32_t intr[4];
+    io_irq_ctrl_hw_t proc0_irq_ctrl;
+} iobank0_hw_t;
+
+extern iobank0_hw_t *iobank0_hw;
+
+#endif
@@ -0,0 +1,16 @@
+#ifndef HOST_HARDWARE_STRUCTS_NVIC_H
+#define HOST_HARDWARE_STRUCTS_NVIC_H
+
+#include <stdint.h>
+
+typedef struct nvic_hw
+{
+    volatile uint32_t iser;
+    volatile uint32_t icer;
+    volatile uint32_t ispr;
+    volatile uint32_t icpr;
+} nvic_hw_t;
+
+extern nvic_hw_t *nvic_hw;
+
+#endif
@@ -0,0 +1,17 @@
+#ifndef HOST_HARDWARE_STRUCTS_SCB_H
+#define HOST_HARDWARE_STRUCTS_SCB_H
+
+#include <stdint.h>
+
+typedef struct armv6m_scb
+{
+    volatile uint32_t cpuid;
+    volatile uint32_t icsr;
+    volatile uint32_t vtor;
+    volatile uint32_t aircr;
+    volatile uint32_t scr;
+} armv6m_scb_t;
+
+extern armv6m_scb_t *scb_hw;
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef HOST_HARDWARE_STRUCTS_VREG_AND_CHIP_RESET_H
+#define HOST_HARDWARE_STRUCTS_VREG_AND_CHIP_RESET_H
+
+#include <stdint.h>
+
+typedef struct vreg_and_chip_reset_hw
+{
+    volatile uint32_t vreg;
+    volatile uint32_t bod;
+    volatile uint32_t chip_reset;
+} vreg_and_chip_reset_hw_t;
+
+extern vreg_and_chip_reset_hw_t *vreg_and_chip_reset_hw;
+
+#define VREG_AND_CHIP_RESET_CHIP_RESET_HAD_PSM_RESTART_BITS 0x00100000u
+#define VREG_AND_CHIP_RESET_CHIP_RESET_HAD_RUN_BITS 0x00010000u
+#define VREG_AND_CHIP_RESET_CHIP_RESET_HAD_POR_BITS 0x00000100u
+
+#endif
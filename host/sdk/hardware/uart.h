@@ -0,0 +1,13 @@
+#ifndef HOST_HARDWARE_UART_H
+#define HOST_HARDWARE_UART_H
+
+#include "pico/stdlib.h"
+
+typedef struct uart_inst uart_inst_t;
+
+extern uart_inst_t *uart0;
+#define uart_default uart0
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate);
+
+#endif
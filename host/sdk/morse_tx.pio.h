@@ -0,0 +1,26 @@
+#ifndef HOST_MORSE_TX_PIO_H
+#define HOST_MORSE_TX_PIO_H
+
+/**
+ * @file morse_tx.pio.h
+ * @brief Host stand-in for the header pico_generate_pio_header() makes from morse_tx.pio
+ */
+
+#include "hardware/pio.h"
+#include "hardware/clocks.h"
+
+extern const pio_program_t morse_tx_program;
+
+static inline void morse_tx_program_init(PIO pio, uint sm, uint offset, uint pin, uint tick_hz)
+{
+    (void)offset;
+    pio_gpio_init(pio, pin);
+    pio_sm_set_clkdiv(pio, sm, clock_get_hz(clk_sys) / (float)tick_hz);
+}
+
+static inline void morse_tx_program_set_tick(PIO pio, uint sm, uint tick_hz)
+{
+    pio_sm_set_clkdiv(pio, sm, clock_get_hz(clk_sys) / (float)tick_hz);
+}
+
+#endif
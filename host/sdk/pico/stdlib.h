@@ -0,0 +1,46 @@
+#ifndef HOST_PICO_STDLIB_H
+#define HOST_PICO_STDLIB_H
+
+/**
+ * @file stdlib.h
+ * @brief Host stand-in for the parts of the Pico SDK the firmware uses, so assign02.c
+ * can be built into the host benchmarks. The timer reads the host's monotonic clock,
+ * the console is stdio and the hardware calls do nothing (sdk_shim.c).
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+typedef unsigned int uint;
+
+#define PICO_ERROR_TIMEOUT (-1)
+#define PICO_DEFAULT_UART_BAUD_RATE 115200
+#define GPIO_IRQ_EDGE_FALL 0x4u
+#define GPIO_IRQ_EDGE_RISE 0x8u
+
+#define __not_in_flash_func(func) func
+#define __uninitialized_ram(var) var
+#define __wfi() ((void)0)
+
+bool stdio_init_all(void);
+void stdio_flush(void);
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param);
+int getchar_timeout_us(uint32_t timeout_us);
+int putchar_raw(int c);
+
+uint64_t time_us_64(void);
+uint32_t time_us_32(void);
+bool set_sys_clock_khz(uint32_t freq_khz, bool required);
+
+uint32_t save_and_disable_interrupts(void);
+void restore_interrupts(uint32_t status);
+
+void gpio_init(uint gpio);
+void gpio_set_dir(uint gpio, bool out);
+void gpio_pull_up(uint gpio);
+bool gpio_get(uint gpio);
+void gpio_put(uint gpio, bool value);
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled);
+
+#endif
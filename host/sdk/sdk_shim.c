@@ -0,0 +1,173 @@
+#include <stdio.h>
+#include <time.h>
+
+#include "pico/stdlib.h"
+#include "hardware/clocks.h"
+#include "hardware/dma.h"
+#include "hardware/irq.h"
+#include "hardware/pio.h"
+#include "hardware/uart.h"
+#include "hardware/watchdog.h"
+#include "hardware/structs/iobank0.h"
+#include "hardware/structs/nvic.h"
+#include "hardware/structs/scb.h"
+#include "hardware/structs/vreg_and_chip_reset.h"
+#include "ws2812.pio.h"
+#include "morse_tx.pio.h"
+
+/**
+ * @file sdk_shim.c
+ * @brief Host implementations of the Pico SDK calls (and the assign02.S entry points)
+ * that assign02.c makes. There is no hardware: the registers are plain structs, the
+ * LED and GPIO calls do nothing and the clock is the host's monotonic clock.
+ */
+
+static watchdog_hw_t watchdog_regs;
+static armv6m_scb_t scb_regs;
+static iobank0_hw_t iobank0_regs;
+static nvic_hw_t nvic_regs;
+static vreg_and_chip_reset_hw_t vreg_regs = {0, 0, VREG_AND_CHIP_RESET_CHIP_RESET_HAD_POR_BITS};
+static uint32_t sys_khz = 125000;
+static pio_hw_t pio0_regs;
+
+watchdog_hw_t *watchdog_hw = &watchdog_regs;
+armv6m_scb_t *scb_hw = &scb_regs;
+iobank0_hw_t *iobank0_hw = &iobank0_regs;
+nvic_hw_t *nvic_hw = &nvic_regs;
+vreg_and_chip_reset_hw_t *vreg_and_chip_reset_hw = &vreg_regs;
+PIO pio0 = &pio0_regs;
+uart_inst_t *uart0 = NULL;
+const pio_program_t ws2812_program = {NULL, 0, -1};
+const pio_program_t morse_tx_program = {NULL, 0, -1};
+
+// -------------------------------------- Stacks --------------------------------------
+
+// The linker script's stack bounds, over 2 kB for each core that nothing runs on
+static uint32_t host_stacks[2][512] __attribute__((used));
+__asm__(".globl __StackBottom, __StackTop, __StackOneBottom, __StackOneTop\n"
+        ".set __StackBottom, host_stacks\n"
+        ".set __StackTop, host_stacks + 2048\n"
+        ".set __StackOneBottom, host_stacks + 2048\n"
+        ".set __StackOneTop, host_stacks + 4096\n");
+
+// -------------------------------------- Console --------------------------------------
+
+bool stdio_init_all(void) { return true; }
+void stdio_flush(void) { fflush(stdout); }
+void stdio_set_chars_available_callback(void (*fn)(void *), void *param) { (void)fn, (void)param; }
+int getchar_timeout_us(uint32_t timeout_us) { (void)timeout_us; return PICO_ERROR_TIMEOUT; }
+int putchar_raw(int c) { return putchar(c); }
+
+// -------------------------------------- Time --------------------------------------
+
+uint64_t time_us_64(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t time_us_32(void) { return (uint32_t)time_us_64(); }
+
+bool set_sys_clock_khz(uint32_t freq_khz, bool required)
+{
+    (void)required;
+    sys_khz = freq_khz;
+    return true;
+}
+
+uint32_t clock_get_hz(enum clock_index clk_index) { return clk_index == clk_sys ? sys_khz * 1000 : 12000000; }
+
+uint32_t save_and_disable_interrupts(void) { return 0; }
+void restore_interrupts(uint32_t status) { (void)status; }
+
+// -------------------------------------- Hardware --------------------------------------
+
+void gpio_init(uint gpio) { (void)gpio; }
+void gpio_set_dir(uint gpio, bool out) { (void)gpio, (void)out; }
+void gpio_pull_up(uint gpio) { (void)gpio; }
+bool gpio_get(uint gpio) { (void)gpio; return true; }
+void gpio_put(uint gpio, bool value) { (void)gpio, (void)value; }
+void gpio_set_irq_enabled(uint gpio, uint32_t events, bool enabled) { (void)gpio, (void)events, (void)enabled; }
+
+uint pio_add_program(PIO pio, const pio_program_t *program) { (void)pio, (void)program; return 0; }
+void pio_gpio_init(PIO pio, uint pin) { (void)pio, (void)pin; }
+void pio_sm_set_clkdiv(PIO pio, uint sm, float div) { (void)pio, (void)sm, (void)div; }
+void pio_sm_put_blocking(PIO pio, uint sm, uint32_t data) { (void)pio, (void)sm, (void)data; }
+bool pio_sm_is_tx_fifo_empty(PIO pio, uint sm) { (void)pio, (void)sm; return true; }
+uint pio_get_dreq(PIO pio, uint sm, bool is_tx) { (void)pio; return sm + (is_tx ? 0 : 4); }
+
+uint uart_set_baudrate(uart_inst_t *uart, uint baudrate) { (void)uart; return baudrate; }
+
+void watchdog_enable(uint32_t delay_ms, bool pause_on_debug) { (void)delay_ms, (void)pause_on_debug; }
+void watchdog_update(void) {}
+bool watchdog_caused_reboot(void) { return false; }
+bool watchdog_enable_caused_reboot(void) { return false; }
+
+void irq_set_exclusive_handler(uint num, irq_handler_t handler) { (void)num, (void)handler; }
+void irq_set_priority(uint num, uint8_t hardware_priority) { (void)num, (void)hardware_priority; }
+void irq_set_enabled(uint num, bool enabled) { (void)num, (void)enabled; }
+void irq_set_pending(uint num) { (void)num; }
+
+// -------------------------------------- DMA --------------------------------------
+
+// A transfer finishes as soon as it starts, leaving its interrupt pending for the tool to run
+void (*host_dma_sink)(volatile void *write_addr, const volatile void *read_addr, uint count);
+static struct
+{
+    volatile void *write_addr;
+    uint32_t irq1_enabled;
+    uint32_t irq1_pending;
+} dma_regs[12];
+static uint32_t dma_claimed;
+
+int dma_claim_unused_channel(bool required)
+{
+    for (int ch = 0; ch < 12; ch++)
+    {
+        if (!(dma_claimed & 1u << ch))
+        {
+            dma_claimed |= 1u << ch;
+            return ch;
+        }
+    }
+    return required ? 0 : -1;
+}
+
+dma_channel_config dma_channel_get_default_config(uint channel)
+{
+    (void)channel;
+    dma_channel_config c = {0};
+    return c;
+}
+
+void channel_config_set_transfer_data_size(dma_channel_config *c, enum dma_channel_transfer_size size) { (void)c, (void)size; }
+void channel_config_set_read_increment(dma_channel_config *c, bool incr) { (void)c, (void)incr; }
+void channel_config_set_write_increment(dma_channel_config *c, bool incr) { (void)c, (void)incr; }
+void channel_config_set_dreq(dma_channel_config *c, uint dreq) { (void)c, (void)dreq; }
+
+void dma_channel_transfer_from_buffer_now(uint channel, const volatile void *read_addr, uint32_t transfer_count)
+{
+    if (host_dma_sink)
+        host_dma_sink(dma_regs[channel].write_addr, read_addr, transfer_count);
+    dma_regs[channel].irq1_pending = dma_regs[channel].irq1_enabled;
+}
+
+void dma_channel_configure(uint channel, const dma_channel_config *config, volatile void *write_addr,
+                           const volatile void *read_addr, uint transfer_count, bool trigger)
+{
+    (void)config;
+    dma_regs[channel].write_addr = write_addr;
+    if (trigger)
+        dma_channel_transfer_from_buffer_now(channel, read_addr, transfer_count);
+}
+
+void dma_channel_set_irq1_enabled(uint channel, bool enabled) { dma_regs[channel].irq1_enabled = enabled; }
+bool dma_channel_get_irq1_status(uint channel) { return dma_regs[channel].irq1_pending; }
+void dma_channel_acknowledge_irq1(uint channel) { dma_regs[channel].irq1_pending = 0; }
+
+// -------------------------------------- assign02.S --------------------------------------
+
+void main_asm(void) {}
+void set_alarm_at(uint32_t at) { (void)at; }
+void set_debounce_alarm_at(uint32_t at) { (void)at; }
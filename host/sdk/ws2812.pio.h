@@ -0,0 +1,26 @@
+#ifndef HOST_WS2812_PIO_H
+#define HOST_WS2812_PIO_H
+
+/**
+ * @file ws2812.pio.h
+ * @brief Host stand-in for the header pico_generate_pio_header() makes from ws2812.pio
+ */
+
+#include "hardware/pio.h"
+
+extern const pio_program_t ws2812_program;
+
+static inline void ws2812_program_init(PIO pio, uint sm, uint offset, uint pin, float freq, bool rgbw)
+{
+    (void)offset;
+    (void)rgbw;
+    pio_gpio_init(pio, pin);
+    pio_sm_set_clkdiv(pio, sm, freq);
+}
+
+static inline void ws2812_program_set_freq(PIO pio, uint sm, float freq)
+{
+    pio_sm_set_clkdiv(pio, sm, freq);
+}
+
+#endif
@@ -0,0 +1,550 @@
+#define _GNU_SOURCE
+#include <math.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+/**
+ * @file sim_game.c
+ * @brief Monte-Carlo simulation of the game: synthetic players key their answers as
+ * timed press/release events into the firmware's own deferred input work, gap timeouts
+ * and game task (assign02.c built against the SDK stand-in in sdk/), so everything from
+ * the dot/dash threshold to check_input() and the lives/remaining rules (game_session.c)
+ * is the code that runs on the board. Players are swept over levels, WPM and timing jitter, with an
+ * error model of elements keyed as the wrong symbol or left out, and the report gives
+ * win rate, rounds to win, how often the keying was misread and how hard each question
+ * was.
+ *
+ * The game's state is global, so each worker is a process with its own copy of it. The
+ * work is chunks of players; each worker takes chunks from the front of its own range
+ * and, once that is empty, steals the back half of the largest range left, so a sweep
+ * stays balanced however uneven the cells are. Results are the same for any number of
+ * workers, as every chunk seeds its own random numbers.
+ *
+ * Usage: sim_game [players per cell] [flip %] [drop %] [workers]
+ */
+
+#define main firmware_main
+#include "assign02.c"
+#undef main
+
+/**
+ * @def SIM_CHUNK
+ * Players in a unit of work
+ */
+#define SIM_CHUNK 32
+
+/**
+ * @def SIM_MAX_ROUNDS
+ * Rounds a player may take before the level is counted as unfinished
+ */
+#define SIM_MAX_ROUNDS 300
+
+/**
+ * @def SIM_MAX_WORKERS
+ * Most worker processes
+ */
+#define SIM_MAX_WORKERS 256
+
+/**
+ * @def SIM_SELECT_TRIES
+ * Attempts at keying the level select before the player gives up
+ */
+#define SIM_SELECT_TRIES 20
+
+static const int sweep_wpm[] = {5, 8, 10, 12, 15, 20, 25, 30};
+static const int sweep_jitter[] = {0, 10, 20, 30};
+static const char *const level_codes[] = {".....", ".----", "..---", "...--", "....-"};
+
+#define WPM_COUNT (int)(sizeof(sweep_wpm) / sizeof(sweep_wpm[0]))
+#define JITTER_COUNT (int)(sizeof(sweep_jitter) / sizeof(sweep_jitter[0]))
+#define LEVEL_COUNT 4
+#define CELL_COUNT (LEVEL_COUNT * WPM_COUNT * JITTER_COUNT)
+#define QUESTION_COUNT 36
+
+/** Struct defining the results of one cell of the sweep (a level, WPM and jitter) */
+typedef struct cell_result
+{
+    _Atomic uint64_t players;
+    _Atomic uint64_t not_started;    /*!< Players who never got the level select keyed */
+    _Atomic uint64_t won;
+    _Atomic uint64_t unfinished;     /*!< Players still playing at SIM_MAX_ROUNDS */
+    _Atomic uint64_t rounds;         /*!< Answers given */
+    _Atomic uint64_t elements;       /*!< Elements keyed */
+    _Atomic uint64_t element_errors; /*!< Elements classified as the other symbol, or lost or added */
+    _Atomic uint64_t misread;        /*!< Answers the game read differently from how they were keyed */
+    _Atomic uint64_t keyed_wrong;    /*!< Answers the player keyed wrongly */
+    _Atomic uint32_t rounds_to_win[SIM_MAX_ROUNDS + 1];
+} cell_result;
+
+/** Struct defining how each question fared, per level */
+typedef struct question_result
+{
+    _Atomic uint64_t asked;
+    _Atomic uint64_t correct;
+} question_result;
+
+/** Struct defining a worker's range of chunks, lo in the low half and hi in the high half */
+typedef struct worker_state
+{
+    _Atomic uint64_t range;
+    _Atomic uint64_t chunks;   /*!< Chunks run */
+    _Atomic uint64_t steals;   /*!< Successful steals */
+    _Atomic uint64_t busy_ns;  /*!< Time spent running chunks */
+} worker_state;
+
+/** Struct defining everything shared between the workers */
+typedef struct shared_state
+{
+    cell_result cells[CELL_COUNT];
+    question_result questions[LEVEL_COUNT][QUESTION_COUNT];
+    worker_state workers[SIM_MAX_WORKERS];
+    int worker_count;
+} shared_state;
+
+/** Struct defining a simulated player */
+typedef struct sim_player
+{
+    uint64_t rng;   /*!< xorshift64 state */
+    double unit_us; /*!< Dot length */
+    double jitter;  /*!< Standard deviation of every duration, relative to it */
+    double flip;    /*!< Probability of keying an element as the other symbol */
+    double drop;    /*!< Probability of leaving an element out */
+} sim_player;
+
+static shared_state *shared;
+static int players_per_cell = 2000;
+static double flip_pct = 2, drop_pct = 1;
+static uint32_t sim_now; /*!< The simulated timer */
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static uint64_t next_random(sim_player *s)
+{
+    s->rng ^= s->rng << 13;
+    s->rng ^= s->rng >> 7;
+    s->rng ^= s->rng << 17;
+    return s->rng;
+}
+
+static double uniform(sim_player *s)
+{
+    return (next_random(s) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * @brief A duration of the given number of units, with Gaussian jitter
+ */
+static uint32_t jittered(sim_player *s, int units)
+{
+    double u1 = uniform(s) + 1e-12, u2 = uniform(s);
+    double g = sqrt(-2 * log(u1)) * cos(2 * M_PI * u2);
+    double d = s->unit_us * units * (1 + s->jitter * g);
+    double min = s->unit_us * units * 0.1;
+    return (uint32_t)(d < min ? min : d);
+}
+
+/**
+ * @brief Keys a code (letters separated by spaces) into the game through the deferred
+ *        input work, applying the error model, and waits for the gap timeouts to
+ *        complete the input
+ *
+ * @param keyed  Filled with the code as the player actually keyed it
+ * @param errors 1 - Apply the error model
+ */
+static void key_code(sim_player *s, const char *code, char *keyed, int errors)
+{
+    game_session *g = &players.session[0];
+    int n = 0;
+    int gap_units = 0;
+    uint32_t at;
+    for (const char *c = code; *c; c++)
+    {
+        if (*c == ' ')
+        {
+            if (n > 0 && keyed[n - 1] != ' ')
+                keyed[n++] = ' ';
+            gap_units = 3;
+            continue;
+        }
+        char symbol = *c;
+        if (errors && uniform(s) < s->drop)
+            continue;
+        if (errors && uniform(s) < s->flip)
+            symbol = symbol == '.' ? '-' : '.';
+
+        sim_now += gap_units ? jittered(s, gap_units) : 1000000;
+        process_timeout(0, sim_now);
+        if (g->complete)
+            break;
+        process_input_event(0, &(input_event){sim_now, EVENT_PRESS});
+        sim_now += jittered(s, symbol == '-' ? 3 : 1);
+        process_input_event(0, &(input_event){sim_now, EVENT_RELEASE});
+        keyed[n++] = symbol;
+        gap_units = 1;
+    }
+    if (n > 0 && keyed[n - 1] == ' ')
+        n--;
+    keyed[n] = '\0';
+
+    // The word gap timeout completes the input
+    while (!g->complete && session_deadline(g, &at))
+    {
+        sim_now = at;
+        process_timeout(0, sim_now);
+    }
+}
+
+/**
+ * @brief Counts the elements of the keyed code the game got wrong, ignoring the spacing
+ */
+static int element_errors(const char *keyed, const char *read)
+{
+    char a[SESSION_INPUT_SIZE], b[SESSION_INPUT_SIZE];
+    int la = 0, lb = 0;
+    for (; *keyed; keyed++)
+        if (*keyed != ' ')
+            a[la++] = *keyed;
+    for (; *read; read++)
+        if (*read != ' ')
+            b[lb++] = *read;
+
+    int errors = abs(la - lb);
+    for (int i = 0; i < la && i < lb; i++)
+        errors += a[i] != b[i];
+    return errors;
+}
+
+/** Struct defining the results of a chunk, added to the shared results once it is done */
+typedef struct chunk_result
+{
+    uint64_t not_started, won, unfinished, rounds, elements, element_errors, misread, keyed_wrong;
+    uint32_t rounds_to_win[SIM_MAX_ROUNDS + 1];
+    uint64_t asked[QUESTION_COUNT], correct[QUESTION_COUNT];
+} chunk_result;
+
+/**
+ * @brief Plays one level with a simulated player, from the level select to the end
+ */
+static void play_level(sim_player *s, int level, chunk_result *r)
+{
+    game_session *g = &players.session[0];
+    char keyed[SESSION_INPUT_SIZE], read[SESSION_INPUT_SIZE];
+
+    active_player = 0;
+    g->unit_us = 0;
+    game_enter(GAME_SELECT);
+
+    // A misread level select (even one that starts another level) is keyed again
+    for (int tries = 0; players.state[0] != GAME_QUESTION || g->level != level; tries++)
+    {
+        if (tries == SIM_SELECT_TRIES)
+        {
+            r->not_started++;
+            return;
+        }
+        if (players.state[0] != GAME_SELECT)
+        {
+            players_left = NUM_PLAYERS;
+            quit = 0;
+            game_enter(GAME_SELECT);
+        }
+        key_code(s, level_codes[level], keyed, 0);
+        game_task((void *)(intptr_t)0, GAME_EVENT_INPUT);
+    }
+
+    int rounds = 0;
+    for (int attempts = 0; players.state[0] == GAME_QUESTION && rounds < SIM_MAX_ROUNDS; attempts++)
+    {
+        int q = g->target;
+        const char *code = session_current(g)->code;
+        key_code(s, code, keyed, 1);
+
+        // Every element left out, the player keys it again
+        if (!g->complete)
+        {
+            if (attempts > 2 * SIM_MAX_ROUNDS)
+                break;
+            continue;
+        }
+
+        strcpy(read, g->input);
+        int errors = element_errors(keyed, read);
+        r->elements += strlen(keyed);
+        r->element_errors += errors;
+        r->misread += strcmp(keyed, read) != 0;
+        r->keyed_wrong += strcmp(keyed, code) != 0;
+
+        game_task((void *)(intptr_t)0, GAME_EVENT_INPUT);
+        r->asked[q]++;
+        r->correct[q] += g->correct;
+        rounds++;
+    }
+    r->rounds += rounds;
+
+    if (players.state[0] == GAME_QUESTION)
+        r->unfinished++;
+    else if (g->remaining == 0)
+    {
+        r->won++;
+        r->rounds_to_win[rounds]++;
+    }
+}
+
+/**
+ * @brief Runs a chunk of players in one cell and adds its results to the shared ones
+ */
+static void run_chunk(uint32_t chunk)
+{
+    int chunks_per_cell = (players_per_cell + SIM_CHUNK - 1) / SIM_CHUNK;
+    int cell = chunk / chunks_per_cell;
+    int first = (chunk % chunks_per_cell) * SIM_CHUNK;
+    int count = players_per_cell - first < SIM_CHUNK ? players_per_cell - first : SIM_CHUNK;
+
+    int level = 1 + cell / (WPM_COUNT * JITTER_COUNT);
+    int wpm = sweep_wpm[cell / JITTER_COUNT % WPM_COUNT];
+    int jitter = sweep_jitter[cell % JITTER_COUNT];
+
+    // Everything random in the chunk follows from its number
+    sim_player s = {0x9e3779b97f4a7c15ull * (chunk + 1), 1.2e6 / wpm, jitter / 100.0, flip_pct / 100,
+                    drop_pct / 100};
+    sim_now = chunk * 7919u;
+    session_init(&players.session[0], chunk * 100003u + 1);
+
+    static chunk_result r;
+    memset(&r, 0, sizeof(r));
+    for (int i = 0; i < count; i++)
+        play_level(&s, level, &r);
+
+    cell_result *c = &shared->cells[cell];
+    c->players += count;
+    c->not_started += r.not_started;
+    c->won += r.won;
+    c->unfinished += r.unfinished;
+    c->rounds += r.rounds;
+    c->elements += r.elements;
+    c->element_errors += r.element_errors;
+    c->misread += r.misread;
+    c->keyed_wrong += r.keyed_wrong;
+    for (int i = 0; i <= SIM_MAX_ROUNDS; i++)
+        if (r.rounds_to_win[i])
+            c->rounds_to_win[i] += r.rounds_to_win[i];
+    for (int q = 0; q < QUESTION_COUNT; q++)
+    {
+        shared->questions[level - 1][q].asked += r.asked[q];
+        shared->questions[level - 1][q].correct += r.correct[q];
+    }
+}
+
+#define RANGE(lo, hi) ((uint64_t)(hi) << 32 | (uint32_t)(lo))
+#define RANGE_LO(r) ((uint32_t)(r))
+#define RANGE_HI(r) ((uint32_t)((r) >> 32))
+
+/**
+ * @brief Takes the next chunk from the front of a worker's own range
+ *
+ * @return int 1 if a chunk was taken, 0 if the range is empty
+ */
+static int take_own(worker_state *w, uint32_t *chunk)
+{
+    uint64_t r = atomic_load(&w->range);
+    while (RANGE_LO(r) < RANGE_HI(r))
+    {
+        if (atomic_compare_exchange_weak(&w->range, &r, RANGE(RANGE_LO(r) + 1, RANGE_HI(r))))
+        {
+            *chunk = RANGE_LO(r);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Steals the back half of the largest range left into a worker's own range
+ *
+ * @return int 1 if anything was stolen, 0 if every range is empty
+ */
+static int steal(int self)
+{
+    while (1)
+    {
+        int victim = -1;
+        uint32_t most = 0;
+        for (int i = 0; i < shared->worker_count; i++)
+        {
+            uint64_t r = atomic_load(&shared->workers[i].range);
+            if (i != self && RANGE_HI(r) - RANGE_LO(r) > most && RANGE_LO(r) < RANGE_HI(r))
+            {
+                most = RANGE_HI(r) - RANGE_LO(r);
+                victim = i;
+            }
+        }
+        if (victim < 0)
+            return 0;
+
+        worker_state *v = &shared->workers[victim];
+        uint64_t r = atomic_load(&v->range);
+        uint32_t lo = RANGE_LO(r), hi = RANGE_HI(r);
+        if (lo >= hi)
+            continue;
+        uint32_t split = hi - (hi - lo + 1) / 2;
+        if (atomic_compare_exchange_strong(&v->range, &r, RANGE(lo, split)))
+        {
+            atomic_store(&shared->workers[self].range, RANGE(split, hi));
+            shared->workers[self].steals++;
+            return 1;
+        }
+    }
+}
+
+/**
+ * @brief Worker process, runs chunks until there are none left anywhere
+ */
+static void worker(int self)
+{
+    hmm_init();
+    match_init();
+    transcription_init();
+    stations_init();
+    clock_init();
+    scheduler_init(1);
+    deferred_hold = 0;
+    initial_round = 0;
+
+    worker_state *w = &shared->workers[self];
+    uint32_t chunk;
+    while (take_own(w, &chunk) || (steal(self) && take_own(w, &chunk)))
+    {
+        double t0 = now_ns();
+        run_chunk(chunk);
+        w->busy_ns += (uint64_t)(now_ns() - t0);
+        w->chunks++;
+    }
+}
+
+/**
+ * @brief Rounds to win at a percentile of the winners
+ */
+static int rounds_percentile(const cell_result *c, int pct)
+{
+    uint64_t target = (c->won * pct + 99) / 100, seen = 0;
+    for (int i = 0; i <= SIM_MAX_ROUNDS; i++)
+    {
+        seen += c->rounds_to_win[i];
+        if (seen >= target && seen > 0)
+            return i;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1)
+        players_per_cell = atoi(argv[1]);
+    if (argc > 2)
+        flip_pct = atof(argv[2]);
+    if (argc > 3)
+        drop_pct = atof(argv[3]);
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = argc > 4 ? atoi(argv[4]) : (int)cpus;
+    if (players_per_cell < 1)
+        players_per_cell = 2000;
+    if (workers < 1 || workers > SIM_MAX_WORKERS)
+        workers = 1;
+
+    shared = mmap(NULL, sizeof(shared_state), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (shared == MAP_FAILED)
+    {
+        perror("mmap");
+        return 2;
+    }
+    shared->worker_count = workers;
+
+    // Every worker starts with an equal slice of the chunks
+    uint32_t chunks = CELL_COUNT * ((players_per_cell + SIM_CHUNK - 1) / SIM_CHUNK);
+    for (int i = 0; i < workers; i++)
+        shared->workers[i].range = RANGE((uint64_t)chunks * i / workers, (uint64_t)chunks * (i + 1) / workers);
+
+    // The report keeps the real stdout, the game's output is thrown away
+    fflush(stdout);
+    FILE *out = fdopen(dup(fileno(stdout)), "w");
+    if (!out || !freopen("/dev/null", "w", stdout))
+        return 2;
+    static char sink[1 << 16];
+    setvbuf(stdout, sink, _IOFBF, sizeof(sink));
+
+    double t0 = now_ns();
+    for (int i = 0; i < workers; i++)
+    {
+        if (fork() == 0)
+        {
+            worker(i);
+            _exit(0);
+        }
+    }
+    while (wait(NULL) > 0)
+        ;
+    double seconds = (now_ns() - t0) / 1e9;
+
+    fprintf(out, "%d players per cell, %.1f%% of elements keyed as the other symbol, %.1f%% left out\n",
+            players_per_cell, flip_pct, drop_pct);
+    uint64_t total_players = 0, total_rounds = 0;
+    for (int level = 1; level <= LEVEL_COUNT; level++)
+    {
+        fprintf(out, "\nLevel %d\n%4s %7s %8s %8s %8s %6s %6s %9s %9s %9s\n", level, "WPM", "jitter", "no start",
+                "win", "unfin", "p50", "p90", "elem err", "misread", "own err");
+        for (int i = 0; i < WPM_COUNT * JITTER_COUNT; i++)
+        {
+            const cell_result *c = &shared->cells[(level - 1) * WPM_COUNT * JITTER_COUNT + i];
+            double n = c->players ? (double)c->players : 1, answers = c->rounds ? (double)c->rounds : 1;
+            fprintf(out, "%4d %6d%% %7.1f%% %7.1f%% %7.1f%% %6d %6d %8.2f%% %8.2f%% %8.2f%%\n",
+                    sweep_wpm[i / JITTER_COUNT], sweep_jitter[i % JITTER_COUNT], 100 * c->not_started / n,
+                    100 * c->won / n, 100 * c->unfinished / n, rounds_percentile(c, 50), rounds_percentile(c, 90),
+                    100.0 * c->element_errors / (c->elements ? c->elements : 1), 100 * c->misread / answers,
+                    100 * c->keyed_wrong / answers);
+            total_players += c->players;
+            total_rounds += c->rounds;
+        }
+    }
+
+    fprintf(out, "\nCorrect answers per question, over every WPM and jitter\n");
+    for (int level = 1; level <= LEVEL_COUNT; level++)
+    {
+        fprintf(out, "Level %d:", level);
+        int count = level <= 2 ? SESSION_LETTERS : SESSION_WORDS;
+        for (int q = 0; q < count; q++)
+        {
+            const question_result *r = &shared->questions[level - 1][q];
+            if (q % 6 == 0)
+                fprintf(out, "\n ");
+            fprintf(out, " %8s %5.1f%%", level <= 2 ? session_letters[q].text : session_words[q].text,
+                    r->asked ? 100.0 * r->correct / r->asked : 0);
+        }
+        fprintf(out, "\n");
+    }
+
+    double busy = 0;
+    uint64_t steals = 0;
+    for (int i = 0; i < workers; i++)
+    {
+        busy += shared->workers[i].busy_ns / 1e9;
+        steals += shared->workers[i].steals;
+    }
+    fprintf(out, "\n%llu players, %llu answers in %.2f s with %d worker(s) on %ld CPU(s): %.0f players/s, %.0f answers/s\n",
+            (unsigned long long)total_players, (unsigned long long)total_rounds, seconds, workers, cpus,
+            total_players / seconds, total_rounds / seconds);
+    fprintf(out, "%llu steals, workers busy %.0f%% of the time\n", (unsigned long long)steals,
+            100 * busy / (seconds * workers));
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,170 @@
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include "telemetry.h"
+
+/**
+ * @file telemetry_decode.c
+ * @brief Splits the firmware's console stream into its text and its binary telemetry
+ * records (telemetry.h), using the firmware's own decoder. It reads a serial device (or
+ * pty), a captured file or stdin, prints each record as a line of named fields as it
+ * arrives and, at the end of a file, a summary of the records and bytes seen. With
+ * --generate it writes a capture of random records mixed with console text, with a few
+ * bytes corrupted, to exercise the decoder without a board.
+ *
+ * Usage: telemetry_decode [--text] [device | capture file]
+ *        telemetry_decode --generate <capture file> [records]
+ */
+
+/** Field names of each record type, indexed by telemetry_type */
+static const char *const field_names[TELEMETRY_TYPE_COUNT][TELEMETRY_MAX_FIELDS] = {
+    [TELEMETRY_ROUND] = {"level", "question", "correct", "lives", "remaining", "answer_us"},
+    [TELEMETRY_SYMBOL] = {"press_us", "symbol"},
+    [TELEMETRY_LIVES] = {"lives"},
+    [TELEMETRY_LEVEL] = {"level", "state"},
+    [TELEMETRY_LATENCY] = {"verdict_us", "edge_worst_us", "edges_dropped"},
+    [TELEMETRY_LOST] = {"records"},
+};
+
+/**
+ * @brief Puts a terminal into raw mode
+ */
+static void set_raw(int fd)
+{
+    struct termios t;
+    if (tcgetattr(fd, &t) == 0)
+    {
+        cfmakeraw(&t);
+        tcsetattr(fd, TCSANOW, &t);
+    }
+}
+
+/**
+ * @brief Prints a record as a line of named fields
+ */
+static void print_record(const telemetry_record *r, int synced)
+{
+    if (synced)
+        printf("%10lu", (unsigned long)r->time_us);
+    else
+        printf("%10s", "?");
+    printf(" P%d %-8s", r->player, telemetry_type_name(r->type));
+    for (int i = 0; i < r->count; i++)
+    {
+        const char *name = r->type < TELEMETRY_TYPE_COUNT ? field_names[r->type][i] : NULL;
+        printf(" %s=%lu", name ? name : "?", (unsigned long)r->field[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+}
+
+/**
+ * @brief Writes a capture of random records between lines of console text, with a byte
+ *        of about one frame in 200 corrupted
+ */
+static int generate(const char *path, int records)
+{
+    FILE *f = fopen(path, "wb");
+    if (!f)
+    {
+        perror(path);
+        return 2;
+    }
+
+    static telemetry_queue q;
+    telemetry_init(&q);
+    srand(1);
+    uint32_t now = 1000000;
+    long frame_bytes = 0, corrupted = 0;
+    for (int i = 0; i < records; i++)
+    {
+        if (rand() % 4 == 0)
+            fprintf(f, "Console line %d, Lives: %d\n", i, rand() % 4);
+
+        now += rand() % 400000;
+        telemetry_record r = {now, 1 + rand() % (TELEMETRY_LOST - 1), rand() % 2, 0, {0}};
+        const char *const *names = field_names[r.type];
+        for (; r.count < TELEMETRY_MAX_FIELDS && names[r.count]; r.count++)
+            r.field[r.count] = rand() % (r.count == 0 ? 400000 : 8);
+        telemetry_push(&q, &r);
+
+        uint8_t frame[TELEMETRY_MAX_FRAME];
+        int len = telemetry_next(&q, frame);
+        frame_bytes += len;
+        if (rand() % 200 == 0)
+        {
+            frame[1 + rand() % (len - 2)] ^= 0x5a;
+            corrupted++;
+        }
+        fwrite(frame, 1, len, f);
+    }
+    fclose(f);
+    printf("%d records, %ld corrupted, %.1f bytes per record\n", records, corrupted, (double)frame_bytes / records);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    int arg = 1, text = 0;
+    if (argc > 2 && strcmp(argv[1], "--generate") == 0)
+        return generate(argv[2], argc > 3 ? atoi(argv[3]) : 10000);
+    if (argc > arg && strcmp(argv[arg], "--text") == 0)
+    {
+        text = 1;
+        arg++;
+    }
+
+    int fd = 0;
+    if (argc > arg)
+    {
+        fd = open(argv[arg], O_RDONLY | O_NOCTTY);
+        if (fd < 0)
+        {
+            perror(argv[arg]);
+            return 2;
+        }
+    }
+    if (isatty(fd))
+        set_raw(fd);
+
+    telemetry_decoder d;
+    telemetry_decoder_init(&d);
+    telemetry_record r;
+    unsigned long types[TELEMETRY_TYPE_COUNT] = {0}, text_bytes = 0, total = 0;
+    uint8_t buf[4096];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0)
+    {
+        total += n;
+        for (ssize_t i = 0; i < n; i++)
+        {
+            switch (telemetry_feed(&d, buf[i], &r))
+            {
+            case TELEMETRY_TEXT:
+                text_bytes++;
+                if (text)
+                    putchar(buf[i]);
+                break;
+            case TELEMETRY_RECORD:
+                types[r.type < TELEMETRY_TYPE_COUNT ? r.type : 0]++;
+                print_record(&r, d.synced);
+                break;
+            default:
+                break;
+            }
+        }
+    }
+
+    printf("\n%lu records, %lu bad frames, %lu bytes (%lu of console text)\n", (unsigned long)d.records,
+           (unsigned long)d.bad, total, text_bytes);
+    for (int t = 1; t < TELEMETRY_TYPE_COUNT; t++)
+        printf("  %-8s %lu\n", telemetry_type_name(t), types[t]);
+    if (d.records)
+        printf("%.1f bytes per record\n", (double)(total - text_bytes) / d.records);
+    return 0;
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "inject.h"
+
+/**
+ * @file inject.c
+ * @brief Edges are queued with absolute due times, so a script sent faster than real time
+ * still plays out with the spacing it asked for. An empty queue restarts the schedule from
+ * the time the command arrived.
+ */
+
+void inject_init(inject_state *s, int players)
+{
+    memset(s, 0, sizeof(*s));
+    s->max_player = players - 1;
+}
+
+/**
+ * @brief Queues an edge delay microseconds after the previous one
+ *
+ * @return int 1 on success, 0 if the queue is full
+ */
+static int queue_edge(inject_state *s, int player, int release, uint32_t delay_us)
+{
+    if (s->head - s->tail == INJECT_QUEUE_SIZE)
+        return 0;
+
+    s->schedule_us += delay_us;
+    inject_edge *e = &s->queue[s->head % INJECT_QUEUE_SIZE];
+    e->due_us = s->schedule_us;
+    e->player = player;
+    e->release = release;
+    s->head++;
+    return 1;
+}
+
+/**
+ * @brief Queues the edges of a code keyed at the given unit, starting one unit from now
+ *
+ * @return int 1 on success, 0 if the queue is full or the code is invalid
+ */
+static int queue_code(inject_state *s, int player, uint32_t unit_us, const char *code)
+{
+    uint32_t gap = unit_us;
+    for (; *code; code++)
+    {
+        if (*code == ' ')
+        {
+            // A letter space is 3 units, one of which is already counted
+            gap += 2 * unit_us;
+            continue;
+        }
+        if (*code != '.' && *code != '-')
+            return 0;
+        if (!queue_edge(s, player, 0, gap) ||
+            !queue_edge(s, player, 1, *code == '-' ? 3 * unit_us : unit_us))
+            return 0;
+        gap = unit_us;
+    }
+    return 1;
+}
+
+/**
+ * @brief Runs one complete command line
+ *
+ * @return const char* NULL on success, otherwise the reason it failed
+ */
+static const char *run_line(inject_state *s, char *line, uint32_t now_us)
+{
+    // An idle queue schedules from now, otherwise from the last queued edge
+    if (s->head == s->tail && (int32_t)(now_us - s->schedule_us) > 0)
+        s->schedule_us = now_us;
+
+    char *cmd = strtok(line, " ");
+    if (cmd == NULL)
+        return "empty";
+
+    char *args[3];
+    int n = 0;
+    while (n < 3 && (args[n] = strtok(NULL, n == 2 ? "" : " ")) != NULL)
+        n++;
+
+    switch (cmd[0])
+    {
+    case 'P':
+    case 'R':
+    {
+        if (n != 2)
+            return "usage";
+        int player = atoi(args[0]);
+        if (player < 0 || player > s->max_player)
+            return "player";
+        if (!queue_edge(s, player, cmd[0] == 'R', strtoul(args[1], NULL, 10)))
+            return "full";
+        return NULL;
+    }
+    case 'W':
+        if (n != 1)
+            return "usage";
+        s->schedule_us += strtoul(args[0], NULL, 10);
+        return NULL;
+    case 'K':
+    {
+        if (n != 3)
+            return "usage";
+        int player = atoi(args[0]);
+        uint32_t unit = strtoul(args[1], NULL, 10);
+        if (player < 0 || player > s->max_player)
+            return "player";
+        if (unit == 0)
+            return "unit";
+
+        // Roll back a code that only partly fits
+        uint32_t head = s->head, schedule = s->schedule_us;
+        if (!queue_code(s, player, unit, args[2]))
+        {
+            s->head = head;
+            s->schedule_us = schedule;
+            return "code";
+        }
+        return NULL;
+    }
+    case 'X':
+        s->tail = s->head;
+        s->schedule_us = now_us;
+        return NULL;
+    default:
+        return "command";
+    }
+}
+
+int inject_feed(inject_state *s, char c, uint32_t now_us, char *reply, int reply_size)
+{
+    if (c == '\r')
+        return 0;
+    if (c != '\n')
+    {
+        if (s->line_len < INJECT_MAX_LINE - 1)
+            s->line[s->line_len++] = c;
+        else
+            s->overlong = 1;
+        return 0;
+    }
+
+    s->line[s->line_len] = '\0';
+    const char *error = s->overlong ? "length" : run_line(s, s->line, now_us);
+    s->line_len = 0;
+    s->overlong = 0;
+
+    if (error)
+        snprintf(reply, reply_size, "@ERR %s", error);
+    else
+    {
+        s->lines++;
+        snprintf(reply, reply_size, "@OK %lu", (unsigned long)(s->head - s->tail));
+    }
+    return 1;
+}
+
+int inject_due(inject_state *s, uint32_t now_us, inject_edge *edge)
+{
+    if (s->head == s->tail)
+        return 0;
+
+    const inject_edge *e = &s->queue[s->tail % INJECT_QUEUE_SIZE];
+    if ((int32_t)(now_us - e->due_us) < 0)
+        return 0;
+
+    *edge = *e;
+    s->tail++;
+    return 1;
+}
+
+int inject_next(const inject_state *s, uint32_t *due_us)
+{
+    if (s->head == s->tail)
+        return 0;
+    *due_us = s->queue[s->tail % INJECT_QUEUE_SIZE].due_us;
+    return 1;
+}
+
+int inject_format_key(char *out, int size, int player, uint32_t unit_us, const char *code)
+{
+    return snprintf(out, size, "K %d %lu %s\n", player, (unsigned long)unit_us, code);
+}
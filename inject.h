@@ -0,0 +1,99 @@
+#ifndef INJECT_H
+#define INJECT_H
+
+#include <stdint.h>
+
+/**
+ * @file inject.h
+ * @brief Line protocol for injecting key presses over a serial link, so whole games can be
+ * scripted. Each line schedules edges relative to the previous one, and the parser turns
+ * them into a queue of timestamped press/release edges for the device to feed in when
+ * they fall due. It has no hardware dependencies so the host tools share it.
+ *
+ * Commands (times in microseconds, one reply line each):
+ *   P <player> <delay>          Press after delay
+ *   R <player> <delay>          Release after delay
+ *   W <delay>                   Wait
+ *   K <player> <unit> <code>    Key a code of '.', '-' and ' ' (letter space) at the given unit
+ *   X                           Drop the edges that haven't been fed in yet
+ * Replies:
+ *   @OK <edges queued>
+ *   @ERR <reason>
+ */
+
+/**
+ * @def INJECT_MAX_LINE
+ * Longest command line
+ */
+#define INJECT_MAX_LINE 128
+
+/**
+ * @def INJECT_QUEUE_SIZE
+ * Edges that can be waiting to be fed in (power of 2), enough for a long word
+ */
+#define INJECT_QUEUE_SIZE 256
+
+/** Struct defining one scheduled edge */
+typedef struct inject_edge
+{
+    uint32_t due_us; /*!< Time the edge happens */
+    uint8_t player;
+    uint8_t release; /*!< 0 - Press, 1 - Release */
+} inject_edge;
+
+/** Struct defining the parser and its queue of edges */
+typedef struct inject_state
+{
+    char line[INJECT_MAX_LINE];
+    int line_len;
+    int overlong;                        /*!< 1 - The current line is too long and will be rejected */
+    inject_edge queue[INJECT_QUEUE_SIZE];
+    uint32_t head;                       /*!< Total edges queued */
+    uint32_t tail;                       /*!< Total edges fed in */
+    uint32_t schedule_us;                /*!< Time the last queued edge (or wait) is due */
+    int max_player;                      /*!< Largest player number accepted */
+    uint32_t lines;                      /*!< Commands accepted */
+} inject_state;
+
+/**
+ * @brief Sets up a parser
+ *
+ * @param players Number of players commands may address
+ */
+void inject_init(inject_state *s, int players);
+
+/**
+ * @brief Feeds one received character to the parser
+ *
+ * @param c          The character
+ * @param now_us     The current time, edges are scheduled from here when the queue is empty
+ * @param reply      Filled with the reply when a line is complete
+ * @param reply_size Size of reply
+ * @return int 1 if a reply is ready, 0 otherwise
+ */
+int inject_feed(inject_state *s, char c, uint32_t now_us, char *reply, int reply_size);
+
+/**
+ * @brief Gets the next edge if it has fallen due
+ *
+ * @param now_us The current time
+ * @param edge   Set to the edge
+ * @return int 1 if an edge is due, 0 otherwise
+ */
+int inject_due(inject_state *s, uint32_t now_us, inject_edge *edge);
+
+/**
+ * @brief Gets the time the next edge falls due
+ *
+ * @return int 1 if an edge is queued, 0 otherwise
+ */
+int inject_next(const inject_state *s, uint32_t *due_us);
+
+/**
+ * @brief Formats the K command that keys a code
+ *
+ * @return int The length of the command
+ */
+int inject_format_key(char *out, int size, int player, uint32_t unit_us, const char *code);
+
+#endif
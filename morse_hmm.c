@@ -0,0 +1,285 @@
+#include <string.h>
+
+#include "morse_hmm.h"
+
+/**
+ * @file morse_hmm.c
+ * @brief Viterbi decoder over the Morse code tree. Each state is a node of the tree
+ * (root = 1, dot child = 2n, dash child = 2n + 1), i.e. the letter keyed so far. Marks
+ * move down the tree, element gaps stay on the node and letter/word gaps emit the
+ * node's letter and return to the root. Durations are scored on a log scale against
+ * the ideal 1/3/7 unit lengths, so all the maths is integer and cheap on the M0+.
+ */
+
+/**
+ * @def HMM_INF
+ * Cost of a state that can't be reached
+ */
+#define HMM_INF INT32_MAX
+
+/**
+ * @def HMM_LOG2_3
+ * log2(3) in Q8, the log length of a dash or letter gap in units
+ */
+#define HMM_LOG2_3 406
+
+/**
+ * @def HMM_LOG2_7
+ * log2(7) in Q8, the log length of a word gap in units
+ */
+#define HMM_LOG2_7 719
+
+/**
+ * @def HMM_SIGMA_DIV
+ * Scales the squared log2 error into a cost, 2 * sigma^2 / 256 for a sigma of
+ * half an octave (0.5 * 256 = 128 in Q8)
+ */
+#define HMM_SIGMA_DIV 128
+
+/**
+ * @def HMM_ERROR_CLAMP
+ * Largest log2 error scored (16 units either way), keeps the costs in range
+ */
+#define HMM_ERROR_CLAMP (4 << 8)
+
+/**
+ * @def HMM_WORD_PENALTY
+ * Extra cost of a word gap over a letter gap, words are rarer than letters
+ */
+#define HMM_WORD_PENALTY 512
+
+/**
+ * @def HMM_UNIT_RATE
+ * Each mark moves the unit estimate 1/HMM_UNIT_RATE of the way to its own length
+ */
+#define HMM_UNIT_RATE 4
+
+/**
+ * @def HMM_BEAM
+ * Paths this much worse than the best are dropped
+ */
+#define HMM_BEAM (24 << 8)
+
+/**
+ * @brief Approximates log2(x) in Q8 using the position of the top bit and
+ *        linear interpolation of the bits below it
+ */
+static int32_t log2_q8(uint32_t x)
+{
+    if (x == 0)
+        return 0;
+
+    int msb = 31;
+    while (!(x & (1u << msb)))
+        msb--;
+
+    uint32_t frac = msb >= 8 ? (x >> (msb - 8)) : (x << (8 - msb));
+    return (msb << 8) | (frac & 0xFF);
+}
+
+/**
+ * @brief Cost of observing log duration r (in units, Q8) for an element of the given mean
+ */
+static int32_t duration_cost(int32_t r, int32_t mean)
+{
+    int32_t e = r - mean;
+    if (e > HMM_ERROR_CLAMP)
+        e = HMM_ERROR_CLAMP;
+    else if (e < -HMM_ERROR_CLAMP)
+        e = -HMM_ERROR_CLAMP;
+    return e * e / HMM_SIGMA_DIV;
+}
+
+/**
+ * @brief Approximates 65536 * e^-cost for a cost in nats * 256
+ */
+static uint32_t likelihood_q16(int32_t cost)
+{
+    // e^-x = 2^-(x / ln 2), 1 / ln 2 = 369 / 256
+    uint32_t y = (uint32_t)cost * 369 >> 8;
+    uint32_t k = y >> 8;
+    if (k >= 16)
+        return 0;
+
+    // 2^-f ~= 1 - f / 2 over one octave
+    uint32_t whole = 65536u >> k;
+    return whole - (whole * (y & 0xFF) >> 9);
+}
+
+/**
+ * @brief Moves a path into a state if it is cheaper than the one already there
+ */
+static void extend(hmm_path *to, const hmm_path *from, int32_t cost, char letter, char separator)
+{
+    if (cost >= to->cost)
+        return;
+
+    to->cost = cost;
+    to->len = from->len;
+    memcpy(to->text, from->text, from->len);
+
+    // Letters past the end of the buffer are scored but not kept
+    if (letter && to->len < HMM_MAX_TEXT - 1)
+        to->text[to->len++] = letter;
+    if (separator && to->len < HMM_MAX_TEXT - 1)
+        to->text[to->len++] = separator;
+}
+
+/**
+ * @brief Makes the next paths current, renormalising the costs and pruning the beam
+ */
+static void advance(morse_hmm *hmm)
+{
+    hmm->current ^= 1;
+    hmm_path *paths = hmm->paths[hmm->current];
+
+    int32_t best = HMM_INF;
+    for (int n = 1; n < HMM_NODES; n++)
+    {
+        if (paths[n].cost < best)
+            best = paths[n].cost;
+    }
+    if (best == HMM_INF)
+        return;
+
+    for (int n = 1; n < HMM_NODES; n++)
+    {
+        if (paths[n].cost == HMM_INF)
+            continue;
+        paths[n].cost -= best;
+        if (paths[n].cost > HMM_BEAM)
+            paths[n].cost = HMM_INF;
+    }
+}
+
+/**
+ * @brief Clears the next paths, ready to be extended
+ */
+static hmm_path *begin_step(morse_hmm *hmm)
+{
+    hmm_path *next = hmm->paths[hmm->current ^ 1];
+    for (int n = 0; n < HMM_NODES; n++)
+        next[n].cost = HMM_INF;
+    return next;
+}
+
+void morse_hmm_init(morse_hmm *hmm)
+{
+    memset(hmm, 0, sizeof(*hmm));
+    morse_hmm_reset(hmm, 1);
+}
+
+void morse_hmm_add_code(morse_hmm *hmm, char letter, const char *code)
+{
+    unsigned n = 1;
+    for (; *code; code++)
+    {
+        n = 2 * n + (*code == '-');
+        if (n >= HMM_NODES)
+            return;
+    }
+    hmm->node_letter[n] = letter;
+}
+
+void morse_hmm_reset(morse_hmm *hmm, uint32_t unit_us)
+{
+    hmm->log_unit = log2_q8(unit_us);
+    hmm->current = 0;
+
+    hmm_path *paths = hmm->paths[0];
+    for (int n = 0; n < HMM_NODES; n++)
+        paths[n].cost = HMM_INF;
+    paths[1].cost = 0;
+    paths[1].len = 0;
+}
+
+void morse_hmm_mark(morse_hmm *hmm, uint32_t duration_us)
+{
+    const hmm_path *paths = hmm->paths[hmm->current];
+    hmm_path *next = begin_step(hmm);
+
+    int32_t r = log2_q8(duration_us) - hmm->log_unit;
+    int32_t dot = duration_cost(r, 0);
+    int32_t dash = duration_cost(r, HMM_LOG2_3);
+
+    // Nodes below 32 are less than 5 elements deep and can take another
+    for (int n = 1; n < HMM_NODES / 2; n++)
+    {
+        if (paths[n].cost == HMM_INF)
+            continue;
+        extend(&next[2 * n], &paths[n], paths[n].cost + dot, 0, 0);
+        extend(&next[2 * n + 1], &paths[n], paths[n].cost + dash, 0, 0);
+    }
+    advance(hmm);
+
+    // Track the operator's speed from the element this mark most likely was
+    int32_t error = dot < dash ? r : r - HMM_LOG2_3;
+    hmm->log_unit += error / HMM_UNIT_RATE;
+}
+
+void morse_hmm_gap(morse_hmm *hmm, uint32_t duration_us)
+{
+    const hmm_path *paths = hmm->paths[hmm->current];
+    hmm_path *next = begin_step(hmm);
+
+    int32_t r = log2_q8(duration_us) - hmm->log_unit;
+    int32_t element = duration_cost(r, 0);
+    int32_t letter = duration_cost(r, HMM_LOG2_3);
+    int32_t word = duration_cost(r, HMM_LOG2_7) + HMM_WORD_PENALTY;
+
+    for (int n = 2; n < HMM_NODES; n++)
+    {
+        if (paths[n].cost == HMM_INF)
+            continue;
+
+        // Same letter continues
+        extend(&next[n], &paths[n], paths[n].cost + element, 0, 0);
+
+        // Letter (or word) ends, only possible on a node that is a letter
+        char c = hmm->node_letter[n];
+        if (c)
+        {
+            extend(&next[1], &paths[n], paths[n].cost + letter, c, 0);
+            extend(&next[1], &paths[n], paths[n].cost + word, c, ' ');
+        }
+    }
+    advance(hmm);
+}
+
+int morse_hmm_decode(const morse_hmm *hmm, char *text, int size)
+{
+    const hmm_path *paths = hmm->paths[hmm->current];
+
+    int best = 0;
+    for (int n = 2; n < HMM_NODES; n++)
+    {
+        if (hmm->node_letter[n] && paths[n].cost != HMM_INF &&
+            (best == 0 || paths[n].cost < paths[best].cost))
+            best = n;
+    }
+
+    if (size > 0)
+        text[0] = '\0';
+    if (best == 0)
+        return 0;
+
+    // Copy the text of the best path and finish its last letter
+    int len = paths[best].len;
+    if (len > size - 2)
+        len = size - 2;
+    if (len >= 0)
+    {
+        memcpy(text, paths[best].text, len);
+        text[len] = hmm->node_letter[best];
+        text[len + 1] = '\0';
+    }
+
+    // Posterior of the best path against every other complete path
+    uint32_t total = 65536;
+    for (int n = 2; n < HMM_NODES; n++)
+    {
+        if (n != best && hmm->node_letter[n] && paths[n].cost != HMM_INF)
+            total += likelihood_q16(paths[n].cost - paths[best].cost);
+    }
+    return (int)(6553600u / total);
+}
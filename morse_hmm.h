@@ -0,0 +1,83 @@
+#ifndef MORSE_HMM_H
+#define MORSE_HMM_H
+
+#include <stdint.h>
+
+/**
+ * @file morse_hmm.h
+ * @brief Probabilistic Morse decoder. Press and release durations are treated as noisy
+ * observations of hidden Morse elements (dot/dash, element/letter/word gap) and the most
+ * likely character sequence is found with the Viterbi algorithm. It has no hardware
+ * dependencies so it builds for both the firmware and the host benchmarks.
+ */
+
+/**
+ * @def HMM_NODES
+ * Number of states, one per node of the Morse code tree (codes of up to 5 elements)
+ */
+#define HMM_NODES 64
+
+/**
+ * @def HMM_MAX_TEXT
+ * Longest decoded text (including the terminator) kept per state
+ */
+#define HMM_MAX_TEXT 16
+
+/** Struct defining the best path that ends in one state */
+typedef struct hmm_path
+{
+    int32_t cost;            /*!< Negative log likelihood of the path (nats * 256) */
+    uint8_t len;             /*!< Number of decoded characters in text */
+    char text[HMM_MAX_TEXT]; /*!< Characters decoded before the current letter */
+} hmm_path;
+
+/** Struct defining the decoder state */
+typedef struct morse_hmm
+{
+    char node_letter[HMM_NODES];  /*!< The letter each tree node decodes to, 0 if none */
+    int32_t log_unit;             /*!< log2 of the unit length in Q8 */
+    hmm_path paths[2][HMM_NODES]; /*!< Current and next path per state */
+    uint8_t current;              /*!< Which of paths[] is current */
+} morse_hmm;
+
+/**
+ * @brief Clears the code tree, ready for morse_hmm_add_code()
+ */
+void morse_hmm_init(morse_hmm *hmm);
+
+/**
+ * @brief Adds a letter to the code tree
+ *
+ * @param letter The letter
+ * @param code   Its Morse code as a string of '.' and '-' (up to 5 elements)
+ */
+void morse_hmm_add_code(morse_hmm *hmm, char letter, const char *code);
+
+/**
+ * @brief Starts decoding a new input
+ *
+ * @param unit_us The expected unit (dot) length in microseconds
+ */
+void morse_hmm_reset(morse_hmm *hmm, uint32_t unit_us);
+
+/**
+ * @brief Adds a press (mark) of the given length
+ */
+void morse_hmm_mark(morse_hmm *hmm, uint32_t duration_us);
+
+/**
+ * @brief Adds a release (gap) of the given length between two presses
+ */
+void morse_hmm_gap(morse_hmm *hmm, uint32_t duration_us);
+
+/**
+ * @brief Gets the most likely text for everything observed so far, treating the end
+ *        of the observations as the end of a letter. Doesn't change the decoder state.
+ *
+ * @param text Buffer for the decoded text
+ * @param size Size of the buffer
+ * @return int Confidence that the text is right, 0 - 100
+ */
+int morse_hmm_decode(const morse_hmm *hmm, char *text, int size);
+
+#endif
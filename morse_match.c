@@ -0,0 +1,266 @@
+#include "morse_match.h"
+
+/**
+ * @file morse_match.c
+ * @brief Myers' bit-parallel edit distance (with Hyyrö's global distance boundary) over
+ * the packed codes. The input is the pattern: for each of the three symbols a bit mask
+ * marks where it occurs, then every dictionary element updates the whole column of the
+ * dynamic programming matrix at once as vertical delta bit vectors.
+ */
+
+/** Element symbols */
+enum
+{
+    SYM_DOT,
+    SYM_DASH,
+    SYM_SPACE,
+    SYM_COUNT
+};
+
+/**
+ * @brief Gets the symbol of element i of a packed code
+ */
+static int symbol_at(const match_code *code, int i)
+{
+    if ((code->space >> i) & 1)
+        return SYM_SPACE;
+    return (code->dash >> i) & 1 ? SYM_DASH : SYM_DOT;
+}
+
+/**
+ * @brief Mask of the first n bits
+ */
+static uint64_t low_bits(int n)
+{
+    return n >= 64 ? ~(uint64_t)0 : ((uint64_t)1 << n) - 1;
+}
+
+int match_pack(const char *code, match_code *out)
+{
+    out->dash = 0;
+    out->space = 0;
+    out->len = 0;
+    out->dashes = 0;
+    out->spaces = 0;
+
+    for (; *code; code++)
+    {
+        if (out->len == MATCH_MAX_LEN)
+            return 0;
+        if (*code == '-')
+        {
+            out->dash |= (uint64_t)1 << out->len;
+            out->dashes++;
+        }
+        else if (*code == ' ')
+        {
+            out->space |= (uint64_t)1 << out->len;
+            out->spaces++;
+        }
+        out->len++;
+    }
+    return 1;
+}
+
+/**
+ * @brief Absolute difference of two counts
+ */
+static int count_diff(int a, int b)
+{
+    return a > b ? a - b : b - a;
+}
+
+/**
+ * @brief Cheap lower bound on the edit distance from the symbol counts alone. Every
+ *        edit changes the count of at most two symbols by one each.
+ */
+static int distance_bound(const match_code *a, const match_code *b)
+{
+    int dots_a = a->len - a->dashes - a->spaces;
+    int dots_b = b->len - b->dashes - b->spaces;
+    int diff = count_diff(dots_a, dots_b) + count_diff(a->dashes, b->dashes) + count_diff(a->spaces, b->spaces);
+    int bound = (diff + 1) / 2;
+    int len = count_diff(a->len, b->len);
+    return len > bound ? len : bound;
+}
+
+/**
+ * @brief Edit distance of the candidate from the pattern described by peq, giving up
+ *        (and returning at least limit) once the distance can't get below limit
+ */
+static int myers_distance(const uint64_t peq[SYM_COUNT], int m, const match_code *candidate, int limit)
+{
+    if (m == 0)
+        return candidate->len;
+
+    uint64_t mask = low_bits(m);
+    uint64_t top = (uint64_t)1 << (m - 1);
+    uint64_t pv = mask;
+    uint64_t mv = 0;
+    uint64_t dash = candidate->dash;
+    uint64_t space = candidate->space;
+    int score = m;
+
+    for (int remaining = candidate->len - 1; remaining >= 0; remaining--)
+    {
+        uint64_t eq = space & 1 ? peq[SYM_SPACE] : peq[dash & 1];
+        dash >>= 1;
+        space >>= 1;
+
+        uint64_t xv = eq | mv;
+        uint64_t xh = ((((eq & pv) + pv) & mask) ^ pv) | eq;
+        uint64_t ph = mv | (~(xh | pv) & mask);
+        uint64_t mh = pv & xh;
+
+        if (ph & top)
+            score++;
+        else if (mh & top)
+            score--;
+
+        // Each remaining element can lower the distance by at most one
+        if (score - remaining >= limit)
+            return limit;
+
+        // Global distance: row 0 of the matrix grows by one every column
+        ph = ((ph << 1) | 1) & mask;
+        mh = (mh << 1) & mask;
+        pv = mh | (~(xv | ph) & mask);
+        mv = ph & xv;
+    }
+    return score;
+}
+
+/**
+ * @brief Builds the per symbol match masks of a pattern
+ */
+static void build_peq(const match_code *pattern, uint64_t peq[SYM_COUNT])
+{
+    uint64_t all = low_bits(pattern->len);
+    peq[SYM_SPACE] = pattern->space;
+    peq[SYM_DASH] = pattern->dash & ~pattern->space;
+    peq[SYM_DOT] = all & ~(pattern->dash | pattern->space);
+}
+
+int match_distance(const match_code *input, const match_code *candidate)
+{
+    uint64_t peq[SYM_COUNT];
+    build_peq(input, peq);
+    return myers_distance(peq, input->len, candidate, MATCH_MAX_LEN + 1);
+}
+
+int match_nearest(const match_code *dict, int count, const match_code *input,
+                  match_result *results, int max_results)
+{
+    uint64_t peq[SYM_COUNT];
+    build_peq(input, peq);
+
+    int found = 0;
+    for (int i = 0; i < count; i++)
+    {
+        // Skip entries that can't make the list without running the kernel
+        if (found == max_results && distance_bound(input, &dict[i]) >= results[found - 1].distance)
+            continue;
+
+        int limit = found == max_results ? results[found - 1].distance : MATCH_MAX_LEN + 1;
+        int distance = myers_distance(peq, input->len, &dict[i], limit);
+        if (found == max_results && distance >= results[found - 1].distance)
+            continue;
+
+        // Insert in order, dropping the furthest result if the list is full
+        int pos = found < max_results ? found++ : found - 1;
+        while (pos > 0 && results[pos - 1].distance > distance)
+        {
+            results[pos] = results[pos - 1];
+            pos--;
+        }
+        results[pos].index = i;
+        results[pos].distance = distance;
+    }
+    return found;
+}
+
+int match_split(const match_code *dict, int count, const match_code *input, int *first, int *second)
+{
+    if (input->space)
+        return 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        const match_code *a = &dict[i];
+        if (a->space || a->len >= input->len || (a->dash ^ input->dash) & low_bits(a->len))
+            continue;
+
+        // The rest of the input must be exactly another entry
+        match_code rest = {input->dash >> a->len, 0, input->len - a->len, 0, 0};
+        for (int j = 0; j < count; j++)
+        {
+            if (dict[j].len == rest.len && dict[j].dash == rest.dash && !dict[j].space)
+            {
+                *first = i;
+                *second = j;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Removes the spaces from a packed code
+ */
+static match_code strip_spaces(const match_code *code)
+{
+    match_code out = {0, 0, 0, 0, 0};
+    for (int i = 0; i < code->len; i++)
+    {
+        int sym = symbol_at(code, i);
+        if (sym == SYM_SPACE)
+            continue;
+        if (sym == SYM_DASH)
+            out.dash |= (uint64_t)1 << out.len;
+        out.len++;
+    }
+    return out;
+}
+
+match_error match_classify(const match_code *input, const match_code *candidate)
+{
+    if (input->len == candidate->len && input->dash == candidate->dash && input->space == candidate->space)
+        return MATCH_EXACT;
+
+    // Same length and letter spaces, so only dots and dashes differ
+    if (input->len == candidate->len && input->space == candidate->space)
+        return MATCH_SWAPPED;
+
+    // Same elements but the letter spaces are in different places
+    match_code a = strip_spaces(input);
+    match_code b = strip_spaces(candidate);
+    if (a.len == b.len && a.dash == b.dash)
+        return MATCH_MERGED;
+
+    int distance = match_distance(input, candidate);
+    if (distance == 1 && input->len + 1 == candidate->len)
+        return MATCH_DROPPED;
+    if (distance == 1 && input->len == candidate->len + 1)
+        return MATCH_EXTRA;
+    return MATCH_OTHER;
+}
+
+const char *match_error_name(match_error error)
+{
+    switch (error)
+    {
+    case MATCH_EXACT:
+        return "exact";
+    case MATCH_SWAPPED:
+        return "dot/dash swapped";
+    case MATCH_DROPPED:
+        return "dropped element";
+    case MATCH_EXTRA:
+        return "extra element";
+    case MATCH_MERGED:
+        return "letters merged";
+    default:
+        return "several mistakes";
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef MORSE_MATCH_H
+#define MORSE_MATCH_H
+
+#include <stdint.h>
+
+/**
+ * @file morse_match.h
+ * @brief Nearest code search for "did you mean" feedback. Codes are packed into bitstrings
+ * (one bit per element for dash, one for letter space) and compared with the input using
+ * Myers' bit-parallel edit distance, so a whole dictionary entry costs a handful of word
+ * operations per element. It has no hardware dependencies so it builds for both the
+ * firmware and the host benchmarks.
+ */
+
+/**
+ * @def MATCH_MAX_LEN
+ * Longest code (elements and spaces) that can be packed
+ */
+#define MATCH_MAX_LEN 64
+
+/** Struct defining a packed code, bit i describes element i */
+typedef struct match_code
+{
+    uint64_t dash;  /*!< 1 - Element is a dash */
+    uint64_t space; /*!< 1 - Element is a letter space */
+    uint8_t len;    /*!< Number of elements */
+    uint8_t dashes; /*!< Number of dashes */
+    uint8_t spaces; /*!< Number of letter spaces */
+} match_code;
+
+/** Struct defining one search result */
+typedef struct match_result
+{
+    int index;    /*!< Index of the entry in the dictionary */
+    int distance; /*!< Edit distance from the input */
+} match_result;
+
+/** The kinds of mistake a wrong input can be explained by */
+typedef enum match_error
+{
+    MATCH_EXACT,   /*!< Input and candidate are the same */
+    MATCH_SWAPPED, /*!< Dots keyed as dashes or dashes as dots */
+    MATCH_DROPPED, /*!< An element is missing */
+    MATCH_EXTRA,   /*!< An extra element was keyed */
+    MATCH_MERGED,  /*!< A letter space is missing (or extra), letters ran together */
+    MATCH_OTHER    /*!< More than one kind of mistake */
+} match_error;
+
+/**
+ * @brief Packs a code made of '.', '-' and ' '
+ *
+ * @param code The code string
+ * @param out  The packed code
+ * @return int 1 on success, 0 if the code is too long
+ */
+int match_pack(const char *code, match_code *out);
+
+/**
+ * @brief Edit distance between two packed codes
+ */
+int match_distance(const match_code *input, const match_code *candidate);
+
+/**
+ * @brief Finds the dictionary entries closest to the input
+ *
+ * @param dict        The packed dictionary
+ * @param count       Number of entries in the dictionary
+ * @param input       The packed input
+ * @param results     Filled with the closest entries, nearest first
+ * @param max_results Size of results
+ * @return int The number of results found
+ */
+int match_nearest(const match_code *dict, int count, const match_code *input,
+                  match_result *results, int max_results);
+
+/**
+ * @brief Finds two dictionary entries that the input is the concatenation of, i.e. two
+ *        letters keyed without a space between them
+ *
+ * @param first  Set to the index of the first letter
+ * @param second Set to the index of the second letter
+ * @return int 1 if a split was found, 0 otherwise
+ */
+int match_split(const match_code *dict, int count, const match_code *input, int *first, int *second);
+
+/**
+ * @brief Explains the difference between the input and a candidate
+ */
+match_error match_classify(const match_code *input, const match_code *candidate);
+
+/**
+ * @brief Describes a match_error for the player
+ */
+const char *match_error_name(match_error error);
+
+#endif
@@ -0,0 +1,146 @@
+#include "morse_tx.h"
+
+/**
+ * @file morse_tx.c
+ * @brief A dot is 1.2 s / WPM (PARIS is 50 units). With Farnsworth spacing the 19 units
+ * of letter and word gaps in PARIS take up what the overall speed leaves after its 31
+ * units of elements at the character speed, 3 / 19 of that for each letter gap and
+ * 7 / 19 for each word gap.
+ */
+
+/**
+ * @def PARIS_US
+ * Microseconds PARIS takes at 1 WPM
+ */
+#define PARIS_US 60000000u
+
+/**
+ * @def PARIS_ELEMENT_UNITS
+ * Units of PARIS outside its letter and word gaps
+ */
+#define PARIS_ELEMENT_UNITS 31
+
+/**
+ * @def PARIS_GAP_UNITS
+ * Units of letter and word gaps in PARIS
+ */
+#define PARIS_GAP_UNITS 19
+
+/**
+ * @brief Gets the slot of a character in the code table, upper casing letters
+ *
+ * @return int The slot, -1 if it is out of range
+ */
+static int code_slot(char c)
+{
+    if (c >= 'a' && c <= 'z')
+        c = (char)(c - 'a' + 'A');
+    if (c < ' ' || c >= ' ' + MORSE_TX_CODES)
+        return -1;
+    return c - ' ';
+}
+
+void morse_tx_init(morse_tx *tx)
+{
+    for (int i = 0; i < MORSE_TX_CODES; i++)
+        tx->codes[i] = 0;
+    tx->head = 0;
+    tx->tail = 0;
+    tx->element = 0;
+    tx->gap_us = 0;
+    tx->letters = 0;
+    tx->dropped = 0;
+    tx->unknown = 0;
+    morse_tx_set_speed(tx, 20, 0);
+}
+
+int morse_tx_add_code(morse_tx *tx, char c, const char *code)
+{
+    int slot = code_slot(c);
+    if (slot < 0)
+        return 0;
+    tx->codes[slot] = code;
+    return 1;
+}
+
+void morse_tx_set_speed(morse_tx *tx, uint32_t wpm, uint32_t farnsworth_wpm)
+{
+    if (wpm == 0)
+        wpm = 1;
+    tx->unit_us = PARIS_US / 50 / wpm;
+    tx->letter_gap_us = 3 * tx->unit_us;
+    tx->word_gap_us = 7 * tx->unit_us;
+    if (farnsworth_wpm == 0 || farnsworth_wpm >= wpm)
+        return;
+
+    // What a PARIS at the overall speed leaves for its gaps
+    uint32_t gaps_us = PARIS_US / farnsworth_wpm - PARIS_ELEMENT_UNITS * tx->unit_us;
+    tx->letter_gap_us = gaps_us * 3 / PARIS_GAP_UNITS;
+    tx->word_gap_us = gaps_us * 7 / PARIS_GAP_UNITS;
+}
+
+int morse_tx_queue(morse_tx *tx, const char *text)
+{
+    int n = 0;
+    for (; text[n] && tx->head - tx->tail < MORSE_TX_QUEUE; n++)
+        tx->queue[tx->head++ % MORSE_TX_QUEUE] = text[n];
+    for (const char *c = &text[n]; *c; c++)
+        tx->dropped++;
+    return n;
+}
+
+int morse_tx_pending(const morse_tx *tx)
+{
+    return tx->head != tx->tail || (tx->element && *tx->element) || tx->gap_us;
+}
+
+int morse_tx_fill(morse_tx *tx, uint32_t *words, int max)
+{
+    int n = 0;
+    while (n < max)
+    {
+        if (tx->element && *tx->element)
+        {
+            // Key up for the gap before the element, then key down for the element
+            if (tx->gap_us)
+            {
+                words[n++] = MORSE_TX_WORD(0, tx->gap_us);
+                tx->gap_us = 0;
+                continue;
+            }
+            char e = *tx->element++;
+            words[n++] = MORSE_TX_WORD(1, e == '-' ? 3 * tx->unit_us : tx->unit_us);
+            tx->gap_us = *tx->element ? tx->unit_us : tx->letter_gap_us;
+            continue;
+        }
+
+        if (tx->tail == tx->head)
+        {
+            // Out of text, end key up and a word gap clear of whatever is sent next
+            if (tx->gap_us)
+            {
+                words[n++] = MORSE_TX_WORD(0, tx->word_gap_us);
+                tx->gap_us = 0;
+            }
+            break;
+        }
+
+        char c = tx->queue[tx->tail++ % MORSE_TX_QUEUE];
+        if (c == ' ' || c == '\n')
+        {
+            // Nothing is owed at the start, the last text already ended with a word gap
+            if (tx->gap_us)
+                tx->gap_us = tx->word_gap_us;
+            continue;
+        }
+        int slot = code_slot(c);
+        tx->element = slot < 0 ? 0 : tx->codes[slot];
+        if (!tx->element || !*tx->element)
+        {
+            tx->unknown++;
+            continue;
+        }
+        tx->letters++;
+    }
+    return n;
+}
@@ -0,0 +1,123 @@
+#ifndef MORSE_TX_H
+#define MORSE_TX_H
+
+#include <stdint.h>
+
+/**
+ * @file morse_tx.h
+ * @brief Encodes queued text as Morse for the morse_tx PIO program (morse_tx.pio). Each
+ * letter's code is looked up in a table the caller fills in, and the text comes out as
+ * run-length words, a key level and how long to hold it in ticks of MORSE_TX_TICK_HZ,
+ * ready to be fed to the PIO's FIFO by DMA. Elements are timed at the character speed.
+ * With Farnsworth spacing the letter and word gaps are stretched, so the text as a whole
+ * is sent at the slower overall speed, the ARRL way: PARIS takes 60 / overall WPM seconds.
+ * It has no hardware dependencies so it builds for both the firmware and the host tools.
+ */
+
+/**
+ * @def MORSE_TX_QUEUE
+ * Characters of text that can be waiting to be encoded (a power of 2)
+ */
+#define MORSE_TX_QUEUE 256
+
+/**
+ * @def MORSE_TX_TICK_HZ
+ * The PIO program's clock, one tick per microsecond
+ */
+#define MORSE_TX_TICK_HZ 1000000
+
+/**
+ * @def MORSE_TX_WORD_CYCLES
+ * Cycles the PIO program takes for a word on top of its count, must match morse_tx.pio
+ */
+#define MORSE_TX_WORD_CYCLES 3
+
+/**
+ * @def MORSE_TX_WORD
+ * The word that holds the key at level (1 - down, 0 - up) for us microseconds
+ */
+#define MORSE_TX_WORD(level, us) ((uint32_t)(level) | ((uint32_t)(us) - MORSE_TX_WORD_CYCLES) << 1)
+
+/**
+ * @def MORSE_TX_WORD_LEVEL
+ * The key level of a word
+ */
+#define MORSE_TX_WORD_LEVEL(w) ((w) & 1u)
+
+/**
+ * @def MORSE_TX_WORD_US
+ * How long a word holds its level, in microseconds
+ */
+#define MORSE_TX_WORD_US(w) (((w) >> 1) + MORSE_TX_WORD_CYCLES)
+
+/**
+ * @def MORSE_TX_CODES
+ * Characters that can have a code, ' ' to '_' (lower case letters are sent as upper case)
+ */
+#define MORSE_TX_CODES 64
+
+/** Struct defining the encoder state */
+typedef struct morse_tx
+{
+    const char *codes[MORSE_TX_CODES]; /*!< Code of each character from ' ', NULL for none */
+    uint32_t unit_us;                  /*!< Dot length at the character speed */
+    uint32_t letter_gap_us;            /*!< Key up between letters */
+    uint32_t word_gap_us;              /*!< Key up between words */
+    char queue[MORSE_TX_QUEUE];        /*!< Text waiting to be encoded */
+    uint32_t head;                     /*!< Total characters ever queued */
+    uint32_t tail;                     /*!< Total characters ever taken from the queue */
+    const char *element;               /*!< Next element of the letter being encoded, NULL between letters */
+    uint32_t gap_us;                   /*!< Key up owed before the next element, 0 once the key up has been sent */
+    uint32_t letters;                  /*!< Letters encoded */
+    uint32_t dropped;                  /*!< Characters that didn't fit in the queue */
+    uint32_t unknown;                  /*!< Characters skipped because they have no code */
+} morse_tx;
+
+/**
+ * @brief Sets up an encoder with no codes, at 20 WPM without Farnsworth spacing
+ */
+void morse_tx_init(morse_tx *tx);
+
+/**
+ * @brief Adds a character's code
+ *
+ * @param code Its Morse code as a string of '.' and '-', must outlive the encoder
+ * @return int 1 on success, 0 if the character is out of range
+ */
+int morse_tx_add_code(morse_tx *tx, char c, const char *code);
+
+/**
+ * @brief Sets the speed, taking effect from the next element
+ *
+ * @param wpm            Character speed, the elements and the gaps within a letter
+ * @param farnsworth_wpm Overall speed, the letter and word gaps are stretched to it.
+ *                       0 or anything at or above wpm for standard spacing
+ */
+void morse_tx_set_speed(morse_tx *tx, uint32_t wpm, uint32_t farnsworth_wpm);
+
+/**
+ * @brief Queues text to send, ' ' and '\n' separate words
+ *
+ * @return int The characters queued, less than the length if the queue filled up
+ */
+int morse_tx_queue(morse_tx *tx, const char *text);
+
+/**
+ * @brief Checks whether anything is still to be encoded
+ *
+ * @return int 1 if morse_tx_fill() has more words to give, 0 otherwise
+ */
+int morse_tx_pending(const morse_tx *tx);
+
+/**
+ * @brief Encodes queued text into words. Key down and key up words alternate, and the
+ *        last word before the queue runs out is a word gap, so the key is left up and
+ *        the next text is spaced from this.
+ *
+ * @param words Filled with the words
+ * @param max   Size of words
+ * @return int The words written, 0 when nothing is left to encode
+ */
+int morse_tx_fill(morse_tx *tx, uint32_t *words, int max);
+
+#endif
@@ -0,0 +1,108 @@
+#include <string.h>
+
+#include "scheduler.h"
+
+/**
+ * @file scheduler.c
+ * @brief The ready mask has one bit per task, so finding the next task to run is a bit
+ * scan and a whole pass costs a few instructions per ready task however many are idle.
+ */
+
+#if PICO_ON_DEVICE
+#include "hardware/sync.h"
+#define SCHED_LOCK() uint32_t sched_irq = save_and_disable_interrupts()
+#define SCHED_UNLOCK() restore_interrupts(sched_irq)
+#else
+#define SCHED_LOCK()
+#define SCHED_UNLOCK()
+#endif
+
+void sched_init(scheduler *s)
+{
+    memset(s, 0, sizeof(*s));
+}
+
+int sched_add(scheduler *s, sched_handler handler, void *ctx, const char *name)
+{
+    if (s->count == SCHED_MAX_TASKS)
+        return -1;
+
+    sched_task *t = &s->tasks[s->count];
+    t->handler = handler;
+    t->ctx = ctx;
+    t->name = name;
+    return s->count++;
+}
+
+void sched_post(scheduler *s, int task, uint32_t events)
+{
+    SCHED_LOCK();
+    s->tasks[task].events |= events;
+    s->ready |= 1u << task;
+    SCHED_UNLOCK();
+}
+
+void sched_timer(scheduler *s, int task, uint32_t at_us)
+{
+    s->tasks[task].deadline = at_us;
+    s->tasks[task].timer_armed = 1;
+}
+
+void sched_cancel(scheduler *s, int task)
+{
+    s->tasks[task].timer_armed = 0;
+}
+
+int sched_next_deadline(const scheduler *s, uint32_t *at_us)
+{
+    int found = 0;
+    for (int i = 0; i < s->count; i++)
+    {
+        const sched_task *t = &s->tasks[i];
+        if (t->timer_armed && (!found || (int32_t)(t->deadline - *at_us) < 0))
+        {
+            *at_us = t->deadline;
+            found = 1;
+        }
+    }
+    return found;
+}
+
+int sched_run(scheduler *s, uint32_t now_us)
+{
+    for (int i = 0; i < s->count; i++)
+    {
+        sched_task *t = &s->tasks[i];
+        if (t->timer_armed && (int32_t)(now_us - t->deadline) >= 0)
+        {
+            t->timer_armed = 0;
+            sched_post(s, i, SCHED_EVENT_TIMER);
+        }
+    }
+
+    // Take the whole ready mask at once, anything posted while the handlers run
+    // waits for the next pass so one busy task can't starve the others
+    SCHED_LOCK();
+    uint32_t ready = s->ready;
+    s->ready = 0;
+    SCHED_UNLOCK();
+
+    int dispatched = 0;
+    while (ready)
+    {
+        int i = __builtin_ctz(ready);
+        ready &= ready - 1;
+
+        sched_task *t = &s->tasks[i];
+        SCHED_LOCK();
+        uint32_t events = t->events;
+        t->events = 0;
+        SCHED_UNLOCK();
+
+        t->handler(t->ctx, events);
+        t->runs++;
+        dispatched++;
+    }
+    s->dispatches += dispatched;
+    return dispatched;
+}
@@ -0,0 +1,95 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * @file scheduler.h
+ * @brief Small cooperative run-to-completion scheduler. Each task is a handler that is
+ * called with the bit mask of events posted to it since it last ran, plus an optional
+ * one-shot timer. Handlers never block, they do their work and return, so every task
+ * gets to run within one pass of the others. It has no hardware dependencies (other
+ * than masking interrupts around the shared state on the device) so it builds for both
+ * the firmware and the host benchmarks.
+ */
+
+/**
+ * @def SCHED_MAX_TASKS
+ * Most tasks a scheduler can hold (one bit each in the ready mask)
+ */
+#define SCHED_MAX_TASKS 32
+
+/**
+ * @def SCHED_EVENT_TIMER
+ * Event posted to a task when its timer expires, the other bits are free for the task
+ */
+#define SCHED_EVENT_TIMER (1u << 31)
+
+/** A task's handler, called with its context and the events that are pending */
+typedef void (*sched_handler)(void *ctx, uint32_t events);
+
+/** Struct defining one task */
+typedef struct sched_task
+{
+    sched_handler handler;    /*!< Called when an event is pending */
+    void *ctx;                /*!< Passed to the handler */
+    const char *name;         /*!< For reports */
+    volatile uint32_t events; /*!< Events posted since the task last ran */
+    uint32_t deadline;        /*!< Time the timer expires at */
+    uint8_t timer_armed;      /*!< 1 - The timer is running */
+    uint32_t runs;            /*!< Number of times the handler has been called */
+} sched_task;
+
+/** Struct defining a scheduler and its tasks */
+typedef struct scheduler
+{
+    sched_task tasks[SCHED_MAX_TASKS];
+    int count;               /*!< Number of tasks added */
+    volatile uint32_t ready; /*!< Bit i set - Task i has events pending */
+    uint32_t dispatches;     /*!< Total handler calls */
+} scheduler;
+
+/**
+ * @brief Clears a scheduler
+ */
+void sched_init(scheduler *s);
+
+/**
+ * @brief Adds a task
+ *
+ * @return int The task's id, or -1 if the scheduler is full
+ */
+int sched_add(scheduler *s, sched_handler handler, void *ctx, const char *name);
+
+/**
+ * @brief Posts events to a task, safe to call from interrupts
+ */
+void sched_post(scheduler *s, int task, uint32_t events);
+
+/**
+ * @brief Starts (or restarts) a task's timer to post SCHED_EVENT_TIMER at the given time
+ */
+void sched_timer(scheduler *s, int task, uint32_t at_us);
+
+/**
+ * @brief Stops a task's timer
+ */
+void sched_cancel(scheduler *s, int task);
+
+/**
+ * @brief Finds the earliest running timer
+ *
+ * @param at_us Set to the time it expires
+ * @return int 1 if a timer is running, 0 otherwise
+ */
+int sched_next_deadline(const scheduler *s, uint32_t *at_us);
+
+/**
+ * @brief Expires the timers that are due and calls every task with events pending once
+ *
+ * @param now_us The current time
+ * @return int The number of handlers called, 0 if there was nothing to do
+ */
+int sched_run(scheduler *s, uint32_t now_us);
+
+#endif
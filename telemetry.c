@@ -0,0 +1,249 @@
+#include <string.h>
+
+#include "telemetry.h"
+
+/**
+ * @file telemetry.c
+ * @brief The header byte is the type in bits 0-3, the player in bits 4-6 and bit 7 set
+ * when the time is absolute. A frame that fails its checks is assumed to have lost its
+ * opening zero, so its closing zero is taken as the next frame's opening one: a decoder
+ * that joins part way through (or drops a byte) loses at most the frames it missed.
+ */
+
+/**
+ * @def HEADER_ABSOLUTE
+ * Header bit set when the time is absolute rather than a delta
+ */
+#define HEADER_ABSOLUTE 0x80
+
+/** Record type names, indexed by telemetry_type */
+static const char *const type_names[TELEMETRY_TYPE_COUNT] = {
+    "?", "ROUND", "SYMBOL", "LIVES", "LEVEL", "LATENCY", "LOST"};
+
+const char *telemetry_type_name(int type)
+{
+    return type > 0 && type < TELEMETRY_TYPE_COUNT ? type_names[type] : type_names[0];
+}
+
+/**
+ * @brief CRC-8 (polynomial 0x07) of a buffer
+ */
+static uint8_t crc8(const uint8_t *data, int len)
+{
+    uint8_t crc = 0;
+    for (int i = 0; i < len; i++)
+    {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++)
+            crc = crc & 0x80 ? (uint8_t)(crc << 1) ^ 0x07 : (uint8_t)(crc << 1);
+    }
+    return crc;
+}
+
+/**
+ * @brief Writes a LEB128 varint
+ *
+ * @return int The bytes written
+ */
+static int put_varint(uint8_t *out, uint32_t v)
+{
+    int n = 0;
+    while (v >= 0x80)
+    {
+        out[n++] = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    out[n++] = (uint8_t)v;
+    return n;
+}
+
+/**
+ * @brief Reads a LEB128 varint
+ *
+ * @return int The bytes read, 0 if it runs past the end or is too long
+ */
+static int get_varint(const uint8_t *in, int len, uint32_t *v)
+{
+    *v = 0;
+    for (int n = 0; n < len && n < 5; n++)
+    {
+        *v |= (uint32_t)(in[n] & 0x7f) << (7 * n);
+        if (!(in[n] & 0x80))
+            return n + 1;
+    }
+    return 0;
+}
+
+void telemetry_init(telemetry_queue *q)
+{
+    memset(q, 0, sizeof(*q));
+    q->since_sync = TELEMETRY_SYNC_RECORDS;
+}
+
+int telemetry_push(telemetry_queue *q, const telemetry_record *r)
+{
+    if (q->head - q->tail == TELEMETRY_QUEUE_SIZE)
+    {
+        q->dropped++;
+        return 0;
+    }
+    q->queue[q->head % TELEMETRY_QUEUE_SIZE] = *r;
+    q->head++;
+    return 1;
+}
+
+int telemetry_encode(const telemetry_record *r, uint32_t *last_us, int absolute, uint8_t *out)
+{
+    // The record is built after a gap for the COBS code and the opening zero
+    uint8_t *raw = out + 2;
+    int n = 0;
+    raw[n++] = (uint8_t)((r->type & 0x0f) | (r->player & 0x07) << 4 | (absolute ? HEADER_ABSOLUTE : 0));
+    if (absolute)
+        n += put_varint(raw + n, r->time_us);
+    else
+    {
+        int32_t delta = (int32_t)(r->time_us - *last_us);
+        n += put_varint(raw + n, (uint32_t)(delta << 1) ^ (uint32_t)(delta >> 31));
+    }
+    *last_us = r->time_us;
+    for (int i = 0; i < r->count && i < TELEMETRY_MAX_FIELDS; i++)
+        n += put_varint(raw + n, r->field[i]);
+    raw[n] = crc8(raw, n);
+    n++;
+
+    // COBS in place: each zero becomes the distance to the next one, starting from the code byte
+    out[0] = 0;
+    int code_at = 1;
+    for (int i = 0; i < n; i++)
+    {
+        if (raw[i] == 0)
+        {
+            out[code_at] = (uint8_t)(i + 2 - code_at);
+            code_at = i + 2;
+        }
+    }
+    out[code_at] = (uint8_t)(n + 2 - code_at);
+    out[n + 2] = 0;
+    return n + 3;
+}
+
+int telemetry_next(telemetry_queue *q, uint8_t *out)
+{
+    telemetry_record lost;
+    const telemetry_record *r;
+    uint32_t dropped = q->dropped;
+    if (dropped != q->reported)
+    {
+        // Tell the decoder, and resynchronise the time as the records are out of order
+        lost.time_us = q->last_us;
+        lost.type = TELEMETRY_LOST;
+        lost.player = 0;
+        lost.count = 1;
+        lost.field[0] = dropped - q->reported;
+        q->reported = dropped;
+        q->since_sync = TELEMETRY_SYNC_RECORDS;
+        r = &lost;
+    }
+    else if (q->head != q->tail)
+        r = &q->queue[q->tail % TELEMETRY_QUEUE_SIZE];
+    else
+        return 0;
+
+    int absolute = q->since_sync >= TELEMETRY_SYNC_RECORDS;
+    int len = telemetry_encode(r, &q->last_us, absolute, out);
+    q->since_sync = absolute ? 1 : q->since_sync + 1;
+    q->bytes += len;
+    if (r != &lost)
+        q->tail++;
+    return len;
+}
+
+void telemetry_decoder_init(telemetry_decoder *d)
+{
+    memset(d, 0, sizeof(*d));
+}
+
+/**
+ * @brief Decodes the COBS frame in the decoder's buffer
+ *
+ * @return int 1 if it was a valid record, 0 otherwise
+ */
+static int decode_frame(telemetry_decoder *d, telemetry_record *r)
+{
+    uint8_t raw[TELEMETRY_MAX_FRAME];
+    int n = 0;
+    for (int i = 0; i < d->len;)
+    {
+        int code = d->frame[i++];
+        if (i + code - 1 > d->len)
+            return 0;
+        for (int k = 1; k < code; k++)
+            raw[n++] = d->frame[i++];
+        if (i < d->len)
+            raw[n++] = 0;
+    }
+    if (n < 3 || crc8(raw, n - 1) != raw[n - 1])
+        return 0;
+    n--;
+
+    int absolute = raw[0] & HEADER_ABSOLUTE;
+    uint32_t t;
+    int pos = 1;
+    int used = get_varint(raw + pos, n - pos, &t);
+    if (!used)
+        return 0;
+    pos += used;
+    r->time_us = absolute ? t : d->last_us + (uint32_t)((int32_t)(t >> 1) ^ -(int32_t)(t & 1));
+    r->type = raw[0] & 0x0f;
+    r->player = (raw[0] >> 4) & 0x07;
+    r->count = 0;
+    while (pos < n)
+    {
+        if (r->count == TELEMETRY_MAX_FIELDS || !(used = get_varint(raw + pos, n - pos, &r->field[r->count])))
+            return 0;
+        pos += used;
+        r->count++;
+    }
+    d->last_us = r->time_us;
+    if (absolute)
+        d->synced = 1;
+    return 1;
+}
+
+telemetry_result telemetry_feed(telemetry_decoder *d, uint8_t byte, telemetry_record *r)
+{
+    if (!d->in_frame)
+    {
+        if (byte != 0)
+            return TELEMETRY_TEXT;
+        d->in_frame = 1;
+        d->len = 0;
+        return TELEMETRY_NONE;
+    }
+
+    if (byte != 0)
+    {
+        // An overlong frame is rejected at its closing zero
+        if (d->len < TELEMETRY_MAX_FRAME)
+            d->frame[d->len] = byte;
+        d->len++;
+        return TELEMETRY_NONE;
+    }
+
+    // Back to back frames share nothing, so an empty frame is just the next opening zero
+    if (d->len == 0)
+        return TELEMETRY_NONE;
+
+    if (d->len <= TELEMETRY_MAX_FRAME && decode_frame(d, r))
+    {
+        d->in_frame = 0;
+        d->records++;
+        return TELEMETRY_RECORD;
+    }
+
+    // Take the zero as the opening of the next frame
+    d->bad++;
+    d->synced = 0;
+    d->len = 0;
+    return TELEMETRY_BAD;
+}
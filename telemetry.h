@@ -0,0 +1,148 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/**
+ * @file telemetry.h
+ * @brief Binary telemetry records, framed so they can share the console with the
+ * human readable text. Each record is a header byte (type, player and whether the time
+ * is absolute), its time as a zigzag varint delta from the previous record's (or the
+ * absolute time), its fields as varints and a CRC-8. The record is COBS encoded so it
+ * contains no zero bytes and written between two zeros, which the console text never
+ * contains. A typical record takes 8 to 14 bytes. Records are queued from any context
+ * and encoded when the queue is drained. It has no hardware dependencies so the host
+ * decoder uses the same code.
+ */
+
+/**
+ * @def TELEMETRY_MAX_FIELDS
+ * Most fields in a record
+ */
+#define TELEMETRY_MAX_FIELDS 6
+
+/**
+ * @def TELEMETRY_QUEUE_SIZE
+ * Records that can be waiting to be sent (power of 2)
+ */
+#define TELEMETRY_QUEUE_SIZE 64
+
+/**
+ * @def TELEMETRY_MAX_FRAME
+ * Longest framed record: delimiters, COBS code, header, 5 byte varints and the CRC
+ */
+#define TELEMETRY_MAX_FRAME (2 + 1 + 1 + 5 * (1 + TELEMETRY_MAX_FIELDS) + 1)
+
+/**
+ * @def TELEMETRY_SYNC_RECORDS
+ * An absolute time is sent at least this often, so a decoder that has lost a frame
+ * (or joined part way through) soon has the right time again
+ */
+#define TELEMETRY_SYNC_RECORDS 32
+
+/** The record types, the fields of each are listed in order */
+typedef enum telemetry_type
+{
+    TELEMETRY_ROUND = 1, /*!< level, question index, correct (0/1), lives, remaining, answer time (us) */
+    TELEMETRY_SYMBOL,    /*!< press length (us), 0 - dot, 1 - dash, 2 - free keying, at the release */
+    TELEMETRY_LIVES,     /*!< lives, whenever they change */
+    TELEMETRY_LEVEL,     /*!< level, game state, whenever either changes */
+    TELEMETRY_LATENCY,   /*!< answer complete to verdict (us), worst edge to deferred work (us), dropped edges, audio overruns */
+    TELEMETRY_LOST,      /*!< records dropped because the queue was full */
+    TELEMETRY_TYPE_COUNT
+} telemetry_type;
+
+/** Struct defining one record */
+typedef struct telemetry_record
+{
+    uint32_t time_us; /*!< Lower 32 bits of the timer when it happened */
+    uint8_t type;     /*!< A telemetry_type */
+    uint8_t player;
+    uint8_t count;    /*!< Fields used */
+    uint32_t field[TELEMETRY_MAX_FIELDS];
+} telemetry_record;
+
+/** Struct defining the queue of records waiting to be sent, and the encoder's state */
+typedef struct telemetry_queue
+{
+    telemetry_record queue[TELEMETRY_QUEUE_SIZE];
+    volatile uint32_t head;    /*!< Total records queued */
+    volatile uint32_t tail;    /*!< Total records encoded */
+    volatile uint32_t dropped; /*!< Records dropped because the queue was full */
+    uint32_t reported;         /*!< Dropped records already sent in a TELEMETRY_LOST record */
+    uint32_t last_us;          /*!< Time of the last record encoded */
+    uint32_t since_sync;       /*!< Records encoded since the last absolute time */
+    uint32_t bytes;            /*!< Total bytes encoded */
+} telemetry_queue;
+
+/** Struct defining a decoder, which separates the console text from the records */
+typedef struct telemetry_decoder
+{
+    uint8_t frame[TELEMETRY_MAX_FRAME];
+    int len;          /*!< Bytes of the current frame */
+    int in_frame;     /*!< 1 - Between a frame's delimiters */
+    int synced;       /*!< 1 - Record times are right, 0 - Waiting for an absolute time */
+    uint32_t last_us; /*!< Time of the last record decoded */
+    uint32_t records; /*!< Records decoded */
+    uint32_t bad;     /*!< Frames rejected (too long, bad COBS or CRC) */
+} telemetry_decoder;
+
+/** What telemetry_feed() made of a byte */
+typedef enum telemetry_result
+{
+    TELEMETRY_NONE,   /*!< Part of a frame */
+    TELEMETRY_TEXT,   /*!< Console text */
+    TELEMETRY_RECORD, /*!< The end of a frame, the record is ready */
+    TELEMETRY_BAD     /*!< The end of a frame that was rejected */
+} telemetry_result;
+
+/**
+ * @brief Empties a queue, the first record encoded will carry an absolute time
+ */
+void telemetry_init(telemetry_queue *q);
+
+/**
+ * @brief Queues a record, must not interrupt another push to the same queue
+ *
+ * @return int 1 on success, 0 if the queue was full and the record was dropped
+ */
+int telemetry_push(telemetry_queue *q, const telemetry_record *r);
+
+/**
+ * @brief Encodes the next waiting record (or a TELEMETRY_LOST record if any have been
+ *        dropped since the last one)
+ *
+ * @param out Filled with the framed record, at least TELEMETRY_MAX_FRAME bytes
+ * @return int The length of the frame, 0 if nothing is waiting
+ */
+int telemetry_next(telemetry_queue *q, uint8_t *out);
+
+/**
+ * @brief Encodes a record into a frame
+ *
+ * @param last_us  Time of the previous record, updated
+ * @param absolute 1 - Send the absolute time instead of the delta
+ * @param out      At least TELEMETRY_MAX_FRAME bytes
+ * @return int The length of the frame
+ */
+int telemetry_encode(const telemetry_record *r, uint32_t *last_us, int absolute, uint8_t *out);
+
+/**
+ * @brief Sets up a decoder
+ */
+void telemetry_decoder_init(telemetry_decoder *d);
+
+/**
+ * @brief Feeds one received byte to a decoder
+ *
+ * @param r Filled with the record when TELEMETRY_RECORD is returned
+ * @return telemetry_result What the byte was
+ */
+telemetry_result telemetry_feed(telemetry_decoder *d, uint8_t byte, telemetry_record *r);
+
+/**
+ * @brief Gets the name of a record type
+ */
+const char *telemetry_type_name(int type);
+
+#endif
@@ -0,0 +1,151 @@
+#include <math.h>
+
+#include "tone_detect.h"
+
+/**
+ * @file tone_detect.c
+ * @brief The Goertzel filter runs once per sample with one 32 bit multiply, so it suits
+ * the M0+ (single cycle multiplier, no FPU). Samples are reduced to 8 bits so the state
+ * stays within 32 bits for blocks of up to TONE_MAX_BLOCK. The power and the threshold
+ * are only worked out once per block.
+ */
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/**
+ * @def TONE_SAMPLE_SHIFT
+ * Bits dropped from each 12 bit sample
+ */
+#define TONE_SAMPLE_SHIFT 4
+
+/**
+ * @def TONE_MIN_SNR
+ * Power ratio over the noise floor needed before a tone is accepted. The power of a
+ * block of noise is exponentially distributed and the floor tracks its median (0.69 of
+ * the mean), so this is 10 dB over the mean noise and keeps false triggers to about
+ * e^-10 per block.
+ */
+#define TONE_MIN_SNR 14
+
+/**
+ * @def TONE_WARMUP_BLOCKS
+ * Blocks spent measuring the noise floor before any edge is reported
+ */
+#define TONE_WARMUP_BLOCKS 8
+
+void tone_init(tone_detector *t, uint32_t sample_hz, uint32_t tone_hz, int block)
+{
+    if (block > TONE_MAX_BLOCK)
+        block = TONE_MAX_BLOCK;
+
+    // Use the nearest bin, whole cycles per block keep DC out of it
+    int k = (int)((block * tone_hz + sample_hz / 2) / sample_hz);
+    t->coeff = (int32_t)lround(2.0 * cos(2.0 * M_PI * k / block) * (1 << TONE_COEFF_SHIFT));
+    t->block = block;
+    t->fill = 0;
+    t->period_q16 = (uint32_t)((1000000ull << 16) / sample_hz);
+    t->block_us = 0;
+    t->s1 = t->s2 = 0;
+    t->power = 0;
+    t->floor = 0;
+    t->peak = 0;
+    t->min_power = (uint32_t)(block * block) / 4;
+    t->blocks = 0;
+    t->on = 0;
+}
+
+/**
+ * @brief Works out the power of the finished block and updates the tone state
+ *
+ * @return int 1 if the tone turned on or off
+ */
+static int end_block(tone_detector *t)
+{
+    int64_t s1 = t->s1, s2 = t->s2;
+    int64_t power = s1 * s1 + s2 * s2 - ((t->coeff * s1) >> TONE_COEFF_SHIFT) * s2;
+    uint32_t p = power < 0 ? 0 : power > UINT32_MAX ? UINT32_MAX : (uint32_t)power;
+    t->power = p;
+    t->s1 = t->s2 = 0;
+
+    if (t->blocks++ < TONE_WARMUP_BLOCKS)
+    {
+        t->floor = t->blocks == 1 ? p : t->floor + ((int64_t)p - t->floor) / (int32_t)t->blocks;
+        if (t->floor < t->min_power)
+            t->floor = t->min_power;
+        return 0;
+    }
+
+    // Switch on half way (in power) between the floor and the tone, off at half that
+    uint64_t on_level = t->floor + ((uint64_t)(t->peak > t->floor ? t->peak - t->floor : 0) >> 1);
+    if (on_level < (uint64_t)t->floor * TONE_MIN_SNR)
+        on_level = (uint64_t)t->floor * TONE_MIN_SNR;
+    uint64_t off_level = on_level >> 1;
+
+    if (!t->on)
+    {
+        if (p > on_level)
+        {
+            t->on = 1;
+            if (p > t->peak)
+                t->peak = p;
+            return 1;
+        }
+        // Step the floor towards the median, so blocks catching the edge of a tone
+        // can't drag it up any more than ordinary noise does
+        if (p > t->floor)
+            t->floor += t->floor / 32 + 1;
+        else
+            t->floor -= t->floor / 32;
+        if (t->floor < t->min_power)
+            t->floor = t->min_power;
+        // Let the tone estimate fall so a weaker signal is still picked up
+        t->peak -= t->peak >> 9;
+        return 0;
+    }
+
+    if (p < off_level)
+    {
+        t->on = 0;
+        return 1;
+    }
+    t->peak += ((int64_t)p - t->peak) / 8;
+    return 0;
+}
+
+int tone_process(tone_detector *t, const uint16_t *samples, int count, uint32_t start_us,
+                 tone_edge *edges, int max)
+{
+    int found = 0;
+    int32_t coeff = t->coeff;
+    int32_t s1 = t->s1, s2 = t->s2;
+
+    for (int i = 0; i < count; i++)
+    {
+        if (t->fill == 0)
+            t->block_us = start_us + (uint32_t)(((uint64_t)i * t->period_q16) >> 16);
+
+        int32_t x = ((int32_t)samples[i] - 2048) >> TONE_SAMPLE_SHIFT;
+        int32_t s0 = x + ((coeff * s1) >> TONE_COEFF_SHIFT) - s2;
+        s2 = s1;
+        s1 = s0;
+
+        if (++t->fill == t->block)
+        {
+            t->s1 = s1;
+            t->s2 = s2;
+            t->fill = 0;
+            if (end_block(t) && found < max)
+            {
+                edges[found].time_us = t->block_us;
+                edges[found].release = !t->on;
+                found++;
+            }
+            s1 = s2 = 0;
+        }
+    }
+    t->s1 = s1;
+    t->s2 = s2;
+    return found;
+}
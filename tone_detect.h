@@ -0,0 +1,74 @@
+#ifndef TONE_DETECT_H
+#define TONE_DETECT_H
+
+#include <stdint.h>
+
+/**
+ * @file tone_detect.h
+ * @brief Turns audio samples of a Morse tone into key press and release edges. Each
+ * block of samples is run through a fixed-point Goertzel filter tuned to the tone, and
+ * the tone power is compared with a threshold that follows the noise floor and the tone
+ * level, with hysteresis. It has no hardware dependencies so it builds for both the
+ * firmware (fed by the ADC) and the host benchmarks (fed from WAV files).
+ */
+
+/**
+ * @def TONE_MAX_BLOCK
+ * Longest block, keeps the filter state within 32 bits
+ */
+#define TONE_MAX_BLOCK 256
+
+/**
+ * @def TONE_COEFF_SHIFT
+ * Fractional bits of the Goertzel coefficient
+ */
+#define TONE_COEFF_SHIFT 14
+
+/** Struct defining one detected edge */
+typedef struct tone_edge
+{
+    uint32_t time_us; /*!< Start of the block the edge was detected in */
+    uint8_t release;  /*!< 0 - Tone started (press), 1 - Tone stopped (release) */
+} tone_edge;
+
+/** Struct defining the detector state */
+typedef struct tone_detector
+{
+    int32_t coeff;       /*!< 2cos(2 pi k / block) in Q14 */
+    uint16_t block;      /*!< Samples per block */
+    uint16_t fill;       /*!< Samples of the current block seen so far */
+    uint32_t period_q16; /*!< Sample period in microseconds, Q16 */
+    uint32_t block_us;   /*!< Start of the current block */
+    int32_t s1, s2;      /*!< Goertzel state */
+    uint32_t power;      /*!< Tone power of the last block */
+    uint32_t floor;      /*!< Noise power estimate, tracked while the tone is off */
+    uint32_t peak;       /*!< Tone power estimate, tracked while the tone is on */
+    uint32_t min_power;  /*!< Lowest noise floor, a one LSB tone */
+    uint32_t blocks;     /*!< Blocks processed */
+    uint8_t on;          /*!< 1 - The tone is on */
+} tone_detector;
+
+/**
+ * @brief Sets up a detector
+ *
+ * @param sample_hz The sample rate
+ * @param tone_hz   The tone frequency to detect
+ * @param block     Samples per block (up to TONE_MAX_BLOCK), sets the time resolution
+ *                  and the bandwidth (both sample_hz / block)
+ */
+void tone_init(tone_detector *t, uint32_t sample_hz, uint32_t tone_hz, int block);
+
+/**
+ * @brief Runs samples through the detector. Blocks may span calls.
+ *
+ * @param samples  Unsigned 12 bit samples (the ADC's format), centred on 2048
+ * @param count    Number of samples
+ * @param start_us Time of the first sample
+ * @param edges    Filled with the edges detected
+ * @param max      Size of edges
+ * @return int The number of edges detected
+ */
+int tone_process(tone_detector *t, const uint16_t *samples, int count, uint32_t start_us,
+                 tone_edge *edges, int max);
+
+#endif
@@ -0,0 +1,197 @@
+#include "transcribe.h"
+
+/**
+ * @file transcribe.c
+ * @brief The threshold between dots and dashes comes from the biggest jump in the sorted
+ * recent mark lengths. Dashes are nominally three dots long, so when the window holds
+ * both the jump is clear, and when it holds only one kind (a run of S, E and I) the jump
+ * is small and the previous estimates are kept for the kind that is missing.
+ */
+
+/**
+ * @def SPLIT_RATIO_NUM
+ * A jump of at least SPLIT_RATIO_NUM / SPLIT_RATIO_DEN (1.8) separates dots from dashes
+ */
+#define SPLIT_RATIO_NUM 9
+#define SPLIT_RATIO_DEN 5
+
+void transcribe_init(transcriber *t)
+{
+    for (int i = 0; i < TRANSCRIBE_NODES; i++)
+        t->node_char[i] = 0;
+    transcribe_reset(t, 0);
+}
+
+void transcribe_reset(transcriber *t, uint32_t unit_us)
+{
+    t->node = 1;
+    t->dot_us = unit_us;
+    t->dash_us = 3 * unit_us;
+    t->marks = 0;
+    t->text_head = 0;
+    t->symbol_head = 0;
+    t->unknown = 0;
+}
+
+int transcribe_add_code(transcriber *t, char c, const char *code)
+{
+    unsigned node = 1;
+    for (; *code; code++)
+    {
+        node = 2 * node + (*code == '-');
+        if (node >= TRANSCRIBE_NODES)
+            return 0;
+    }
+    t->node_char[node] = c;
+    return 1;
+}
+
+/**
+ * @brief Re-estimates the dot and dash lengths from the window of recent marks
+ */
+static void update_clusters(transcriber *t)
+{
+    int n = t->marks < TRANSCRIBE_WINDOW ? (int)t->marks : TRANSCRIBE_WINDOW;
+    uint32_t sorted[TRANSCRIBE_WINDOW];
+
+    // Insertion sort, the window is small
+    for (int i = 0; i < n; i++)
+    {
+        uint32_t v = t->window[i];
+        int j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--)
+            sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+    }
+
+    // The biggest jump, compared as sorted[i] / sorted[i - 1] without dividing
+    int split = 0;
+    for (int i = 1; i < n; i++)
+    {
+        if ((uint64_t)sorted[i] * SPLIT_RATIO_DEN < (uint64_t)sorted[i - 1] * SPLIT_RATIO_NUM)
+            continue;
+        if (split == 0 || (uint64_t)sorted[i] * sorted[split - 1] > (uint64_t)sorted[split] * sorted[i - 1])
+            split = i;
+    }
+
+    uint64_t low = 0, high = 0;
+    for (int i = 0; i < n; i++)
+    {
+        if (i < split)
+            low += sorted[i];
+        else
+            high += sorted[i];
+    }
+
+    if (split > 0)
+    {
+        t->dot_us = (uint32_t)(low / split);
+        t->dash_us = (uint32_t)(high / (n - split));
+        return;
+    }
+
+    // Only one kind of mark in the window, decide which from the current threshold
+    uint32_t mean = (uint32_t)(high / n);
+    if (mean < (t->dot_us + t->dash_us) / 2)
+    {
+        t->dot_us = mean;
+        if (t->dash_us < 2 * mean)
+            t->dash_us = 3 * mean;
+    }
+    else
+    {
+        t->dash_us = mean;
+        if (t->dot_us > mean / 2)
+            t->dot_us = mean / 3;
+    }
+}
+
+char transcribe_mark(transcriber *t, uint32_t duration_us)
+{
+    t->window[t->marks % TRANSCRIBE_WINDOW] = duration_us;
+    t->marks++;
+    update_clusters(t);
+
+    char symbol = duration_us < (t->dot_us + t->dash_us) / 2 ? '.' : '-';
+    if (t->node != 0)
+    {
+        unsigned node = 2 * t->node + (symbol == '-');
+        t->node = node < TRANSCRIBE_NODES ? node : 0;
+    }
+    t->symbols[t->symbol_head++ % TRANSCRIBE_RING] = symbol;
+    return symbol;
+}
+
+/**
+ * @brief Appends a character to the text ring
+ */
+static void put_char(transcriber *t, char c, uint32_t time_us)
+{
+    uint32_t i = t->text_head % TRANSCRIBE_RING;
+    t->text[i] = c;
+    t->text_time[i] = time_us;
+    t->text_head++;
+}
+
+char transcribe_letter(transcriber *t, uint32_t time_us)
+{
+    if (t->node == 1)
+        return 0;
+
+    char c = t->node != 0 ? t->node_char[t->node] : 0;
+    if (c == 0)
+    {
+        c = '?';
+        t->unknown++;
+    }
+    t->node = 1;
+    put_char(t, c, time_us);
+    t->symbols[t->symbol_head++ % TRANSCRIBE_RING] = ' ';
+    return c;
+}
+
+void transcribe_space(transcriber *t, uint32_t time_us)
+{
+    if (t->text_head == 0 || t->text[(t->text_head - 1) % TRANSCRIBE_RING] == ' ')
+        return;
+    put_char(t, ' ', time_us);
+}
+
+uint32_t transcribe_unit(const transcriber *t)
+{
+    return t->dot_us;
+}
+
+int transcribe_read(const transcriber *t, uint32_t *cursor, char *out, int max, uint32_t *lost)
+{
+    *lost = 0;
+    if (t->text_head - *cursor > TRANSCRIBE_RING)
+    {
+        *lost = t->text_head - TRANSCRIBE_RING - *cursor;
+        *cursor = t->text_head - TRANSCRIBE_RING;
+    }
+
+    int n = 0;
+    while (*cursor != t->text_head && n < max)
+        out[n++] = t->text[(*cursor)++ % TRANSCRIBE_RING];
+    return n;
+}
+
+uint32_t transcribe_cpm(const transcriber *t, uint32_t now_us)
+{
+    uint32_t kept = t->text_head < TRANSCRIBE_RING ? t->text_head : TRANSCRIBE_RING;
+    uint32_t count = 0, oldest = now_us;
+    for (uint32_t i = 1; i <= kept; i++)
+    {
+        uint32_t at = t->text_time[(t->text_head - i) % TRANSCRIBE_RING];
+        if (now_us - at > TRANSCRIBE_RATE_US)
+            break;
+        oldest = at;
+        count++;
+    }
+
+    // The rate is measured from the first character counted, which took no time itself
+    if (count < 2 || now_us == oldest)
+        return 0;
+    return (uint32_t)((uint64_t)(count - 1) * 60000000u / (now_us - oldest));
+}
@@ -0,0 +1,125 @@
+#ifndef TRANSCRIBE_H
+#define TRANSCRIBE_H
+
+#include <stdint.h>
+
+/**
+ * @file transcribe.h
+ * @brief Continuous decoding of keying into text, for sessions of any length in constant
+ * memory. Each mark is classified as a dot or a dash against the two clusters found in
+ * the last TRANSCRIBE_WINDOW marks, so the decoder follows the sender's speed from a few
+ * WPM to well over 40. The current letter is a position in the code tree, and the
+ * elements and decoded characters go into rings that the display reads behind. It has
+ * no hardware dependencies so it builds for both the firmware and the host benchmarks.
+ */
+
+/**
+ * @def TRANSCRIBE_NODES
+ * Nodes of the code tree (codes of up to 6 elements)
+ */
+#define TRANSCRIBE_NODES 128
+
+/**
+ * @def TRANSCRIBE_RING
+ * Characters (and elements) kept, must be a power of 2
+ */
+#define TRANSCRIBE_RING 256
+
+/**
+ * @def TRANSCRIBE_WINDOW
+ * Recent marks the dot/dash threshold is worked out from
+ */
+#define TRANSCRIBE_WINDOW 16
+
+/**
+ * @def TRANSCRIBE_RATE_US
+ * Period the character rate is averaged over
+ */
+#define TRANSCRIBE_RATE_US 60000000u
+
+/** Struct defining the transcription state */
+typedef struct transcriber
+{
+    char node_char[TRANSCRIBE_NODES];     /*!< The character each tree node decodes to, 0 if none */
+    uint8_t node;                         /*!< The current letter's tree node, 1 - no elements yet, 0 - too long */
+    uint32_t dot_us;                      /*!< Dot length estimate */
+    uint32_t dash_us;                     /*!< Dash length estimate */
+    uint32_t window[TRANSCRIBE_WINDOW];   /*!< The most recent mark lengths */
+    uint32_t marks;                       /*!< Total marks */
+    char text[TRANSCRIBE_RING];           /*!< Decoded characters */
+    uint32_t text_time[TRANSCRIBE_RING];  /*!< Time each character was decoded */
+    uint32_t text_head;                   /*!< Total characters ever decoded */
+    char symbols[TRANSCRIBE_RING];        /*!< Elements, with ' ' after each letter */
+    uint32_t symbol_head;                 /*!< Total elements ever written */
+    uint32_t unknown;                     /*!< Letters that weren't in the tree */
+} transcriber;
+
+/**
+ * @brief Clears the code tree, ready for transcribe_add_code()
+ */
+void transcribe_init(transcriber *t);
+
+/**
+ * @brief Starts a new session, keeping the code tree
+ *
+ * @param unit_us The expected unit (dot) length until the sender's has been measured
+ */
+void transcribe_reset(transcriber *t, uint32_t unit_us);
+
+/**
+ * @brief Adds a character to the code tree
+ *
+ * @param code Its Morse code as a string of '.' and '-' (up to 6 elements)
+ * @return int 1 on success, 0 if the code is too long
+ */
+int transcribe_add_code(transcriber *t, char c, const char *code);
+
+/**
+ * @brief Adds a mark (key press) of the given length to the current letter
+ *
+ * @return char '.' or '-'
+ */
+char transcribe_mark(transcriber *t, uint32_t duration_us);
+
+/**
+ * @brief Ends the current letter
+ *
+ * @param time_us Time the letter ended
+ * @return char The decoded character, '?' if the code isn't in the tree, 0 if the
+ *         letter had no elements
+ */
+char transcribe_letter(transcriber *t, uint32_t time_us);
+
+/**
+ * @brief Ends the current word, adding a space after the last character
+ */
+void transcribe_space(transcriber *t, uint32_t time_us);
+
+/**
+ * @brief The sender's unit (dot) length estimate
+ */
+uint32_t transcribe_unit(const transcriber *t);
+
+/**
+ * @brief Copies the characters decoded since the cursor and advances it past them. If
+ *        the reader has fallen more than TRANSCRIBE_RING behind it skips to the oldest
+ *        character left.
+ *
+ * @param cursor Total characters read so far
+ * @param out    Filled with the characters (not terminated)
+ * @param max    Size of out
+ * @param lost   Set to the number of characters skipped
+ * @return int The number of characters copied
+ */
+int transcribe_read(const transcriber *t, uint32_t *cursor, char *out, int max, uint32_t *lost);
+
+/**
+ * @brief Characters per minute decoded over the last TRANSCRIBE_RATE_US (or as many
+ *        characters as the ring holds), including the pause since the last one
+ *
+ * @param now_us The current time
+ * @return uint32_t Characters per minute, words per minute is this / 5
+ */
+uint32_t transcribe_cpm(const transcriber *t, uint32_t now_us);
+
+#endif